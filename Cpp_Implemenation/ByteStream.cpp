@@ -0,0 +1,233 @@
+#include "ByteStream.h"
+
+void ByteWriter::writeByte(uint8_t value)
+{
+    bytes.push_back(value);
+}
+
+void ByteWriter::writeVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+void ByteWriter::writeSignedVarint(int64_t value)
+{
+    writeVarint(zigZagEncode(value));
+}
+
+void ByteWriter::writeFixed32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void ByteWriter::writeFixed64(uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void ByteWriter::writeDouble(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeFixed64(bits);
+}
+
+void ByteWriter::writeString(const std::string& value)
+{
+    writeVarint(value.size());
+    bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+void ByteWriter::writeBytes(const uint8_t* data, size_t size)
+{
+    bytes.insert(bytes.end(), data, data + size);
+}
+
+size_t ByteWriter::size() const
+{
+    return bytes.size();
+}
+
+void ByteWriter::clear()
+{
+    bytes.clear();
+}
+
+ByteReader::ByteReader(const uint8_t* data, size_t size) : data(data), size(size), offset(0)
+{
+}
+
+void ByteReader::require(size_t count) const
+{
+    if (count > size - offset)
+        throw std::runtime_error("Unexpected end of binary data.");
+}
+
+uint8_t ByteReader::readByte()
+{
+    require(1);
+    return data[offset++];
+}
+
+uint64_t ByteReader::readVarint()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte = readByte();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw std::runtime_error("Malformed varint in binary data.");
+}
+
+int64_t ByteReader::readSignedVarint()
+{
+    return zigZagDecode(readVarint());
+}
+
+uint32_t ByteReader::readFixed32()
+{
+    require(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(data[offset++]) << (8 * i);
+    return value;
+}
+
+uint64_t ByteReader::readFixed64()
+{
+    require(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(data[offset++]) << (8 * i);
+    return value;
+}
+
+double ByteReader::readDouble()
+{
+    uint64_t bits = readFixed64();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string ByteReader::readString()
+{
+    size_t length = readVarint();
+    require(length);
+    std::string value(reinterpret_cast<const char*>(data + offset), length);
+    offset += length;
+    return value;
+}
+
+void ByteReader::readBytes(uint8_t* destination, size_t count)
+{
+    require(count);
+    if (count == 0)
+        return; //An empty vector's data() may be null
+    std::memcpy(destination, data + offset, count);
+    offset += count;
+}
+
+const uint8_t* ByteReader::skip(size_t count)
+{
+    require(count);
+    const uint8_t* start = data + offset;
+    offset += count;
+    return start;
+}
+
+bool ByteReader::atEnd() const
+{
+    return offset >= size;
+}
+
+size_t ByteReader::position() const
+{
+    return offset;
+}
+
+BitWriter::BitWriter() : currentByte(0), usedBits(0), totalBits(0)
+{
+}
+
+void BitWriter::writeBit(bool bit)
+{
+    currentByte = static_cast<uint8_t>((currentByte << 1) | (bit ? 1 : 0));
+    usedBits++;
+    totalBits++;
+    if (usedBits == 8)
+    {
+        bytes.push_back(currentByte);
+        currentByte = 0;
+        usedBits = 0;
+    }
+}
+
+void BitWriter::writeBits(uint64_t value, int numBits)
+{
+    for (int i = numBits - 1; i >= 0; i--)
+        writeBit((value >> i) & 1);
+}
+
+void BitWriter::flush(ByteWriter& output) const
+{
+    output.writeBytes(bytes.data(), bytes.size());
+    if (usedBits > 0)
+        output.writeByte(static_cast<uint8_t>(currentByte << (8 - usedBits)));
+}
+
+size_t BitWriter::bitCount() const
+{
+    return totalBits;
+}
+
+void BitWriter::saveState(ByteWriter& output) const
+{
+    output.writeVarint(bytes.size());
+    output.writeBytes(bytes.data(), bytes.size());
+    output.writeByte(currentByte);
+    output.writeByte(static_cast<uint8_t>(usedBits));
+    output.writeVarint(totalBits);
+}
+
+void BitWriter::loadState(ByteReader& input)
+{
+    bytes.resize(input.readVarint());
+    input.readBytes(bytes.data(), bytes.size());
+    currentByte = input.readByte();
+    usedBits = input.readByte();
+    totalBits = input.readVarint();
+}
+
+BitReader::BitReader(const uint8_t* data, size_t size) : data(data), size(size), bitOffset(0)
+{
+}
+
+bool BitReader::readBit()
+{
+    size_t byteIndex = bitOffset / 8;
+    if (byteIndex >= size)
+        throw std::runtime_error("Unexpected end of bit stream.");
+
+    bool bit = (data[byteIndex] >> (7 - bitOffset % 8)) & 1;
+    bitOffset++;
+    return bit;
+}
+
+uint64_t BitReader::readBits(int numBits)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < numBits; i++)
+        value = (value << 1) | (readBit() ? 1 : 0);
+    return value;
+}
@@ -0,0 +1,94 @@
+#ifndef BYTE_STREAM_H
+#define BYTE_STREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+inline uint64_t zigZagEncode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigZagDecode(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class ByteWriter
+{
+public:
+    std::vector<uint8_t> bytes;
+
+    void writeByte(uint8_t value);
+    void writeVarint(uint64_t value);
+    void writeSignedVarint(int64_t value);
+    void writeFixed32(uint32_t value);
+    void writeFixed64(uint64_t value);
+    void writeDouble(double value);
+    void writeString(const std::string& value);
+    void writeBytes(const uint8_t* data, size_t size);
+    size_t size() const;
+    void clear();
+};
+
+class ByteReader
+{
+public:
+    ByteReader(const uint8_t* data, size_t size);
+
+    uint8_t readByte();
+    uint64_t readVarint();
+    int64_t readSignedVarint();
+    uint32_t readFixed32();
+    uint64_t readFixed64();
+    double readDouble();
+    std::string readString();
+    void readBytes(uint8_t* destination, size_t count);
+    const uint8_t* skip(size_t count);
+    bool atEnd() const;
+    size_t position() const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+
+    void require(size_t count) const;
+};
+
+//Bit-level writer used by the XOR float codec (most significant bit first)
+class BitWriter
+{
+public:
+    BitWriter();
+    void writeBit(bool bit);
+    void writeBits(uint64_t value, int numBits);
+    void flush(ByteWriter& output) const;
+    size_t bitCount() const;
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
+
+private:
+    std::vector<uint8_t> bytes;
+    uint8_t currentByte;
+    int usedBits;
+    size_t totalBits;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t size);
+    bool readBit();
+    uint64_t readBits(int numBits);
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t bitOffset;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "Car.h"
 #include "Road.h"
+#include "Checkpoint.h"
 
 Car::Car(int pos, int roadID) 
     : position(pos), 
@@ -7,10 +8,14 @@ Car::Car(int pos, int roadID)
       willChangeRoad(false), 
       roadChangeDecisionMade(false),
       willSurpassSharedSection(false), 
-      indexAndTargetRoad(-1, std::weak_ptr<Road>()),
+      indexAndTargetRoad(-1, nullptr),
       originalRoadID(roadID),
+      vehicleID(0),
+      destinationZone(-1),
       residenceTime(0),
-      timeOnCurrentRoad(0)
+      timeOnCurrentRoad(0),
+      queueLight(nullptr),
+      queued(false)
 {
 }
 
@@ -25,10 +30,14 @@ Car::Car(Car&& other) noexcept
       sharedSectionIndex(other.sharedSectionIndex), 
       indexAndTargetRoad(std::move(other.indexAndTargetRoad)),
       originalRoadID(other.originalRoadID),
+      vehicleID(other.vehicleID),
+      destinationZone(other.destinationZone),
       residenceTime(other.residenceTime),
-      timeOnCurrentRoad(other.timeOnCurrentRoad)
+      timeOnCurrentRoad(other.timeOnCurrentRoad),
+      queueLight(other.queueLight),
+      queued(other.queued)
 {
-    other.indexAndTargetRoad = std::make_pair(-1, std::weak_ptr<Road>());
+    other.indexAndTargetRoad = std::make_pair(-1, nullptr);
 }
 
 Car& Car::operator=(Car&& other) noexcept 
@@ -45,14 +54,56 @@ Car& Car::operator=(Car&& other) noexcept
         sharedSectionIndex = other.sharedSectionIndex;
         indexAndTargetRoad = std::move(other.indexAndTargetRoad);
         originalRoadID = other.originalRoadID;
+        vehicleID = other.vehicleID;
+        destinationZone = other.destinationZone;
         residenceTime = other.residenceTime;
         timeOnCurrentRoad = other.timeOnCurrentRoad;
+        queueLight = other.queueLight;
+        queued = other.queued;
 
-        other.indexAndTargetRoad = std::make_pair(-1, std::weak_ptr<Road>());
+        other.indexAndTargetRoad = std::make_pair(-1, nullptr);
     }
     return *this;
 }
 
+void Car::saveState(ByteWriter& output) const
+{
+    Checkpoint::writeValue(output, speed);
+    Checkpoint::writeValue(output, position);
+    Checkpoint::writeValue(output, willChangeRoad);
+    Checkpoint::writeValue(output, roadChangeDecisionMade);
+    Checkpoint::writeValue(output, willSurpassSharedSection);
+    Checkpoint::writeValue(output, originalRoadID);
+    output.writeVarint(vehicleID);
+    Checkpoint::writeValue(output, destinationZone);
+    Checkpoint::writeValue(output, residenceTime);
+    Checkpoint::writeValue(output, timeOnCurrentRoad);
+    Checkpoint::writeValue(output, indexAndTargetRoad.first);
+
+    Checkpoint::writeValue(output, indexAndTargetRoad.second ? indexAndTargetRoad.second->roadID : -1);
+}
+
+void Car::loadState(ByteReader& input, const std::vector<std::shared_ptr<Road>>& roads)
+{
+    speed = Checkpoint::readValue<int>(input);
+    position = Checkpoint::readValue<int>(input);
+    willChangeRoad = Checkpoint::readValue<bool>(input);
+    roadChangeDecisionMade = Checkpoint::readValue<bool>(input);
+    willSurpassSharedSection = Checkpoint::readValue<bool>(input);
+    originalRoadID = Checkpoint::readValue<int>(input);
+    vehicleID = static_cast<uint32_t>(input.readVarint());
+    destinationZone = Checkpoint::readValue<int>(input);
+    residenceTime = Checkpoint::readValue<int>(input);
+    timeOnCurrentRoad = Checkpoint::readValue<int>(input);
+    indexAndTargetRoad.first = Checkpoint::readValue<int>(input);
+
+    int targetRoadID = Checkpoint::readValue<int>(input);
+    if (targetRoadID >= 0 && targetRoadID < static_cast<int>(roads.size()))
+        indexAndTargetRoad.second = roads[targetRoadID].get();
+    else
+        indexAndTargetRoad.second = nullptr;
+}
+
 Car::~Car() 
 {
 }
@@ -4,8 +4,10 @@
 #include <utility>
 #include <memory>
 #include "Road.h"
+#include "ByteStream.h"
 
 class Road;
+class TrafficLight;
 
 class Car : public std::enable_shared_from_this<Car>
 {
@@ -19,13 +21,19 @@ public:
     int distanceToSharedSection;
     int sharedSectionIndex;
     int originalRoadID;
+    uint32_t vehicleID; //Stable for the whole run, see Simulation::assignVehicleIDs
+    int destinationZone; //Routing zone the car heads for, -1 for a random walk, see RoutingTable
     int residenceTime;
     int timeOnCurrentRoad;
-    std::pair<int, std::weak_ptr<Road>> indexAndTargetRoad;
+    std::pair<int, Road*> indexAndTargetRoad; //Cell and road of the turn decided on, the road outlives its cars
+    TrafficLight* queueLight; //Approach the car is counted in, see Road::trackCar
+    bool queued;
 
     Car(int pos, int roadID);
     Car(Car&& other) noexcept;
     Car& operator=(Car&& other) noexcept;
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input, const std::vector<std::shared_ptr<Road>>& roads);
     ~Car();
 };
 
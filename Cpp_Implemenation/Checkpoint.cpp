@@ -0,0 +1,91 @@
+#include "Checkpoint.h"
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+std::vector<uint8_t> Checkpoint::readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open checkpoint file: " + path);
+
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void Checkpoint::writeFile(const std::string& path, const ByteWriter& data)
+{
+    //Write next to the target and rename, so a preempted write never leaves a torn checkpoint
+    std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open checkpoint file: " + temporaryPath);
+
+    file.write(reinterpret_cast<const char*>(data.bytes.data()), data.size());
+    file.close();
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Unable to write checkpoint file: " + path);
+}
+
+CheckpointWriter::CheckpointWriter() : pendingChild(-1)
+{
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    wait();
+}
+
+void CheckpointWriter::write(const std::string& path, const std::function<void(ByteWriter&)>& serialize)
+{
+    wait(); //At most one checkpoint in flight
+
+#ifndef _WIN32
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int status = 0;
+        try
+        {
+            ByteWriter data;
+            serialize(data);
+            Checkpoint::writeFile(path, data);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Checkpoint failed: " << e.what() << std::endl;
+            status = 1;
+        }
+        _exit(status); //Skip destructors and stream flushes that belong to the parent
+    }
+    else if (pid > 0)
+    {
+        pendingChild = pid;
+        return;
+    }
+    std::cerr << "fork() failed, writing checkpoint synchronously." << std::endl;
+#endif
+
+    ByteWriter data;
+    serialize(data);
+    Checkpoint::writeFile(path, data);
+}
+
+void CheckpointWriter::wait()
+{
+#ifndef _WIN32
+    if (pendingChild > 0)
+    {
+        int status = 0;
+        waitpid(static_cast<pid_t>(pendingChild), &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            std::cerr << "Checkpoint writer process " << pendingChild << " did not finish successfully." << std::endl;
+        pendingChild = -1;
+    }
+#endif
+}
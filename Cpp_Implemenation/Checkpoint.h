@@ -0,0 +1,54 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include "ByteStream.h"
+#include "LimitedQueue.h"
+
+//Helpers shared by the saveState/loadState methods of the simulation classes.
+//Integers are stored as zig-zag varints and floating point values as raw 64-bit words.
+class Checkpoint
+{
+public:
+    static constexpr uint8_t formatVersion = 10;
+
+    template <typename T>
+    static void writeValue(ByteWriter& output, const T& value);
+
+    template <typename T>
+    static T readValue(ByteReader& input);
+
+    template <typename T>
+    static void writeQueue(ByteWriter& output, const LimitedQueue<T>& queue);
+
+    template <typename T>
+    static void readQueue(ByteReader& input, LimitedQueue<T>& queue);
+
+    static std::vector<uint8_t> readFile(const std::string& path);
+    static void writeFile(const std::string& path, const ByteWriter& data);
+};
+
+//Writes checkpoints without blocking the simulation loop. On POSIX systems the state is
+//serialized in a forked child, so the parent only pays for the fork and the copy-on-write
+//page faults. Elsewhere, or if fork() fails, the checkpoint is written synchronously.
+class CheckpointWriter
+{
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();
+    void write(const std::string& path, const std::function<void(ByteWriter&)>& serialize);
+    void wait();
+
+private:
+    long pendingChild;
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+};
+
+#include "Checkpoint.tpp"
+#endif
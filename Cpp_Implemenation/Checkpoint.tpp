@@ -0,0 +1,54 @@
+#ifndef CHECKPOINT_TPP
+#define CHECKPOINT_TPP
+
+#include "Checkpoint.h"
+
+template <typename T>
+void Checkpoint::writeValue(ByteWriter& output, const T& value)
+{
+    if constexpr (std::is_floating_point_v<T>)
+        output.writeDouble(static_cast<double>(value));
+    else if constexpr (std::is_same_v<T, bool>)
+        output.writeByte(value ? 1 : 0);
+    else if constexpr (std::is_signed_v<T>)
+        output.writeSignedVarint(static_cast<int64_t>(value));
+    else
+        output.writeVarint(static_cast<uint64_t>(value));
+}
+
+template <typename T>
+T Checkpoint::readValue(ByteReader& input)
+{
+    if constexpr (std::is_floating_point_v<T>)
+        return static_cast<T>(input.readDouble());
+    else if constexpr (std::is_same_v<T, bool>)
+        return input.readByte() != 0;
+    else if constexpr (std::is_signed_v<T>)
+        return static_cast<T>(input.readSignedVarint());
+    else
+        return static_cast<T>(input.readVarint());
+}
+
+template <typename T>
+void Checkpoint::writeQueue(ByteWriter& output, const LimitedQueue<T>& queue)
+{
+    output.writeVarint(queue.totalPushed());
+    output.writeVarint(queue.size());
+    for (const auto& value : queue)
+        writeValue(output, value);
+}
+
+template <typename T>
+void Checkpoint::readQueue(ByteReader& input, LimitedQueue<T>& queue)
+{
+    unsigned long long totalPushed = input.readVarint();
+    size_t size = input.readVarint();
+
+    std::deque<T> values;
+    for (size_t i = 0; i < size; i++)
+        values.push_back(readValue<T>(input));
+
+    queue.restore(values, totalPushed);
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include "CompressedResultsWriter.h"
+#include <algorithm>
+
+CompressedResultsWriter::CompressedResultsWriter(const std::vector<std::shared_ptr<Road>>& roads) : roads(roads)
+{
+    episodeColumn = addColumn<IntColumnEncoder>("episode");
+
+    for (const auto& road : roads)
+    {
+        std::string prefix = "road" + std::to_string(road->roadID) + ".";
+        RoadColumns rc;
+        rc.numCars = addColumn<IntColumnEncoder>(prefix + "numCars");
+        rc.generalDensity = addColumn<FloatColumnEncoder>(prefix + "generalDensity");
+        rc.averageDistanceHeadway = addColumn<FloatColumnEncoder>(prefix + "averageDistanceHeadway");
+        rc.averageSpeed = addColumn<FloatColumnEncoder>(prefix + "averageSpeed");
+        rc.alpha = addColumn<FloatColumnEncoder>(prefix + "alpha");
+        rc.beta = addColumn<FloatColumnEncoder>(prefix + "beta");
+        rc.newCarInserted = addColumn<BoolColumnEncoder>(prefix + "newCarInserted");
+
+        for (int point : road->timeHeadwayAndFlowPoints)
+        {
+            rc.points.push_back(point);
+            rc.flow.push_back(addColumn<IntColumnEncoder>(prefix + "flow." + std::to_string(point)));
+        }
+        for (int point : rc.points)
+            rc.timeHeadways.push_back(addQueueColumns<IntColumnEncoder>(prefix + "timeHeadways." + std::to_string(point)));
+
+        rc.residenceTimes = addQueueColumns<IntColumnEncoder>(prefix + "residenceTimes");
+        rc.travelTimes = addQueueColumns<IntColumnEncoder>(prefix + "travelTimes");
+        rc.averageTravelTimes = addQueueColumns<FloatColumnEncoder>(prefix + "averageTravelTimes");
+
+        for (size_t i = 0; i < road->trafficLights.size(); i++)
+        {
+            rc.lightIsGreen.push_back(addColumn<BoolColumnEncoder>(prefix + "trafficLights." + std::to_string(i) + ".isGreen"));
+            rc.lightTimer.push_back(addColumn<IntColumnEncoder>(prefix + "trafficLights." + std::to_string(i) + ".timer"));
+        }
+
+        roadColumns.push_back(std::move(rc));
+    }
+}
+
+template <typename Encoder>
+Encoder* CompressedResultsWriter::addColumn(const std::string& name)
+{
+    auto column = std::make_unique<Encoder>(name);
+    Encoder* raw = column.get();
+    columns.push_back(std::move(column));
+    return raw;
+}
+
+template <typename Encoder>
+CompressedResultsWriter::QueueColumns CompressedResultsWriter::addQueueColumns(const std::string& name)
+{
+    QueueColumns queueColumns;
+    queueColumns.newSamples = addColumn<IntColumnEncoder>(name + ".newSamples");
+    queueColumns.values = addColumn<Encoder>(name);
+    queueColumns.lastSeen = 0;
+    return queueColumns;
+}
+
+template <typename T, typename Encoder>
+void CompressedResultsWriter::recordNewSamples(QueueColumns& queueColumns, const LimitedQueue<T>& queue)
+{
+    //Samples that were pushed and already evicted again within one episode are lost
+    //in the JSON output as well, so only what is still in the window is written.
+    unsigned long long newSamples = std::min<unsigned long long>(queue.totalPushed() - queueColumns.lastSeen, queue.size());
+    queueColumns.lastSeen = queue.totalPushed();
+    queueColumns.newSamples->push(static_cast<long long>(newSamples));
+
+    auto values = static_cast<Encoder*>(queueColumns.values);
+    for (auto it = queue.end() - newSamples; it != queue.end(); ++it)
+        values->push(*it);
+}
+
+void CompressedResultsWriter::recordEpisode(unsigned long long episode)
+{
+    episodeColumn->push(static_cast<long long>(episode));
+
+    for (size_t roadIndex = 0; roadIndex < roads.size(); roadIndex++)
+    {
+        const auto& road = roads[roadIndex];
+        auto& rc = roadColumns[roadIndex];
+
+        rc.numCars->push(static_cast<long long>(road->carsPositions.size()));
+        rc.generalDensity->push(road->generalDensity);
+        rc.averageDistanceHeadway->push(road->averageDistanceHeadway);
+        rc.averageSpeed->push(road->averageSpeed);
+        rc.alpha->push(road->alpha);
+        rc.beta->push(road->beta);
+        rc.newCarInserted->push(road->newCarInserted);
+
+        //Flow and time headways are indexed by detector
+        const auto& timeHeadways = road->getLoggedTimeHeadways();
+        for (size_t detector = 0; detector < rc.points.size(); detector++)
+        {
+            rc.flow[detector]->push(road->flowAtPoints[detector]);
+            recordNewSamples<unsigned long long, IntColumnEncoder>(rc.timeHeadways[detector], timeHeadways[detector]);
+        }
+
+        recordNewSamples<int, IntColumnEncoder>(rc.residenceTimes, road->residenceTimes);
+        recordNewSamples<int, IntColumnEncoder>(rc.travelTimes, road->travelTimes);
+        recordNewSamples<double, FloatColumnEncoder>(rc.averageTravelTimes, road->averageTravelTimes);
+
+        for (size_t i = 0; i < road->trafficLights.size(); i++)
+        {
+            rc.lightIsGreen[i]->push(road->trafficLights[i]->isGreen());
+            rc.lightTimer[i]->push(road->trafficLights[i]->timeInState(episode));
+        }
+    }
+}
+
+void CompressedResultsWriter::writeToFile(const std::string& path, const nlohmann::json& header) const
+{
+    nlohmann::json fileHeader = header;
+    fileHeader["formatVersion"] = formatVersion;
+    fileHeader["queueSize"] = roads.empty() ? 0 : roads[0]->residenceTimes.capacity();
+
+    nlohmann::json layout = nlohmann::json::array();
+    for (size_t roadIndex = 0; roadIndex < roads.size(); roadIndex++)
+    {
+        nlohmann::json roadLayout;
+        roadLayout["roadID"] = roads[roadIndex]->roadID;
+        roadLayout["points"] = roadColumns[roadIndex].points;
+        roadLayout["numTrafficLights"] = roadColumns[roadIndex].lightIsGreen.size();
+        layout.push_back(roadLayout);
+    }
+    fileHeader["layout"] = layout;
+
+    nlohmann::json columnsInfo = nlohmann::json::array();
+    for (const auto& column : columns)
+        columnsInfo.push_back({{"name", column->name}, {"type", static_cast<int>(column->type)}, {"count", column->count}});
+    fileHeader["columns"] = columnsInfo;
+
+    ByteWriter output;
+    output.writeBytes(reinterpret_cast<const uint8_t*>("NSCR"), 4);
+    output.writeByte(formatVersion);
+    output.writeString(fileHeader.dump());
+
+    for (const auto& column : columns)
+    {
+        ByteWriter encoded;
+        column->finish(encoded);
+        output.writeVarint(encoded.size());
+        output.writeBytes(encoded.bytes.data(), encoded.size());
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open file for compressed results: " + path);
+
+    file.write(reinterpret_cast<const char*>(output.bytes.data()), output.size());
+}
+
+void CompressedResultsWriter::saveState(ByteWriter& output) const
+{
+    output.writeVarint(columns.size());
+    for (const auto& column : columns)
+        column->saveState(output);
+
+    for (const auto& rc : roadColumns)
+    {
+        for (const auto& queueColumns : rc.timeHeadways)
+            output.writeVarint(queueColumns.lastSeen);
+        output.writeVarint(rc.residenceTimes.lastSeen);
+        output.writeVarint(rc.travelTimes.lastSeen);
+        output.writeVarint(rc.averageTravelTimes.lastSeen);
+    }
+}
+
+void CompressedResultsWriter::loadState(ByteReader& input)
+{
+    if (input.readVarint() != columns.size())
+        throw std::runtime_error("Checkpoint does not match the compressed output columns.");
+
+    for (auto& column : columns)
+        column->loadState(input);
+
+    for (auto& rc : roadColumns)
+    {
+        for (auto& queueColumns : rc.timeHeadways)
+            queueColumns.lastSeen = input.readVarint();
+        rc.residenceTimes.lastSeen = input.readVarint();
+        rc.travelTimes.lastSeen = input.readVarint();
+        rc.averageTravelTimes.lastSeen = input.readVarint();
+    }
+}
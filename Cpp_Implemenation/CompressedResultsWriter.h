@@ -0,0 +1,71 @@
+#ifndef COMPRESSED_RESULTS_WRITER_H
+#define COMPRESSED_RESULTS_WRITER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include "Road.h"
+#include "TimeSeriesCodec.h"
+
+//Columnar alternative to the per-episode JSON of Simulation::collectMetrics.
+//Every scalar metric becomes one column; queue metrics (time headways, residence
+//and travel times) only store the samples logged since the previous episode.
+//
+//File layout: "NSCR", format version byte, header JSON (varint length + text)
+//describing the columns, then for each column a varint byte length and its data.
+class CompressedResultsWriter
+{
+public:
+    static constexpr uint8_t formatVersion = 1;
+
+    explicit CompressedResultsWriter(const std::vector<std::shared_ptr<Road>>& roads);
+    void recordEpisode(unsigned long long episode);
+    void writeToFile(const std::string& path, const nlohmann::json& header) const;
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
+
+private:
+    struct QueueColumns
+    {
+        IntColumnEncoder* newSamples;
+        ColumnEncoder* values;
+        unsigned long long lastSeen;
+    };
+
+    struct RoadColumns
+    {
+        IntColumnEncoder* numCars;
+        FloatColumnEncoder* generalDensity;
+        FloatColumnEncoder* averageDistanceHeadway;
+        FloatColumnEncoder* averageSpeed;
+        FloatColumnEncoder* alpha;
+        FloatColumnEncoder* beta;
+        BoolColumnEncoder* newCarInserted;
+        std::vector<int> points;
+        std::vector<IntColumnEncoder*> flow;
+        std::vector<QueueColumns> timeHeadways;
+        QueueColumns residenceTimes;
+        QueueColumns travelTimes;
+        QueueColumns averageTravelTimes;
+        std::vector<BoolColumnEncoder*> lightIsGreen;
+        std::vector<IntColumnEncoder*> lightTimer;
+    };
+
+    std::vector<std::shared_ptr<Road>> roads;
+    std::vector<std::unique_ptr<ColumnEncoder>> columns;
+    std::vector<RoadColumns> roadColumns;
+    IntColumnEncoder* episodeColumn;
+
+    template <typename Encoder>
+    Encoder* addColumn(const std::string& name);
+
+    template <typename Encoder>
+    QueueColumns addQueueColumns(const std::string& name);
+
+    template <typename T, typename Encoder>
+    void recordNewSamples(QueueColumns& queueColumns, const LimitedQueue<T>& queue);
+};
+
+#endif
@@ -16,6 +16,7 @@ private:
 public:
     void add(const KeyType &key, const ValueType &value);
     ValueType get(const KeyType &key) const;
+    ValueType& at(const KeyType &key);
     void remove(const KeyType &key);
     bool isThere(const KeyType &key) const;
     std::vector<KeyType> getKeys() const;
@@ -16,6 +16,16 @@ ValueType Dictionary<KeyType, ValueType>::get(const KeyType &key) const
         throw std::runtime_error("Key not found in Dictionary!");
 }
 
+template <typename KeyType, typename ValueType>
+ValueType& Dictionary<KeyType, ValueType>::at(const KeyType &key)
+{
+    auto it = data.find(key);
+    if (it != data.end())
+        return it->second;
+    else
+        throw std::runtime_error("Key not found in Dictionary!");
+}
+
 template <typename KeyType, typename ValueType>
 void Dictionary<KeyType, ValueType>::remove(const KeyType &key)
 {
@@ -0,0 +1,35 @@
+#include "GreenWaveController.h"
+#include <algorithm>
+
+GreenWaveController::GreenWaveController(unsigned int cycleTime, double vMax, double brakeProb, size_t numberOfColumns)
+    : TrafficLightController(cycleTime), freeFlowSpeed(std::max(0.01, vMax - brakeProb)), numberOfColumns(std::max<size_t>(numberOfColumns, 1))
+{
+    if (cycleTime < 2)
+        throw std::invalid_argument("Green wave cycle time must be at least 2.");
+    phaseTime = cycleTime / 2;
+}
+
+void GreenWaveController::initialize()
+{
+    TrafficLightController::initialize();
+
+    //Delaying an intersection's cycle by its offset is a plan shifted by that offset
+    schedule.clear();
+    for (size_t i = 0; i < trafficLightGroups.size(); i++)
+        addTwoPhasePlans(*trafficLightGroups[i], cycleTime, calculateOffset(i), phaseTime);
+    schedule.applyAll(0);
+}
+
+unsigned int GreenWaveController::calculateOffset(size_t groupIndex) const
+{
+    const auto& group = trafficLightGroups[groupIndex];
+    if (group->trafficLights.empty())
+        return 0;
+
+    //Groups are laid out row by row, as written by settings_generator.py
+    size_t row = groupIndex / numberOfColumns;
+    size_t column = groupIndex % numberOfColumns;
+    double travelTime = group->trafficLights[0]->distanceToPreviousTrafficLight / freeFlowSpeed;
+
+    return static_cast<unsigned int>(std::llround((row + column) * travelTime) % cycleTime);
+}
@@ -0,0 +1,22 @@
+#ifndef GREEN_WAVE_CONTROLLER_H
+#define GREEN_WAVE_CONTROLLER_H
+
+#include "TrafficLightController.h"
+
+//Intersections switch with a common cycle, shifted by the free-flow travel time from
+//the grid origin, so a car leaving on green keeps meeting green lights downstream.
+class GreenWaveController : public TrafficLightController
+{
+public:
+    GreenWaveController(unsigned int cycleTime, double vMax, double brakeProb, size_t numberOfColumns);
+
+    void initialize() override;
+    unsigned int calculateOffset(size_t groupIndex) const;
+
+private:
+    double freeFlowSpeed;
+    size_t numberOfColumns;
+    unsigned int phaseTime;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#include "GroupCycleController.h"
+
+GroupCycleController::GroupCycleController()
+    : TrafficLightController(0) {}
+
+void GroupCycleController::initialize()
+{
+    TrafficLightController::initialize();
+
+    schedule.clear();
+    for (auto& group : trafficLightGroups)
+    {
+        auto plans = group->signalPlans();
+        for (size_t j = 0; j < plans.size(); ++j)
+            schedule.add(*group->trafficLights[j], plans[j]);
+    }
+    schedule.applyAll(0);
+}
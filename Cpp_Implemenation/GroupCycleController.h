@@ -0,0 +1,16 @@
+#ifndef GROUP_CYCLE_CONTROLLER_H
+#define GROUP_CYCLE_CONTROLLER_H
+
+#include "TrafficLightController.h"
+
+//Runs every group on its own fixed cycle (each light's timeOpen, then the group's
+//transition time), from the plans of TrafficLightGroup::signalPlans.
+class GroupCycleController : public TrafficLightController
+{
+public:
+    GroupCycleController();
+
+    void initialize() override;
+};
+
+#endif
@@ -0,0 +1,348 @@
+#include "JamTracker.h"
+#include <algorithm>
+#include <stdexcept>
+
+JamTracker::JamTracker() : roadSize(0), isPeriodic(false), isSparse(false), nextJamID(0), currentStep(0)
+{
+}
+
+void JamTracker::setup(int roadSize, bool isPeriodic, bool isSparse)
+{
+    this->roadSize = roadSize;
+    this->isPeriodic = isPeriodic;
+    this->isSparse = isSparse;
+    runOfCell.clear();
+    sparseRunOfCell.clear();
+    if (!isSparse)
+        runOfCell.assign(roadSize, noRun);
+    runs.clear();
+    freeRuns.clear();
+    pendingStops.clear();
+    pendingMoves.clear();
+}
+
+void JamTracker::markStopped(int cell)
+{
+    if (runAt(cell) == noRun)
+    {
+        setRun(cell, pendingStop);
+        pendingStops.push_back(cell);
+    }
+}
+
+void JamTracker::markMoving(int cell)
+{
+    int run = runAt(cell);
+    if (run >= 0)
+        pendingMoves.push_back(cell);
+    else if (run == pendingStop)
+        setRun(cell, noRun);
+}
+
+void JamTracker::endStep(unsigned long long step)
+{
+    currentStep = step;
+    for (int cell : pendingStops)
+    {
+        if (runAt(cell) == pendingStop)
+            addCell(cell);
+    }
+    for (int cell : pendingMoves)
+    {
+        if (runAt(cell) >= 0)
+            removeCell(cell);
+    }
+    pendingStops.clear();
+    pendingMoves.clear();
+}
+
+int JamTracker::runAt(int cell) const
+{
+    if (!isSparse)
+        return runOfCell[cell];
+    auto it = sparseRunOfCell.find(cell);
+    return it != sparseRunOfCell.end() ? it->second : noRun;
+}
+
+void JamTracker::setRun(int cell, int run)
+{
+    if (!isSparse)
+        runOfCell[cell] = run;
+    else if (run != noRun)
+        sparseRunOfCell[cell] = run;
+    else
+        sparseRunOfCell.erase(cell);
+}
+
+int JamTracker::previousCell(int cell) const
+{
+    if (cell > 0)
+        return cell - 1;
+    return isPeriodic ? roadSize - 1 : -1;
+}
+
+int JamTracker::nextCell(int cell) const
+{
+    if (cell < roadSize - 1)
+        return cell + 1;
+    return isPeriodic ? 0 : -1;
+}
+
+int JamTracker::newRun(int back, int front, int size)
+{
+    int index;
+    if (freeRuns.empty())
+    {
+        index = static_cast<int>(runs.size());
+        runs.emplace_back();
+    }
+    else
+    {
+        index = freeRuns.back();
+        freeRuns.pop_back();
+    }
+    runs[index] = Run{back, front, size, false, Jam{}};
+    return index;
+}
+
+void JamTracker::relabel(int back, int size, int run)
+{
+    int cell = back;
+    for (int i = 0; i < size; i++)
+    {
+        setRun(cell, run);
+        cell = nextCell(cell);
+    }
+}
+
+void JamTracker::addCell(int cell)
+{
+    int previous = previousCell(cell);
+    int next = nextCell(cell);
+    int left = previous >= 0 ? runAt(previous) : noRun;
+    int right = next >= 0 ? runAt(next) : noRun;
+
+    int run;
+    if (left < 0 && right < 0)
+        run = newRun(cell, cell, 0);
+    else if (right < 0)
+    {
+        run = left;
+        runs[run].front = cell;
+    }
+    else if (left < 0)
+    {
+        run = right;
+        runs[run].back = cell;
+    }
+    else if (left == right)
+    {
+        //The last free cell of a ring
+        run = left;
+        runs[run].front = cell;
+    }
+    else
+    {
+        //Bridging two runs: the larger one keeps its slot, the older jam keeps its identity
+        run = runs[left].size >= runs[right].size ? left : right;
+        int other = run == left ? right : left;
+        Run& kept = runs[run];
+        Run& absorbed = runs[other];
+
+        if (absorbed.isJam && (!kept.isJam || absorbed.jam.id < kept.jam.id))
+        {
+            std::swap(kept.jam, absorbed.jam);
+            std::swap(kept.isJam, absorbed.isJam);
+        }
+        if (absorbed.isJam)
+            endJam(absorbed);
+        if (kept.isJam)
+            kept.jam.maxSize = std::max(kept.jam.maxSize, kept.size + absorbed.size);
+
+        relabel(absorbed.back, absorbed.size, run);
+        kept.size += absorbed.size;
+        kept.back = runs[left].back;
+        kept.front = runs[right].front;
+        absorbed.size = 0;
+        freeRuns.push_back(other);
+    }
+
+    setRun(cell, run);
+    runs[run].size++;
+    updateJam(runs[run]);
+}
+
+void JamTracker::removeCell(int cell)
+{
+    int index = runAt(cell);
+    setRun(cell, noRun);
+    Run& run = runs[index];
+
+    if (run.size == 1)
+    {
+        run.size = 0;
+        freeRuns.push_back(index);
+        return;
+    }
+
+    if (run.size == roadSize)
+    {
+        //A full ring opens at the cell that was freed
+        run.back = nextCell(cell);
+        run.front = previousCell(cell);
+        run.size--;
+    }
+    else if (cell == run.back)
+    {
+        run.back = nextCell(cell);
+        run.size--;
+    }
+    else if (cell == run.front)
+    {
+        run.front = previousCell(cell);
+        run.size--;
+    }
+    else
+    {
+        //Split: the smaller part moves to a new run, which starts as a new jam if long enough
+        int frontBack = nextCell(cell);
+        int frontSize = (run.front - frontBack + roadSize) % roadSize + 1;
+        int backSize = run.size - 1 - frontSize;
+        int split;
+        if (frontSize > backSize)
+        {
+            split = newRun(run.back, previousCell(cell), backSize);
+            Run& moved = runs[split];
+            Run& kept = runs[index];
+            relabel(moved.back, moved.size, split);
+            kept.back = frontBack;
+            kept.size = frontSize;
+        }
+        else
+        {
+            split = newRun(frontBack, run.front, frontSize);
+            Run& moved = runs[split];
+            Run& kept = runs[index];
+            relabel(moved.back, moved.size, split);
+            kept.front = previousCell(cell);
+            kept.size = backSize;
+        }
+        updateJam(runs[split]);
+    }
+
+    Run& shrunk = runs[index];
+    if (shrunk.isJam && shrunk.size < minJamSize)
+        endJam(shrunk);
+}
+
+void JamTracker::updateJam(Run& run)
+{
+    if (!run.isJam && run.size >= minJamSize)
+    {
+        run.isJam = true;
+        run.jam = Jam{nextJamID++, currentStep, 0, 0, 0, run.size};
+    }
+    if (run.isJam)
+        run.jam.maxSize = std::max(run.jam.maxSize, run.size);
+}
+
+void JamTracker::endJam(Run& run)
+{
+    lifetimes.record(currentStep - run.jam.birth);
+    sizes.record(run.jam.maxSize);
+    run.isJam = false;
+}
+
+std::vector<JamTracker::Jam> JamTracker::activeJams() const
+{
+    std::vector<Jam> jams;
+    for (const auto& run : runs)
+    {
+        if (run.size == 0 || !run.isJam)
+            continue;
+
+        Jam jam = run.jam;
+        jam.back = run.back;
+        jam.front = run.front;
+        jam.size = run.size;
+        jams.push_back(jam);
+    }
+    std::sort(jams.begin(), jams.end(), [](const Jam& a, const Jam& b) { return a.id < b.id; });
+    return jams;
+}
+
+std::vector<std::pair<int, int>> JamTracker::stoppedRuns() const
+{
+    std::vector<std::pair<int, int>> stopped;
+    for (const auto& run : runs)
+    {
+        if (run.size > 0)
+            stopped.push_back({run.back, run.size});
+    }
+    std::sort(stopped.begin(), stopped.end());
+    return stopped;
+}
+
+unsigned long long JamTracker::jamsStarted() const
+{
+    return nextJamID;
+}
+
+void JamTracker::resetStatistics()
+{
+    lifetimes.clear();
+    sizes.clear();
+}
+
+void JamTracker::saveState(ByteWriter& output) const
+{
+    output.writeVarint(nextJamID);
+    lifetimes.saveState(output);
+    sizes.saveState(output);
+
+    size_t numRuns = std::count_if(runs.begin(), runs.end(), [](const Run& run) { return run.size > 0; });
+    output.writeVarint(numRuns);
+    for (const auto& run : runs)
+    {
+        if (run.size == 0)
+            continue;
+
+        output.writeVarint(run.back);
+        output.writeVarint(run.size);
+        output.writeByte(run.isJam ? 1 : 0);
+        if (run.isJam)
+        {
+            output.writeVarint(run.jam.id);
+            output.writeVarint(run.jam.birth);
+            output.writeVarint(run.jam.maxSize);
+        }
+    }
+}
+
+void JamTracker::loadState(ByteReader& input)
+{
+    setup(roadSize, isPeriodic, isSparse);
+    nextJamID = input.readVarint();
+    lifetimes.loadState(input);
+    sizes.loadState(input);
+
+    size_t numRuns = input.readVarint();
+    for (size_t i = 0; i < numRuns; i++)
+    {
+        int back = static_cast<int>(input.readVarint());
+        int size = static_cast<int>(input.readVarint());
+        if (back >= roadSize || size < 1 || size > roadSize)
+            throw std::runtime_error("Invalid stopped-car run in checkpoint.");
+
+        int index = newRun(back, (back + size - 1) % roadSize, size);
+        relabel(back, size, index);
+        if (input.readByte() == 1)
+        {
+            Run& run = runs[index];
+            run.isJam = true;
+            run.jam.id = input.readVarint();
+            run.jam.birth = input.readVarint();
+            run.jam.maxSize = static_cast<int>(input.readVarint());
+        }
+    }
+}
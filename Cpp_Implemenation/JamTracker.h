@@ -0,0 +1,82 @@
+#ifndef JAM_TRACKER_H
+#define JAM_TRACKER_H
+
+#include <vector>
+#include <unordered_map>
+#include "LogHistogram.h"
+#include "ByteStream.h"
+
+//Runs of adjacent cells holding stopped cars, updated only when a car stops or starts.
+//Changes reported during a step are applied together at its end, stops before starts,
+//so a jam that gains a car at the back while losing its front car keeps its identity.
+//A car that stops and then moves on within one step (after a lane change, or on the last
+//cell of an open road) cancels its pending stop.
+//A run of at least minJamSize cars is a jam with a stable ID. When two jams merge the
+//older one survives; when a jam splits the larger part keeps the ID.
+class JamTracker
+{
+public:
+    static constexpr int minJamSize = 3;
+
+    struct Jam
+    {
+        unsigned long long id;
+        unsigned long long birth; //Step at whose end the run first reached minJamSize
+        int back; //Upstream cell
+        int front; //Downstream cell, below back if the jam wraps around a ring
+        int size;
+        int maxSize;
+    };
+
+    LogHistogram lifetimes; //Steps each ended jam existed
+    LogHistogram sizes; //Largest size of each ended jam
+
+    JamTracker();
+    void setup(int roadSize, bool isPeriodic, bool isSparse = false);
+    void markStopped(int cell);
+    void markMoving(int cell);
+    void endStep(unsigned long long step);
+    std::vector<Jam> activeJams() const;
+    std::vector<std::pair<int, int>> stoppedRuns() const; //(back, size) of every run, by back cell
+    unsigned long long jamsStarted() const;
+    void resetStatistics();
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
+
+private:
+    struct Run
+    {
+        int back;
+        int front;
+        int size;
+        bool isJam;
+        Jam jam;
+    };
+
+    int roadSize;
+    bool isPeriodic;
+    bool isSparse;
+    static constexpr int noRun = -1;
+    static constexpr int pendingStop = -2; //Stopped during this step, not in a run yet
+    std::vector<int> runOfCell; //noRun for cells without a stopped car
+    std::unordered_map<int, int> sparseRunOfCell; //Replaces runOfCell on a sparse road, stopped and pending cells only
+    std::vector<Run> runs;
+    std::vector<int> freeRuns;
+    std::vector<int> pendingStops;
+    std::vector<int> pendingMoves;
+    unsigned long long nextJamID;
+    unsigned long long currentStep;
+
+    int runAt(int cell) const;
+    void setRun(int cell, int run);
+    int previousCell(int cell) const; //-1 past the start of an open road
+    int nextCell(int cell) const; //-1 past the end of an open road
+    int newRun(int back, int front, int size);
+    void relabel(int back, int size, int run);
+    void addCell(int cell);
+    void removeCell(int cell);
+    void updateJam(Run& run);
+    void endJam(Run& run);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "JsonResultsWriter.h"
+#include <filesystem>
+
+namespace
+{
+    //Pretty-printed JSON nested at some depth: every line after the first gets the indent of that depth
+    void appendIndented(std::string& output, const std::string& text, const std::string& indent)
+    {
+        for (char c : text)
+        {
+            output += c;
+            if (c == '\n')
+                output += indent;
+        }
+    }
+}
+
+JsonResultsWriter::JsonResultsWriter() : bytesWritten(0), numEpisodes(0)
+{
+}
+
+void JsonResultsWriter::open(const std::string& path)
+{
+    this->path = path;
+    file.open(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open file for serialization: " + path);
+
+    buffer += "{\n    \"episodes\": [";
+    flushBuffer();
+}
+
+void JsonResultsWriter::record(const nlohmann::json& episodeData)
+{
+    buffer += (numEpisodes == 0) ? "\n        " : ",\n        ";
+    appendIndented(buffer, episodeData.dump(4), "        ");
+    numEpisodes++;
+
+    if (buffer.size() >= (1 << 20))
+        flushBuffer();
+}
+
+void JsonResultsWriter::flushBuffer()
+{
+    file.write(buffer.data(), buffer.size());
+    bytesWritten += buffer.size();
+    buffer.clear();
+}
+
+void JsonResultsWriter::flush()
+{
+    if (file.is_open())
+    {
+        flushBuffer();
+        file.flush();
+    }
+}
+
+void JsonResultsWriter::close(const nlohmann::json& results)
+{
+    if (!file.is_open())
+        return;
+
+    buffer += (numEpisodes == 0) ? "]" : "\n    ]";
+    for (const auto& [key, value] : results.items())
+    {
+        if (key == "episodes")
+            continue;
+        buffer += ",\n    " + nlohmann::json(key).dump() + ": ";
+        appendIndented(buffer, value.dump(4), "    ");
+    }
+    buffer += "\n}\n";
+    flushBuffer();
+    file.close();
+}
+
+const std::string& JsonResultsWriter::getPath() const
+{
+    return path;
+}
+
+void JsonResultsWriter::saveState(ByteWriter& output) const
+{
+    //Expects flush() beforehand, so everything up to bytesWritten is on disk
+    output.writeString(path);
+    output.writeVarint(bytesWritten);
+    output.writeVarint(numEpisodes);
+}
+
+void JsonResultsWriter::resume(ByteReader& input)
+{
+    path = input.readString();
+    bytesWritten = input.readVarint();
+    numEpisodes = input.readVarint();
+
+    //Drop episodes written after the checkpoint was taken
+    std::filesystem::resize_file(path, bytesWritten);
+    file.open(path, std::ios::binary | std::ios::app);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to reopen results file: " + path);
+}
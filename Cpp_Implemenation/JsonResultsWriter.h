@@ -0,0 +1,35 @@
+#ifndef JSON_RESULTS_WRITER_H
+#define JSON_RESULTS_WRITER_H
+
+#include <string>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include "ByteStream.h"
+
+//Appends the per-episode JSON of Simulation::collectMetrics to the results file as it is
+//collected, so neither memory nor a checkpoint grows with the number of episodes. close()
+//writes the remaining keys of the results, giving the same document as dumping them at
+//once with an indent of 4, except that "episodes" comes first.
+class JsonResultsWriter
+{
+public:
+    JsonResultsWriter();
+    void open(const std::string& path);
+    void record(const nlohmann::json& episodeData);
+    void flush();
+    void close(const nlohmann::json& results);
+    const std::string& getPath() const;
+    void saveState(ByteWriter& output) const;
+    void resume(ByteReader& input);
+
+private:
+    std::string path;
+    std::ofstream file;
+    std::string buffer;
+    unsigned long long bytesWritten;
+    unsigned long long numEpisodes;
+
+    void flushBuffer();
+};
+
+#endif
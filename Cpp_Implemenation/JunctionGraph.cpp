@@ -0,0 +1,64 @@
+#include "JunctionGraph.h"
+#include "Road.h"
+#include <stdexcept>
+
+JunctionGraph::JunctionGraph(const std::vector<std::shared_ptr<Road>>& roadList)
+{
+    roads.reserve(roadList.size());
+    for (size_t r = 0; r < roadList.size(); r++)
+    {
+        if (roadList[r]->roadID != static_cast<int>(r))
+            throw std::runtime_error("Junction graph needs roads stored in roadID order.");
+        roads.push_back(roadList[r].get());
+    }
+
+    connectionOffsets.assign(1, 0);
+    turnEnds.clear();
+    connectionData.clear();
+    std::vector<Connection> sameRoad;
+    for (const auto& road : roadList)
+    {
+        for (RoadSection* section : road->wiredSections())
+        {
+            section->junctionIndex = -1;
+            if (!section->isSharedSection)
+                continue;
+
+            section->junctionIndex = static_cast<int>(turnEnds.size());
+            sameRoad.clear();
+            for (const auto& weakSection : section->connectedSections)
+            {
+                auto otherSection = weakSection.lock();
+                auto otherRoad = otherSection ? otherSection->road.lock() : nullptr;
+                if (!otherRoad)
+                    continue;
+
+                if (otherRoad->roadID == road->roadID)
+                    sameRoad.push_back(Connection{otherRoad->roadID, otherSection->index});
+                else
+                    connectionData.push_back(Connection{otherRoad->roadID, otherSection->index});
+            }
+            turnEnds.push_back(connectionData.size());
+            connectionData.insert(connectionData.end(), sameRoad.begin(), sameRoad.end());
+            connectionOffsets.push_back(connectionData.size());
+        }
+    }
+}
+
+int JunctionGraph::cellIndex(int roadID, int cell) const
+{
+    const RoadSection* section = roads[roadID]->sectionAt(cell);
+    return section ? section->junctionIndex : -1;
+}
+
+JunctionGraph::Range JunctionGraph::connections(int roadID, int cell) const
+{
+    int index = cellIndex(roadID, cell);
+    return index >= 0 ? connections(index) : Range{nullptr, nullptr};
+}
+
+JunctionGraph::Range JunctionGraph::turns(int roadID, int cell) const
+{
+    int index = cellIndex(roadID, cell);
+    return index >= 0 ? turns(index) : Range{nullptr, nullptr};
+}
@@ -0,0 +1,61 @@
+#ifndef JUNCTION_GRAPH_H
+#define JUNCTION_GRAPH_H
+
+#include <vector>
+#include <memory>
+
+class Road;
+
+//Shared-section wiring of the network compiled into flat arrays once the topology is final.
+//Every shared section gets an index, stored in its RoadSection::junctionIndex; the cells wired
+//to section i are connections [connectionOffsets[i], connectionOffsets[i+1]), those on other
+//roads first and in wiring order, so the first turnEnds[i] - connectionOffsets[i] are the turns
+//a car can take there. Only shared sections are indexed, so the arrays do not grow with road
+//length. Occupancy checks and turn choices read (road, cell) integers instead of locking the
+//weak pointers of RoadSection::connectedSections.
+class JunctionGraph
+{
+public:
+    struct Connection
+    {
+        int roadID;
+        int cell;
+    };
+
+    struct Range
+    {
+        const Connection* first;
+        const Connection* last;
+
+        const Connection* begin() const { return first; }
+        const Connection* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+        const Connection& operator[](size_t i) const { return first[i]; }
+    };
+
+    explicit JunctionGraph(const std::vector<std::shared_ptr<Road>>& roads);
+
+    int cellIndex(int roadID, int cell) const; //-1 for a cell that is not a shared section
+    Range connections(int index) const
+    {
+        return Range{connectionData.data() + connectionOffsets[index], connectionData.data() + connectionOffsets[index + 1]};
+    }
+    Range turns(int index) const
+    {
+        return Range{connectionData.data() + connectionOffsets[index], connectionData.data() + turnEnds[index]};
+    }
+    Range connections(int roadID, int cell) const;
+    Range turns(int roadID, int cell) const;
+    Road* road(int roadID) const { return roads[roadID]; }
+    size_t numCells() const { return turnEnds.size(); } //Shared sections indexed
+    size_t numConnections() const { return connectionData.size(); }
+
+private:
+    std::vector<Road*> roads; //Indexed by roadID
+    std::vector<size_t> connectionOffsets;
+    std::vector<size_t> turnEnds;
+    std::vector<Connection> connectionData;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "LaneGroup.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    constexpr int noCar = std::numeric_limits<int>::max() / 4;
+}
+
+LaneGroup::LaneGroup(std::vector<std::shared_ptr<Road>> lanes, const nlohmann::json& settings)
+    : lanes(std::move(lanes)), changesLeft(0), changesRight(0), stepChanges(0)
+{
+    if (this->lanes.size() < 2)
+        throw std::invalid_argument("A lane group needs at least two lanes.");
+
+    roadSize = this->lanes[0]->roadSize;
+    isPeriodic = this->lanes[0]->isPeriodic;
+    for (const auto& lane : this->lanes)
+    {
+        if (lane->roadSize != roadSize || lane->isPeriodic != isPeriodic)
+            throw std::invalid_argument("Lanes of road " + std::to_string(this->lanes[0]->roadID) + " differ in size or boundary.");
+    }
+
+    rule = parseRule(settings.value("rule", "symmetric"));
+    probability = settings.value("probability", 1.0);
+    lookBack = settings.value("lookBack", this->lanes[0]->maxSpeed);
+
+    laneCars.resize(this->lanes.size());
+}
+
+LaneGroup::Rule LaneGroup::parseRule(const std::string& name)
+{
+    if (name == "symmetric")
+        return Rule::Symmetric;
+    if (name == "asymmetric")
+        return Rule::Asymmetric;
+    throw std::invalid_argument("Unknown lane change rule: " + name);
+}
+
+void LaneGroup::sortLane(size_t lane)
+{
+    //carsPositions runs mostly downstream to upstream, so it is reversed before sorting
+    const auto& positions = lanes[lane]->carsPositions;
+    auto& cars = laneCars[lane];
+    cars.clear();
+    for (size_t i = positions.size(); i-- > 0;)
+        cars.push_back({positions[i], static_cast<int>(i)});
+    std::sort(cars.begin(), cars.end());
+}
+
+int LaneGroup::carAtOrAfter(const std::vector<std::pair<int, int>>& cars, size_t k) const
+{
+    //On a ring the search continues with the first car of the next lap
+    if (k < cars.size())
+        return cars[k].first;
+    return (isPeriodic && !cars.empty()) ? cars.front().first + roadSize : noCar;
+}
+
+int LaneGroup::carBefore(const std::vector<std::pair<int, int>>& cars, size_t k) const
+{
+    if (k > 0)
+        return cars[k - 1].first;
+    return (isPeriodic && !cars.empty()) ? cars.back().first - roadSize : -noCar;
+}
+
+void LaneGroup::chooseTargets(int lane)
+{
+    const Road& road = *lanes[lane];
+    const auto& cars = laneCars[lane];
+    int numLanes = static_cast<int>(lanes.size());
+    targets.assign(road.carsPositions.size(), -1);
+
+    //One cursor per neighbour lane advances with the cell, so the pass is linear in the cars
+    size_t cursors[2] = {0, 0};
+    for (size_t k = 0; k < cars.size(); k++)
+    {
+        int cell = cars[k].first;
+        const auto& car = road.carAt(cell);
+        //Cars inside a junction or committed to a turn keep their lane
+        if (!car || car->willChangeRoad || road.isSharedCell(cell))
+            continue;
+
+        int hope = std::min(car->speed + 1, road.maxSpeed);
+        int gap = carAtOrAfter(cars, k + 1) - cell - 1;
+
+        int best = -1;
+        int bestGap = -1;
+        for (int side : {1, -1})
+        {
+            int target = lane + side;
+            if (target < 0 || target >= numLanes)
+                continue;
+
+            const auto& targetCars = laneCars[target];
+            size_t& cursor = cursors[side > 0 ? 0 : 1];
+            while (cursor < targetCars.size() && targetCars[cursor].first < cell)
+                cursor++;
+            if (cursor < targetCars.size() && targetCars[cursor].first == cell)
+                continue;
+
+            int targetGap = carAtOrAfter(targetCars, cursor) - cell - 1;
+            int targetBack = cell - carBefore(targetCars, cursor) - 1;
+            if (targetBack < lookBack)
+                continue;
+
+            bool wanted;
+            if (rule == Rule::Asymmetric && side < 0)
+                wanted = gap >= hope && targetGap >= hope;
+            else
+                wanted = gap < hope && targetGap > gap;
+
+            if (wanted && targetGap > bestGap)
+            {
+                best = target;
+                bestGap = targetGap;
+            }
+        }
+        targets[cars[k].second] = best;
+    }
+}
+
+void LaneGroup::changeLanes(RandomNumberGenerator& rng)
+{
+    for (size_t lane = 0; lane < lanes.size(); lane++)
+        sortLane(lane);
+
+    //Targets are chosen in cell order, but drawn and listed in carsPositions order
+    moves.clear();
+    for (int lane = 0; lane < static_cast<int>(lanes.size()); lane++)
+    {
+        chooseTargets(lane);
+        const auto& positions = lanes[lane]->carsPositions;
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            if (targets[i] >= 0 && (probability >= 1.0 || rng.getRandomDouble() < probability))
+                moves.push_back(Move{lane, positions[i], targets[i]});
+        }
+    }
+
+    //Two cars can pick the same free cell from both sides; the first one listed takes it
+    stepChanges = 0;
+    for (const auto& move : moves)
+    {
+        if (lanes[move.target]->carAt(move.cell))
+            continue;
+        moveCar(move);
+        stepChanges++;
+        if (move.target > move.lane)
+            changesLeft++;
+        else
+            changesRight++;
+    }
+
+    //Cells left by a car stay free for the rest of the pass, so the lanes drop them in one sweep
+    if (stepChanges > 0)
+    {
+        for (auto& lane : lanes)
+        {
+            auto& positions = lane->carsPositions;
+            positions.erase(std::remove_if(positions.begin(), positions.end(), [&lane](int cell) { return !lane->carAt(cell); }), positions.end());
+        }
+    }
+}
+
+void LaneGroup::moveCar(const Move& move)
+{
+    Road& from = *lanes[move.lane];
+    Road& to = *lanes[move.target];
+
+    auto car = from.carAt(move.cell);
+    from.clearCell(move.cell);
+    from.jamTracker.markMoving(move.cell);
+
+    to.placeCar(move.cell, car);
+    to.trackCar(*car, move.cell);
+    to.carsPositions.push_back(move.cell); //Like a car arriving from another road; the lane sorts it on its next step
+}
+
+nlohmann::json LaneGroup::episodeMetrics() const
+{
+    size_t numCars = 0;
+    double speedSum = 0.0;
+    std::vector<int> flow;
+    for (const auto& lane : lanes)
+    {
+        numCars += lane->carsPositions.size();
+        for (int position : lane->carsPositions)
+            speedSum += lane->carAt(position)->speed;
+
+        //Lanes share the detector cells of lane 0, so flows add up detector by detector
+        flow.resize(std::max(flow.size(), lane->flowAtPoints.size()), 0);
+        for (size_t detector = 0; detector < lane->flowAtPoints.size(); detector++)
+            flow[detector] += lane->flowAtPoints[detector];
+    }
+
+    nlohmann::json flowData = nlohmann::json::array();
+    for (size_t detector = 0; detector < flow.size() && detector < lanes[0]->timeHeadwayAndFlowPoints.size(); detector++)
+        flowData.push_back({{"pointIndex", lanes[0]->timeHeadwayAndFlowPoints[detector]}, {"flow", flow[detector]}});
+
+    nlohmann::json data;
+    data["roadID"] = lanes[0]->roadID;
+    data["generalDensity"] = static_cast<double>(numCars) / (static_cast<double>(roadSize) * lanes.size());
+    data["averageSpeed"] = numCars > 0 ? speedSum / numCars : 0.0;
+    data["numCars"] = numCars;
+    data["flow"] = flowData;
+    data["laneChanges"] = stepChanges;
+    return data;
+}
+
+nlohmann::json LaneGroup::summary() const
+{
+    nlohmann::json laneIDs = nlohmann::json::array();
+    for (const auto& lane : lanes)
+        laneIDs.push_back(lane->roadID);
+
+    nlohmann::json data;
+    data["roadID"] = lanes[0]->roadID;
+    data["lanes"] = laneIDs;
+    data["rule"] = rule == Rule::Symmetric ? "symmetric" : "asymmetric";
+    data["laneChangesLeft"] = changesLeft;
+    data["laneChangesRight"] = changesRight;
+    return data;
+}
+
+void LaneGroup::saveState(ByteWriter& output) const
+{
+    output.writeVarint(changesLeft);
+    output.writeVarint(changesRight);
+    output.writeVarint(stepChanges);
+}
+
+void LaneGroup::loadState(ByteReader& input)
+{
+    changesLeft = input.readVarint();
+    changesRight = input.readVarint();
+    stepChanges = static_cast<int>(input.readVarint());
+}
@@ -0,0 +1,70 @@
+#ifndef LANE_GROUP_H
+#define LANE_GROUP_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "Road.h"
+#include "RandomNumberGenerator.h"
+#include "ByteStream.h"
+
+//The lanes of one multi-lane road. Lane 0 is the road as configured and the rightmost lane;
+//the others are Roads of the same shape that share its lights and junctions, so each lane is
+//its own contiguous strip of cells and keeps the per-road metrics. changeLanes is the sideways
+//sub-step of the two-lane NaSch model (Rickert et al.), applied to all lanes before their
+//forward update: decisions are taken on the state at the start of the pass, by walking the
+//cars of each lane in cell order alongside those of its neighbours, and carried out afterwards.
+//
+//Symmetric rule: a car hindered on its lane (gap below min(v + 1, vMax)) moves to a neighbour
+//lane with a larger gap ahead. Asymmetric rule: the same towards the left, and back to the
+//right once neither lane would hinder it. Either way the cell must be free, the gap behind on
+//the target lane at least lookBack, and the change happens with the configured probability.
+class LaneGroup
+{
+public:
+    enum class Rule
+    {
+        Symmetric,
+        Asymmetric
+    };
+
+    std::vector<std::shared_ptr<Road>> lanes; //By lane index
+    unsigned long long changesLeft; //Moves towards a higher lane index
+    unsigned long long changesRight;
+    int stepChanges; //Moves in the last pass
+
+    LaneGroup(std::vector<std::shared_ptr<Road>> lanes, const nlohmann::json& settings);
+    void changeLanes(RandomNumberGenerator& rng);
+    nlohmann::json episodeMetrics() const; //The road as a whole: lanes pooled
+    nlohmann::json summary() const;
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
+
+    static Rule parseRule(const std::string& name);
+
+private:
+    struct Move
+    {
+        int lane;
+        int cell;
+        int target;
+    };
+
+    Rule rule;
+    double probability;
+    int lookBack;
+    int roadSize;
+    bool isPeriodic;
+    std::vector<std::vector<std::pair<int, int>>> laneCars; //Per lane: cell and carsPositions index of each car, by cell
+    std::vector<int> targets; //Per carsPositions index of the lane being decided: lane to move to, -1 to stay
+    std::vector<Move> moves;
+
+    void sortLane(size_t lane);
+    void chooseTargets(int lane);
+    int carAtOrAfter(const std::vector<std::pair<int, int>>& cars, size_t k) const;
+    int carBefore(const std::vector<std::pair<int, int>>& cars, size_t k) const;
+    void moveCar(const Move& move);
+};
+
+#endif
@@ -16,6 +16,9 @@ public:
     T back() const;
     bool empty() const;
     size_t size() const;
+    size_t capacity() const;
+    unsigned long long totalPushed() const; //Number of values pushed since construction
+    void restore(const std::deque<T>& values, unsigned long long totalPushed);
 
     using iterator = typename std::deque<T>::iterator;
     using const_iterator = typename std::deque<T>::const_iterator;
@@ -27,6 +30,7 @@ public:
 
 private:
     size_t maxSize_;
+    unsigned long long totalPushed_;
     std::deque<T> queue_;
 };
 
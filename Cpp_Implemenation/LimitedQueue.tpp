@@ -4,7 +4,7 @@
 #include "LimitedQueue.h"
 
 template <typename T>
-LimitedQueue<T>::LimitedQueue(size_t maxSize) : maxSize_(maxSize) {}
+LimitedQueue<T>::LimitedQueue(size_t maxSize) : maxSize_(maxSize), totalPushed_(0) {}
 
 template <typename T>
 void LimitedQueue<T>::push(const T& value)
@@ -14,6 +14,7 @@ void LimitedQueue<T>::push(const T& value)
         queue_.pop_front();
     }
     queue_.push_back(value);
+    totalPushed_++;
 }
 
 template <typename T>
@@ -48,6 +49,27 @@ size_t LimitedQueue<T>::size() const
     return queue_.size();
 }
 
+template <typename T>
+size_t LimitedQueue<T>::capacity() const
+{
+    return maxSize_;
+}
+
+template <typename T>
+unsigned long long LimitedQueue<T>::totalPushed() const
+{
+    return totalPushed_;
+}
+
+template <typename T>
+void LimitedQueue<T>::restore(const std::deque<T>& values, unsigned long long totalPushed)
+{
+    if (values.size() > maxSize_)
+        throw std::runtime_error("Restored queue is larger than its capacity");
+    queue_ = values;
+    totalPushed_ = totalPushed;
+}
+
 template <typename T>
 typename LimitedQueue<T>::iterator LimitedQueue<T>::begin()
 {
@@ -0,0 +1,214 @@
+#include "LogHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    constexpr unsigned long long exactBuckets = 1ULL << LogHistogram::precisionBits;
+    constexpr unsigned long long halfBuckets = exactBuckets / 2;
+
+    int highestBit(unsigned long long value)
+    {
+        int bit = 0;
+        while (value >>= 1)
+            bit++;
+        return bit;
+    }
+}
+
+LogHistogram::LogHistogram() : total(0), minValue(std::numeric_limits<unsigned long long>::max()), maxValue(0), sum(0.0)
+{
+}
+
+size_t LogHistogram::bucketIndex(unsigned long long value)
+{
+    if (value < exactBuckets)
+        return static_cast<size_t>(value);
+
+    //Keep the top precisionBits bits: the mantissa lies in [halfBuckets, exactBuckets)
+    int shift = highestBit(value) - precisionBits + 1;
+    return static_cast<size_t>(shift * halfBuckets + (value >> shift));
+}
+
+unsigned long long LogHistogram::bucketLowerBound(size_t index)
+{
+    if (index < exactBuckets)
+        return index;
+
+    unsigned long long shift = index / halfBuckets - 1;
+    return (index - shift * halfBuckets) << shift;
+}
+
+unsigned long long LogHistogram::bucketUpperBound(size_t index)
+{
+    if (index < exactBuckets)
+        return index;
+
+    unsigned long long shift = index / halfBuckets - 1;
+    return bucketLowerBound(index) + ((1ULL << shift) - 1);
+}
+
+void LogHistogram::record(unsigned long long value)
+{
+    size_t index = bucketIndex(value);
+    if (index >= counts.size())
+        counts.resize(index + 1, 0);
+    counts[index]++;
+
+    total++;
+    sum += static_cast<double>(value);
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+}
+
+void LogHistogram::merge(const LogHistogram& other)
+{
+    if (other.counts.size() > counts.size())
+        counts.resize(other.counts.size(), 0);
+    for (size_t i = 0; i < other.counts.size(); i++)
+        counts[i] += other.counts[i];
+
+    total += other.total;
+    sum += other.sum;
+    minValue = std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+}
+
+void LogHistogram::clear()
+{
+    *this = LogHistogram();
+}
+
+unsigned long long LogHistogram::count() const
+{
+    return total;
+}
+
+unsigned long long LogHistogram::min() const
+{
+    return total > 0 ? minValue : 0;
+}
+
+unsigned long long LogHistogram::max() const
+{
+    return maxValue;
+}
+
+double LogHistogram::mean() const
+{
+    return total > 0 ? sum / total : 0.0;
+}
+
+unsigned long long LogHistogram::quantile(double q) const
+{
+    if (total == 0)
+        return 0;
+    if (q <= 0.0)
+        return minValue;
+    if (q >= 1.0)
+        return maxValue;
+
+    unsigned long long rank = std::max(1ULL, static_cast<unsigned long long>(std::ceil(q * total)));
+    unsigned long long seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            //Midpoint of the bucket, which never lies outside the observed range
+            unsigned long long lower = bucketLowerBound(i);
+            unsigned long long middle = lower + (bucketUpperBound(i) - lower) / 2;
+            return std::clamp(middle, minValue, maxValue);
+        }
+    }
+    return maxValue;
+}
+
+nlohmann::json LogHistogram::toJson() const
+{
+    nlohmann::json data;
+    data["count"] = total;
+    data["min"] = min();
+    data["max"] = max();
+    data["mean"] = mean();
+    data["sum"] = sum;
+    data["p50"] = quantile(0.5);
+    data["p90"] = quantile(0.9);
+    data["p95"] = quantile(0.95);
+    data["p99"] = quantile(0.99);
+    data["precisionBits"] = precisionBits;
+
+    nlohmann::json buckets = nlohmann::json::array();
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        if (counts[i] > 0)
+            buckets.push_back({i, counts[i]});
+    }
+    data["buckets"] = buckets; //[bucket index, count] pairs
+    return data;
+}
+
+LogHistogram LogHistogram::fromJson(const nlohmann::json& data)
+{
+    if (data.value("precisionBits", precisionBits) != precisionBits)
+        throw std::invalid_argument("Histogram was written with a different precision.");
+
+    LogHistogram histogram;
+    for (const auto& bucket : data.at("buckets"))
+    {
+        size_t index = bucket.at(0).get<size_t>();
+        if (index >= histogram.counts.size())
+            histogram.counts.resize(index + 1, 0);
+        histogram.counts[index] += bucket.at(1).get<unsigned long long>();
+        histogram.total += bucket.at(1).get<unsigned long long>();
+    }
+
+    if (histogram.total > 0)
+    {
+        histogram.minValue = data.value("min", 0ULL);
+        histogram.maxValue = data.value("max", 0ULL);
+        histogram.sum = data.value("sum", 0.0);
+    }
+    return histogram;
+}
+
+void LogHistogram::saveState(ByteWriter& output) const
+{
+    //Sparse: gaps between the non-empty buckets and their counts
+    size_t nonEmpty = std::count_if(counts.begin(), counts.end(), [](unsigned long long c) { return c > 0; });
+    output.writeVarint(nonEmpty);
+    size_t previous = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        if (counts[i] == 0)
+            continue;
+        output.writeVarint(i - previous);
+        output.writeVarint(counts[i]);
+        previous = i;
+    }
+    output.writeVarint(minValue);
+    output.writeVarint(maxValue);
+    output.writeDouble(sum);
+}
+
+void LogHistogram::loadState(ByteReader& input)
+{
+    clear();
+    size_t nonEmpty = input.readVarint();
+    size_t index = 0;
+    for (size_t i = 0; i < nonEmpty; i++)
+    {
+        index += input.readVarint();
+        if (index > bucketIndex(std::numeric_limits<unsigned long long>::max()))
+            throw std::runtime_error("Invalid histogram bucket in checkpoint.");
+        if (index >= counts.size())
+            counts.resize(index + 1, 0);
+        counts[index] = input.readVarint();
+        total += counts[index];
+    }
+    minValue = input.readVarint();
+    maxValue = input.readVarint();
+    sum = input.readDouble();
+}
@@ -0,0 +1,49 @@
+#ifndef LOG_HISTOGRAM_H
+#define LOG_HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "ByteStream.h"
+
+//Log-linear histogram of non-negative integer samples (HDR histogram layout).
+//Values below 2^precisionBits get a bucket each; above that, every power of two is split
+//into 2^(precisionBits-1) buckets, so quantiles are exact for small values and within
+//1/64 relative error otherwise. Memory only depends on the largest value seen, and two
+//histograms merge by adding their bucket counts.
+class LogHistogram
+{
+public:
+    static constexpr int precisionBits = 7;
+
+    LogHistogram();
+
+    void record(unsigned long long value);
+    void merge(const LogHistogram& other);
+    void clear();
+
+    unsigned long long count() const;
+    unsigned long long min() const;
+    unsigned long long max() const;
+    double mean() const;
+    unsigned long long quantile(double q) const;
+
+    nlohmann::json toJson() const; //Summary plus the non-empty buckets
+    static LogHistogram fromJson(const nlohmann::json& data);
+
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
+
+    static size_t bucketIndex(unsigned long long value);
+    static unsigned long long bucketLowerBound(size_t index);
+    static unsigned long long bucketUpperBound(size_t index);
+
+private:
+    std::vector<unsigned long long> counts;
+    unsigned long long total;
+    unsigned long long minValue;
+    unsigned long long maxValue;
+    double sum;
+};
+
+#endif
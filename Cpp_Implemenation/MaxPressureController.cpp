@@ -0,0 +1,95 @@
+#include "MaxPressureController.h"
+#include "Checkpoint.h"
+#include <algorithm>
+
+MaxPressureController::MaxPressureController(unsigned int minGreen, unsigned int maxGreen)
+    : TrafficLightController(0), minGreen(std::max(1u, minGreen)), maxGreen(std::max(this->minGreen, maxGreen)), nextDecision(0) {}
+
+void MaxPressureController::initialize()
+{
+    TrafficLightController::initialize();
+
+    currentPhase.assign(trafficLightGroups.size(), 0);
+    phaseStart.assign(trafficLightGroups.size(), 0);
+    for (auto& group : trafficLightGroups)
+        setPhase(*group, 0, 0);
+    nextDecision = minGreen;
+}
+
+void MaxPressureController::update(unsigned long long currentTime)
+{
+    nextDecision = currentTime + minGreen;
+    for (size_t g = 0; g < trafficLightGroups.size(); g++)
+    {
+        auto& group = *trafficLightGroups[g];
+        if (group.numApproaches < 2)
+            continue;
+
+        if (currentTime < phaseStart[g] + minGreen)
+        {
+            nextDecision = std::min(nextDecision, phaseStart[g] + minGreen);
+            continue;
+        }
+
+        //Turning cars need the crossing light, so no phase may hold the junction past maxGreen
+        int otherPhase = 1 - currentPhase[g];
+        if (currentTime >= phaseStart[g] + maxGreen || phasePressure(group, otherPhase) > phasePressure(group, currentPhase[g]))
+        {
+            currentPhase[g] = otherPhase;
+            phaseStart[g] = currentTime;
+            setPhase(group, otherPhase, currentTime);
+            nextDecision = std::min(nextDecision, currentTime + minGreen);
+        }
+        else
+            nextDecision = currentTime + 1;
+    }
+}
+
+unsigned long long MaxPressureController::nextUpdateTime(unsigned long long currentTime) const
+{
+    return std::max(currentTime + 1, nextDecision);
+}
+
+int MaxPressureController::phasePressure(const TrafficLightGroup& group, int phase) const
+{
+    int pressure = 0;
+    for (size_t j = 0; j < group.trafficLights.size(); j++)
+    {
+        if (group.approachOfLight[j] % 2 != phase)
+            continue;
+        const auto& light = *group.trafficLights[j];
+        pressure += light.queueLength - (light.downstreamLight ? light.downstreamLight->queueLength : 0);
+    }
+    return pressure;
+}
+
+void MaxPressureController::setPhase(TrafficLightGroup& group, int phase, unsigned long long time)
+{
+    //A group with a single approach keeps it green
+    bool singleApproach = group.numApproaches < 2;
+    for (size_t j = 0; j < group.trafficLights.size(); j++)
+        group.trafficLights[j]->setState(singleApproach || group.approachOfLight[j] % 2 == phase, time);
+}
+
+void MaxPressureController::saveState(ByteWriter& output) const
+{
+    Checkpoint::writeValue(output, nextDecision);
+    output.writeVarint(currentPhase.size());
+    for (size_t g = 0; g < currentPhase.size(); g++)
+    {
+        Checkpoint::writeValue(output, currentPhase[g]);
+        Checkpoint::writeValue(output, phaseStart[g]);
+    }
+}
+
+void MaxPressureController::loadState(ByteReader& input)
+{
+    nextDecision = Checkpoint::readValue<unsigned long long>(input);
+    if (input.readVarint() != currentPhase.size())
+        throw std::runtime_error("Checkpoint does not match the traffic light groups of the controller.");
+    for (size_t g = 0; g < currentPhase.size(); g++)
+    {
+        currentPhase[g] = Checkpoint::readValue<int>(input);
+        phaseStart[g] = Checkpoint::readValue<unsigned long long>(input);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef MAX_PRESSURE_CONTROLLER_H
+#define MAX_PRESSURE_CONTROLLER_H
+
+#include "TrafficLightController.h"
+
+//Actuated control from the live queue counts of the lights. Every group has two phases,
+//the lights of the even-indexed approaches and those of the odd-indexed ones (as in addTwoPhasePlans). Once a phase has
+//been green for minGreen steps, the group switches whenever the other phase has the higher
+//pressure, the pressure of a light being its queue minus the queue of the light downstream,
+//or once it has been green for maxGreen steps.
+class MaxPressureController : public TrafficLightController
+{
+public:
+    MaxPressureController(unsigned int minGreen, unsigned int maxGreen);
+
+    void initialize() override;
+    void update(unsigned long long currentTime) override;
+    unsigned long long nextUpdateTime(unsigned long long currentTime) const override;
+    void saveState(ByteWriter& output) const override;
+    void loadState(ByteReader& input) override;
+
+private:
+    unsigned int minGreen;
+    unsigned int maxGreen;
+    std::vector<int> currentPhase;
+    std::vector<unsigned long long> phaseStart;
+    unsigned long long nextDecision;
+
+    int phasePressure(const TrafficLightGroup& group, int phase) const;
+    void setPhase(TrafficLightGroup& group, int phase, unsigned long long time);
+};
+
+#endif
@@ -0,0 +1,358 @@
+#include "NetworkCentrality.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <tuple>
+
+NetworkCentrality::NetworkCentrality(const std::vector<std::shared_ptr<Road>>& roads, bool weighted)
+    : roads(roads), weighted(weighted)
+{
+    buildGraph();
+}
+
+size_t NetworkCentrality::numJunctions() const
+{
+    return edgeOffsets.empty() ? 0 : edgeOffsets.size() - 1;
+}
+
+void NetworkCentrality::buildGraph()
+{
+    //Junctions: connected components of the shared-section wiring
+    int numJunctionsFound = 0;
+    for (const auto& road : roads)
+    {
+        for (int position : road->sharedSectionsPositions)
+        {
+            const RoadSection* section = road->sectionAt(position);
+            if (junctionOfSection.count(section))
+                continue;
+
+            int junction = numJunctionsFound++;
+            std::vector<const RoadSection*> pending = {section};
+            junctionOfSection[section] = junction;
+            while (!pending.empty())
+            {
+                const RoadSection* current = pending.back();
+                pending.pop_back();
+                for (const auto& connected : current->connectedSections)
+                {
+                    auto other = connected.lock();
+                    if (other && junctionOfSection.emplace(other.get(), junction).second)
+                        pending.push_back(other.get());
+                }
+            }
+        }
+    }
+
+    //Road segments between consecutive junctions, in the direction of travel
+    std::vector<std::tuple<int, int, long long>> edges;
+    for (const auto& road : roads)
+    {
+        std::vector<int> positions = road->sharedSectionsPositions;
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+        auto addEdge = [&](int from, int to, long long length)
+        {
+            int fromJunction = junctionOfSection.at(road->sectionAt(from));
+            int toJunction = junctionOfSection.at(road->sectionAt(to));
+            if (fromJunction != toJunction)
+                edges.emplace_back(fromJunction, toJunction, weighted ? length : 1);
+        };
+
+        for (size_t i = 0; i + 1 < positions.size(); i++)
+            addEdge(positions[i], positions[i + 1], positions[i + 1] - positions[i]);
+        if (road->isPeriodic && positions.size() > 1)
+            addEdge(positions.back(), positions.front(), road->roadSize - positions.back() + positions.front());
+    }
+
+    //Parallel roads between the same junctions keep only the shortest segment
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end(), [](const auto& a, const auto& b)
+                            {
+                                return std::get<0>(a) == std::get<0>(b) && std::get<1>(a) == std::get<1>(b);
+                            }), edges.end());
+
+    edgeOffsets.assign(numJunctionsFound + 1, 0);
+    edgeTargets.clear();
+    edgeWeights.clear();
+    std::vector<std::vector<int>> neighbours(numJunctionsFound);
+    for (const auto& [from, to, length] : edges)
+    {
+        edgeOffsets[from + 1]++;
+        edgeTargets.push_back(to);
+        edgeWeights.push_back(length);
+        neighbours[from].push_back(to);
+        neighbours[to].push_back(from);
+    }
+    for (int junction = 0; junction < numJunctionsFound; junction++)
+        edgeOffsets[junction + 1] += edgeOffsets[junction];
+
+    degreeCentrality.assign(numJunctionsFound, 0);
+    for (int junction = 0; junction < numJunctionsFound; junction++)
+    {
+        auto& adjacent = neighbours[junction];
+        std::sort(adjacent.begin(), adjacent.end());
+        degreeCentrality[junction] = static_cast<int>(std::unique(adjacent.begin(), adjacent.end()) - adjacent.begin());
+    }
+}
+
+void NetworkCentrality::compute(unsigned int numThreads)
+{
+    size_t n = numJunctions();
+    betweennessCentrality.assign(n, 0.0);
+    closenessCentrality.assign(n, 0.0);
+    if (n == 0)
+        return;
+
+    numThreads = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(numThreads, n)));
+    long long maxWeight = edgeWeights.empty() ? 1 : *std::max_element(edgeWeights.begin(), edgeWeights.end());
+    std::vector<std::vector<double>> partialBetweenness(numThreads, std::vector<double>(n, 0.0));
+    std::atomic<size_t> nextSource(0);
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+
+    auto worker = [&](unsigned int threadIndex)
+    {
+        try
+        {
+            std::vector<long long> distance(n, -1);
+            std::vector<double> pathCount(n, 0.0);
+            std::vector<double> dependency(n, 0.0);
+            std::vector<int> order; //Junctions by non-decreasing distance from the source
+            order.reserve(n);
+            //Dial's bucket queue: segment lengths are small positive integers, so a circular array of
+            //maxWeight + 1 buckets replaces the heap of Dijkstra's algorithm
+            std::vector<std::vector<int>> buckets(weighted ? maxWeight + 1 : 0);
+            size_t pendingEntries = 0;
+            auto& betweenness = partialBetweenness[threadIndex];
+
+            for (size_t source = nextSource++; source < n; source = nextSource++)
+            {
+                order.clear();
+                distance[source] = 0;
+                pathCount[source] = 1.0;
+
+                auto relax = [&](int junction)
+                {
+                    for (size_t edge = edgeOffsets[junction]; edge < edgeOffsets[junction + 1]; edge++)
+                    {
+                        int target = edgeTargets[edge];
+                        long long targetDistance = distance[junction] + edgeWeights[edge];
+                        if (distance[target] < 0 || targetDistance < distance[target])
+                        {
+                            bool firstVisit = distance[target] < 0;
+                            distance[target] = targetDistance;
+                            pathCount[target] = pathCount[junction];
+                            if (weighted)
+                            {
+                                buckets[targetDistance % buckets.size()].push_back(target);
+                                pendingEntries++;
+                            }
+                            else if (firstVisit)
+                                order.push_back(target);
+                        }
+                        else if (targetDistance == distance[target])
+                            pathCount[target] += pathCount[junction];
+                    }
+                };
+
+                if (weighted)
+                {
+                    buckets[0].push_back(static_cast<int>(source));
+                    pendingEntries = 1;
+                    for (long long currentDistance = 0; pendingEntries > 0; currentDistance++)
+                    {
+                        //Relaxing never adds to the current bucket, since every weight is in [1, maxWeight]
+                        auto& bucket = buckets[currentDistance % buckets.size()];
+                        for (int junction : bucket)
+                        {
+                            pendingEntries--;
+                            if (distance[junction] != currentDistance)
+                                continue; //Superseded by a shorter path
+                            order.push_back(junction);
+                            relax(junction);
+                        }
+                        bucket.clear();
+                    }
+                }
+                else
+                {
+                    //Breadth-first: the order vector doubles as the queue
+                    order.push_back(static_cast<int>(source));
+                    for (size_t head = 0; head < order.size(); head++)
+                        relax(order[head]);
+                }
+
+                long long totalDistance = 0;
+                for (int junction : order)
+                    totalDistance += distance[junction];
+                double reached = static_cast<double>(order.size() - 1);
+                if (totalDistance > 0 && n > 1)
+                    closenessCentrality[source] = (reached / (n - 1)) * (reached / totalDistance);
+
+                //Brandes' dependency accumulation; successors on shortest paths are found from the distances
+                for (auto it = order.rbegin(); it != order.rend(); ++it)
+                {
+                    int junction = *it;
+                    for (size_t edge = edgeOffsets[junction]; edge < edgeOffsets[junction + 1]; edge++)
+                    {
+                        int target = edgeTargets[edge];
+                        if (distance[target] == distance[junction] + edgeWeights[edge])
+                            dependency[junction] += pathCount[junction] / pathCount[target] * (1.0 + dependency[target]);
+                    }
+                    if (junction != static_cast<int>(source))
+                        betweenness[junction] += dependency[junction];
+                }
+
+                for (int junction : order)
+                {
+                    distance[junction] = -1;
+                    pathCount[junction] = 0.0;
+                    dependency[junction] = 0.0;
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+                failure = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+    if (failure)
+        std::rethrow_exception(failure);
+
+    //Same normalisation as the directed pair count of the former per-group computation
+    double pairs = (n > 2) ? static_cast<double>(n - 1) * (n - 2) : 1.0;
+    for (const auto& betweenness : partialBetweenness)
+        for (size_t junction = 0; junction < n; junction++)
+            betweennessCentrality[junction] += betweenness[junction];
+    for (auto& value : betweennessCentrality)
+        value /= pairs;
+}
+
+void NetworkCentrality::computeAllPairs()
+{
+    //Betweenness straight from its definition: v lies on a shortest s-t path when d(s,v) + d(v,t) = d(s,t),
+    //and then carries paths(s,v) * paths(v,t) of the paths(s,t) shortest paths
+    size_t n = numJunctions();
+    betweennessCentrality.assign(n, 0.0);
+    closenessCentrality.assign(n, 0.0);
+    if (n == 0)
+        return;
+
+    const long long unreachable = std::numeric_limits<long long>::max() / 4;
+    std::vector<std::vector<long long>> distance(n, std::vector<long long>(n, unreachable));
+    for (size_t junction = 0; junction < n; junction++)
+    {
+        distance[junction][junction] = 0;
+        for (size_t edge = edgeOffsets[junction]; edge < edgeOffsets[junction + 1]; edge++)
+            distance[junction][edgeTargets[edge]] = std::min(distance[junction][edgeTargets[edge]], edgeWeights[edge]);
+    }
+    for (size_t via = 0; via < n; via++)
+        for (size_t from = 0; from < n; from++)
+            for (size_t to = 0; to < n; to++)
+                distance[from][to] = std::min(distance[from][to], distance[from][via] + distance[via][to]);
+
+    //Weights are positive, so every predecessor on a shortest path is strictly closer to the source
+    std::vector<std::vector<double>> paths(n, std::vector<double>(n, 0.0));
+    for (size_t source = 0; source < n; source++)
+    {
+        std::vector<size_t> byDistance(n);
+        std::iota(byDistance.begin(), byDistance.end(), 0);
+        std::sort(byDistance.begin(), byDistance.end(), [&](size_t a, size_t b) { return distance[source][a] < distance[source][b]; });
+
+        paths[source][source] = 1.0;
+        for (size_t from : byDistance)
+        {
+            if (distance[source][from] >= unreachable)
+                break;
+            for (size_t edge = edgeOffsets[from]; edge < edgeOffsets[from + 1]; edge++)
+            {
+                int to = edgeTargets[edge];
+                if (distance[source][from] + edgeWeights[edge] == distance[source][to])
+                    paths[source][to] += paths[source][from];
+            }
+        }
+
+        long long totalDistance = 0;
+        size_t reached = 0;
+        for (size_t target = 0; target < n; target++)
+        {
+            if (target != source && distance[source][target] < unreachable)
+            {
+                totalDistance += distance[source][target];
+                reached++;
+            }
+        }
+        if (totalDistance > 0 && n > 1)
+            closenessCentrality[source] = (static_cast<double>(reached) / (n - 1)) * (static_cast<double>(reached) / totalDistance);
+    }
+
+    double pairs = (n > 2) ? static_cast<double>(n - 1) * (n - 2) : 1.0;
+    for (size_t source = 0; source < n; source++)
+    {
+        for (size_t target = 0; target < n; target++)
+        {
+            if (target == source || distance[source][target] >= unreachable)
+                continue;
+            for (size_t junction = 0; junction < n; junction++)
+            {
+                if (junction != source && junction != target && distance[source][junction] + distance[junction][target] == distance[source][target])
+                    betweennessCentrality[junction] += paths[source][junction] * paths[junction][target] / paths[source][target] / pairs;
+            }
+        }
+    }
+}
+
+int NetworkCentrality::junctionOfTrafficLight(const TrafficLight& trafficLight) const
+{
+    auto road = trafficLight.ownerRoad.lock();
+    if (!road || road->sharedSectionsPositions.empty())
+        return -1;
+
+    //A light guards the first junction at or after its position
+    const auto& positions = road->sharedSectionsPositions;
+    auto it = std::lower_bound(positions.begin(), positions.end(), trafficLight.roadPosition);
+    if (it == positions.end())
+    {
+        if (!road->isPeriodic)
+            return -1;
+        it = positions.begin();
+    }
+
+    auto junction = junctionOfSection.find(road->sectionAt(*it));
+    return junction == junctionOfSection.end() ? -1 : junction->second;
+}
+
+void NetworkCentrality::assignTo(const std::vector<std::shared_ptr<TrafficLightGroup>>& trafficLightGroups) const
+{
+    for (const auto& group : trafficLightGroups)
+    {
+        if (!group)
+            continue;
+
+        int junction = -1;
+        for (const auto& trafficLight : group->trafficLights)
+        {
+            junction = junctionOfTrafficLight(*trafficLight);
+            if (junction >= 0)
+                break;
+        }
+
+        group->degreeCentrality = (junction >= 0) ? degreeCentrality[junction] : 0;
+        group->betweennessCentrality = (junction >= 0) ? betweennessCentrality[junction] : 0.0;
+        group->closenessCentrality = (junction >= 0) ? closenessCentrality[junction] : 0.0;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef NETWORK_CENTRALITY_H
+#define NETWORK_CENTRALITY_H
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Road.h"
+#include "TrafficLightGroup.h"
+
+//Degree, closeness and betweenness centrality of the junctions of the road network.
+//A junction is a set of shared sections wired together; every road contributes a directed
+//edge from each junction to the next one downstream (wrapping on periodic roads), weighted
+//by the number of cells between them or by one hop. Betweenness uses Brandes' algorithm
+//(breadth-first or bucket-queue shortest paths), with the sources spread over threads.
+class NetworkCentrality
+{
+public:
+    std::vector<int> degreeCentrality;
+    std::vector<double> betweennessCentrality;
+    std::vector<double> closenessCentrality;
+
+    NetworkCentrality(const std::vector<std::shared_ptr<Road>>& roads, bool weighted);
+    void compute(unsigned int numThreads);
+    void computeAllPairs(); //O(n^3) reference for compute(), used by tests/CentralityChecks.cpp
+    void assignTo(const std::vector<std::shared_ptr<TrafficLightGroup>>& trafficLightGroups) const;
+    size_t numJunctions() const;
+
+private:
+    const std::vector<std::shared_ptr<Road>>& roads;
+    bool weighted;
+    std::unordered_map<const RoadSection*, int> junctionOfSection;
+    std::vector<size_t> edgeOffsets; //CSR adjacency: edges of junction j are [edgeOffsets[j], edgeOffsets[j+1])
+    std::vector<int> edgeTargets;
+    std::vector<long long> edgeWeights;
+
+    void buildGraph();
+    int junctionOfTrafficLight(const TrafficLight& trafficLight) const;
+};
+
+#endif
@@ -0,0 +1,360 @@
+#include "NetworkImage.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+namespace
+{
+    constexpr uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+    constexpr uint64_t fnvPrime = 1099511628211ULL;
+    constexpr uint32_t byteOrderMark = 0x01020304;
+
+    template <typename T>
+    uint64_t appendRecords(ByteWriter& output, const std::vector<T>& records)
+    {
+        while (output.size() % 8 != 0)
+            output.writeByte(0);
+
+        uint64_t offset = output.size();
+        if (!records.empty())
+            output.writeBytes(reinterpret_cast<const uint8_t*>(records.data()), records.size() * sizeof(T));
+        return offset;
+    }
+
+    bool arrayFits(uint64_t offset, uint64_t count, size_t recordSize, size_t fileSize)
+    {
+        return offset % 8 == 0 && offset <= fileSize && count <= (fileSize - offset) / recordSize;
+    }
+
+    bool rangeFits(uint64_t first, uint64_t count, uint64_t total)
+    {
+        return first <= total && count <= total - first;
+    }
+}
+
+NetworkImage::~NetworkImage()
+{
+    close();
+}
+
+bool NetworkImage::hasTopology(const nlohmann::json& simulationConfig)
+{
+    return simulationConfig.contains("roads") || simulationConfig.contains("grid");
+}
+
+uint64_t NetworkImage::topologyHash(const nlohmann::json& simulationConfig)
+{
+    //nlohmann::json keeps object keys sorted, so dump() is a canonical form of the topology
+    nlohmann::json topology;
+    topology["formatVersion"] = formatVersion;
+    for (const char* key : {"roads", "trafficLightGroups", "trafficLights", "grid", "detectors"})
+    {
+        if (simulationConfig.contains(key))
+            topology[key] = simulationConfig[key];
+    }
+    if (simulationConfig.contains("centrality"))
+    {
+        const auto& centralityConfig = simulationConfig["centrality"];
+        topology["centralityWeighted"] = centralityConfig.is_object() && centralityConfig.value("weighted", false);
+    }
+    if (simulationConfig.contains("grid"))
+        topology["externalControl"] = simulationConfig.value("controllerType", "") == "external";
+
+    uint64_t hash = fnvOffsetBasis;
+    for (char character : topology.dump())
+    {
+        hash ^= static_cast<uint8_t>(character);
+        hash *= fnvPrime;
+    }
+    return hash;
+}
+
+void NetworkImage::write(const std::string& path, uint64_t topologyHash, int gridColumns,
+                         const std::vector<std::shared_ptr<Road>>& roads,
+                         const std::vector<std::pair<double, int>>& initialLoads,
+                         const Dictionary<int, double>& alphaWeights,
+                         const std::vector<std::shared_ptr<TrafficLightGroup>>& trafficLightGroups)
+{
+    std::vector<RoadRecord> roadRecords;
+    std::vector<ConnectionRecord> connectionRecords;
+    std::vector<ProbabilityRecord> probabilityRecords;
+    std::vector<LightRecord> lightRecords;
+    std::vector<GroupRecord> groupRecords;
+    std::vector<int32_t> tables;
+    std::unordered_map<const TrafficLight*, int32_t> lightIndices;
+
+    auto appendTable = [&tables](const std::vector<int>& values)
+    {
+        uint64_t offset = tables.size();
+        tables.insert(tables.end(), values.begin(), values.end());
+        return offset;
+    };
+
+    roadRecords.reserve(roads.size());
+    for (size_t i = 0; i < roads.size(); i++)
+    {
+        const auto& road = roads[i];
+        RoadRecord record{};
+        record.roadID = road->roadID;
+        record.roadSize = road->roadSize;
+        record.isPeriodic = road->isPeriodic;
+        record.parentRoadID = road->parentRoadID;
+        record.lane = road->lane;
+        record.storage = static_cast<int32_t>(road->storage);
+        record.density = initialLoads[i].first;
+        record.numCars = initialLoads[i].second;
+        record.alphaWeight = alphaWeights.isThere(road->roadID) ? alphaWeights.get(road->roadID) : 0.0;
+        record.beta = road->beta;
+
+        //Connections are stored per section in wiring order, which is all the step rules see
+        record.firstConnection = connectionRecords.size();
+        for (const RoadSection* section : road->wiredSections())
+        {
+            for (const auto& connected : section->connectedSections)
+            {
+                auto otherSection = connected.lock();
+                auto otherRoad = otherSection ? otherSection->road.lock() : nullptr;
+                if (!otherRoad)
+                    throw std::runtime_error("Cannot compile a network with expired shared sections.");
+                connectionRecords.push_back({section->index, otherRoad->roadID, otherSection->index, 0});
+            }
+        }
+        record.numConnections = static_cast<uint32_t>(connectionRecords.size() - record.firstConnection);
+
+        record.firstProbability = probabilityRecords.size();
+        for (const auto& [site, probability] : road->changingRoadProbs)
+            probabilityRecords.push_back({site, 0, probability});
+        record.numProbabilities = static_cast<uint32_t>(probabilityRecords.size() - record.firstProbability);
+
+        record.firstLight = lightRecords.size();
+        for (const auto& trafficLight : road->trafficLights)
+        {
+            lightIndices[trafficLight.get()] = static_cast<int32_t>(lightRecords.size());
+            lightRecords.push_back({trafficLight->roadPosition, trafficLight->timeOpen, trafficLight->timeClosed,
+                                    trafficLight->distanceToPreviousTrafficLight, trafficLight->externalControl, 0});
+        }
+        record.numLights = static_cast<uint32_t>(lightRecords.size() - record.firstLight);
+
+        record.sharedSectionsTable = appendTable(road->sharedSectionsPositions);
+        record.numSharedSections = static_cast<uint32_t>(road->sharedSectionsPositions.size());
+        record.trafficLightsTable = appendTable(road->trafficLightPositions);
+        record.numTrafficLightPositions = static_cast<uint32_t>(road->trafficLightPositions.size());
+        record.measurementPointsTable = appendTable(road->timeHeadwayAndFlowPoints);
+        record.numMeasurementPoints = static_cast<uint32_t>(road->timeHeadwayAndFlowPoints.size());
+
+        roadRecords.push_back(record);
+    }
+
+    groupRecords.reserve(trafficLightGroups.size());
+    for (const auto& group : trafficLightGroups)
+    {
+        GroupRecord record{};
+        if (group)
+        {
+            record.exists = 1;
+            record.transitionTime = group->getTransitionTime();
+            record.degreeCentrality = group->degreeCentrality;
+            record.betweennessCentrality = group->betweennessCentrality;
+            record.closenessCentrality = group->closenessCentrality;
+
+            std::vector<int> members;
+            for (const auto& trafficLight : group->trafficLights)
+            {
+                auto it = lightIndices.find(trafficLight.get());
+                if (it == lightIndices.end())
+                    throw std::runtime_error("Cannot compile a traffic light group with a light outside the network.");
+                members.push_back(it->second);
+            }
+            record.lightsTable = appendTable(members);
+            record.numLights = static_cast<uint32_t>(members.size());
+        }
+        groupRecords.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, "NSNI", 4);
+    header.version = formatVersion;
+    header.byteOrder = byteOrderMark;
+    header.gridColumns = gridColumns;
+    header.topologyHash = topologyHash;
+    header.numRoads = roadRecords.size();
+    header.numConnections = connectionRecords.size();
+    header.numProbabilities = probabilityRecords.size();
+    header.numLights = lightRecords.size();
+    header.numGroups = groupRecords.size();
+    header.numTableEntries = tables.size();
+
+    ByteWriter output;
+    output.bytes.resize(sizeof(Header));
+    header.roadsOffset = appendRecords(output, roadRecords);
+    header.connectionsOffset = appendRecords(output, connectionRecords);
+    header.probabilitiesOffset = appendRecords(output, probabilityRecords);
+    header.lightsOffset = appendRecords(output, lightRecords);
+    header.groupsOffset = appendRecords(output, groupRecords);
+    header.tablesOffset = appendRecords(output, tables);
+    header.fileSize = output.size();
+    std::memcpy(output.bytes.data(), &header, sizeof(Header));
+
+    //Unique temporary name and rename, so concurrent compilers never expose a torn image
+#ifndef _WIN32
+    std::string temporaryPath = path + ".tmp" + std::to_string(getpid());
+#else
+    std::string temporaryPath = path + ".tmp";
+#endif
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open network image file: " + temporaryPath);
+
+    file.write(reinterpret_cast<const char*>(output.bytes.data()), output.size());
+    file.close();
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporaryPath.c_str());
+        throw std::runtime_error("Unable to write network image file: " + path);
+    }
+}
+
+bool NetworkImage::open(const std::string& path)
+{
+    close();
+
+#ifndef _WIN32
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        if (errno == ENOENT)
+            return false;
+        throw std::runtime_error("Unable to open network image file: " + path);
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Unable to read network image file: " + path);
+    }
+
+    size = static_cast<size_t>(status.st_size);
+    if (size > 0)
+    {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data = static_cast<const uint8_t*>(mapping);
+            mapped = true;
+        }
+    }
+    ::close(descriptor);
+#endif
+
+    if (!mapped)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+    }
+
+    validate(path);
+    return true;
+}
+
+void NetworkImage::close()
+{
+#ifndef _WIN32
+    if (mapped)
+        munmap(const_cast<uint8_t*>(data), size);
+#endif
+    mapped = false;
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+}
+
+void NetworkImage::validate(const std::string& path) const
+{
+    if (size < sizeof(Header) || std::memcmp(data, "NSNI", 4) != 0)
+        throw std::runtime_error("Not a network image file: " + path);
+
+    const Header& imageHeader = header();
+    if (imageHeader.version != formatVersion || imageHeader.byteOrder != byteOrderMark)
+        throw std::runtime_error("Network image was written by an incompatible build: " + path);
+
+    if (imageHeader.fileSize != size ||
+        !arrayFits(imageHeader.roadsOffset, imageHeader.numRoads, sizeof(RoadRecord), size) ||
+        !arrayFits(imageHeader.connectionsOffset, imageHeader.numConnections, sizeof(ConnectionRecord), size) ||
+        !arrayFits(imageHeader.probabilitiesOffset, imageHeader.numProbabilities, sizeof(ProbabilityRecord), size) ||
+        !arrayFits(imageHeader.lightsOffset, imageHeader.numLights, sizeof(LightRecord), size) ||
+        !arrayFits(imageHeader.groupsOffset, imageHeader.numGroups, sizeof(GroupRecord), size) ||
+        !arrayFits(imageHeader.tablesOffset, imageHeader.numTableEntries, sizeof(int32_t), size))
+        throw std::runtime_error("Truncated or corrupt network image file: " + path);
+
+    uint64_t numTableEntries = imageHeader.numTableEntries;
+    for (uint64_t i = 0; i < imageHeader.numRoads; i++)
+    {
+        const RoadRecord& road = roads()[i];
+        if (road.roadSize <= 0 || road.parentRoadID < 0 || static_cast<uint64_t>(road.parentRoadID) >= imageHeader.numRoads || road.lane < 0 ||
+            road.storage < static_cast<int32_t>(Road::Storage::Dense) || road.storage > static_cast<int32_t>(Road::Storage::Auto) ||
+            !rangeFits(road.firstConnection, road.numConnections, imageHeader.numConnections) ||
+            !rangeFits(road.firstProbability, road.numProbabilities, imageHeader.numProbabilities) ||
+            !rangeFits(road.firstLight, road.numLights, imageHeader.numLights) ||
+            !rangeFits(road.sharedSectionsTable, road.numSharedSections, numTableEntries) ||
+            !rangeFits(road.trafficLightsTable, road.numTrafficLightPositions, numTableEntries) ||
+            !rangeFits(road.measurementPointsTable, road.numMeasurementPoints, numTableEntries))
+            throw std::runtime_error("Corrupt road record in network image file: " + path);
+    }
+
+    for (uint64_t i = 0; i < imageHeader.numGroups; i++)
+    {
+        const GroupRecord& group = groups()[i];
+        if (!rangeFits(group.lightsTable, group.numLights, numTableEntries))
+            throw std::runtime_error("Corrupt traffic light group record in network image file: " + path);
+    }
+}
+
+const NetworkImage::Header& NetworkImage::header() const
+{
+    return *reinterpret_cast<const Header*>(data);
+}
+
+const NetworkImage::RoadRecord* NetworkImage::roads() const
+{
+    return reinterpret_cast<const RoadRecord*>(data + header().roadsOffset);
+}
+
+const NetworkImage::ConnectionRecord* NetworkImage::connections() const
+{
+    return reinterpret_cast<const ConnectionRecord*>(data + header().connectionsOffset);
+}
+
+const NetworkImage::ProbabilityRecord* NetworkImage::probabilities() const
+{
+    return reinterpret_cast<const ProbabilityRecord*>(data + header().probabilitiesOffset);
+}
+
+const NetworkImage::LightRecord* NetworkImage::lights() const
+{
+    return reinterpret_cast<const LightRecord*>(data + header().lightsOffset);
+}
+
+const NetworkImage::GroupRecord* NetworkImage::groups() const
+{
+    return reinterpret_cast<const GroupRecord*>(data + header().groupsOffset);
+}
+
+const int32_t* NetworkImage::tables() const
+{
+    return reinterpret_cast<const int32_t*>(data + header().tablesOffset);
+}
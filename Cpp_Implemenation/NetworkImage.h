@@ -0,0 +1,146 @@
+#ifndef NETWORK_IMAGE_H
+#define NETWORK_IMAGE_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "Road.h"
+#include "TrafficLightGroup.h"
+
+//Compiled form of the static road network: roads, shared-section wiring, signal placement
+//and the tables Simulation::setup derives from them (sorted positions, measurement points,
+//distances between lights, centralities). The file is a header followed by arrays of
+//fixed-size records that are read in place from a read-only mapping, so repeated runs
+//skip the JSON topology and concurrent processes share the pages.
+//
+//The image is keyed by a hash of the topology part of the configuration; run parameters
+//(vMax, brakeProbability, queueSize, controller, seed, ...) are applied when it is loaded.
+class NetworkImage
+{
+public:
+    static constexpr uint32_t formatVersion = 3;
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t byteOrder;
+        int32_t gridColumns;
+        uint64_t topologyHash;
+        uint64_t numRoads;
+        uint64_t numConnections;
+        uint64_t numProbabilities;
+        uint64_t numLights;
+        uint64_t numGroups;
+        uint64_t numTableEntries;
+        uint64_t roadsOffset;
+        uint64_t connectionsOffset;
+        uint64_t probabilitiesOffset;
+        uint64_t lightsOffset;
+        uint64_t groupsOffset;
+        uint64_t tablesOffset;
+        uint64_t fileSize;
+    };
+
+    //Ranges index into the connection, probability, light and table arrays
+    struct RoadRecord
+    {
+        int32_t roadID;
+        int32_t roadSize;
+        int32_t numCars;
+        int32_t isPeriodic;
+        int32_t parentRoadID; //The configured road this one is a lane of; its own roadID for lane 0
+        int32_t lane;
+        int32_t storage; //Road::Storage as configured; "auto" is resolved when the image is loaded
+        int32_t padding;
+        double alphaWeight;
+        double beta;
+        double density;
+        uint64_t firstConnection;
+        uint64_t firstProbability;
+        uint64_t firstLight;
+        uint64_t sharedSectionsTable;
+        uint64_t trafficLightsTable;
+        uint64_t measurementPointsTable;
+        uint32_t numConnections;
+        uint32_t numProbabilities;
+        uint32_t numLights;
+        uint32_t numSharedSections;
+        uint32_t numTrafficLightPositions;
+        uint32_t numMeasurementPoints;
+    };
+
+    struct ConnectionRecord
+    {
+        int32_t site;
+        int32_t otherRoadID;
+        int32_t otherSite;
+        int32_t padding;
+    };
+
+    struct ProbabilityRecord
+    {
+        int32_t site;
+        int32_t padding;
+        double probability;
+    };
+
+    struct LightRecord
+    {
+        int32_t position;
+        int32_t timeOpen;
+        int32_t timeClosed;
+        int32_t distanceToPreviousTrafficLight;
+        int32_t externalControl;
+        int32_t padding;
+    };
+
+    //Groups that were never created (gaps in the group IDs) have exists == 0
+    struct GroupRecord
+    {
+        int32_t exists;
+        int32_t transitionTime;
+        int32_t degreeCentrality;
+        uint32_t numLights;
+        double betweennessCentrality;
+        double closenessCentrality;
+        uint64_t lightsTable;
+    };
+
+    NetworkImage() = default;
+    ~NetworkImage();
+    NetworkImage(const NetworkImage&) = delete;
+    NetworkImage& operator=(const NetworkImage&) = delete;
+
+    static uint64_t topologyHash(const nlohmann::json& simulationConfig);
+    static bool hasTopology(const nlohmann::json& simulationConfig);
+    static void write(const std::string& path, uint64_t topologyHash, int gridColumns,
+                      const std::vector<std::shared_ptr<Road>>& roads,
+                      const std::vector<std::pair<double, int>>& initialLoads,
+                      const Dictionary<int, double>& alphaWeights,
+                      const std::vector<std::shared_ptr<TrafficLightGroup>>& trafficLightGroups);
+
+    //Returns false if the file does not exist; throws if it exists but is not a valid image
+    bool open(const std::string& path);
+
+    const Header& header() const;
+    const RoadRecord* roads() const;
+    const ConnectionRecord* connections() const;
+    const ProbabilityRecord* probabilities() const;
+    const LightRecord* lights() const;
+    const GroupRecord* groups() const;
+    const int32_t* tables() const;
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> buffer; //Used where the file cannot be mapped
+    bool mapped = false;
+
+    void close();
+    void validate(const std::string& path) const;
+};
+
+#endif
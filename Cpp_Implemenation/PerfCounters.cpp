@@ -0,0 +1,137 @@
+#include "PerfCounters.h"
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::PerfCounters() : leaderFd(-1), groupSize(0)
+{
+    fds.fill(-1);
+    groupSlots.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+const char* PerfCounters::counterName(Counter counter)
+{
+    switch (counter)
+    {
+    case Cycles:       return "cycles";
+    case Instructions: return "instructions";
+    case L1DMisses:    return "L1D misses";
+    case LLCMisses:    return "LLC misses";
+    case BranchMisses: return "branch misses";
+    default:           return "unknown";
+    }
+}
+
+bool PerfCounters::open(std::string& error)
+{
+#ifdef __linux__
+    close();
+
+    const std::array<std::pair<uint32_t, uint64_t>, NumCounters> events = {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+
+    for (int counter = 0; counter < NumCounters; counter++)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[counter].first;
+        attr.config = events[counter].second;
+        attr.disabled = (counter == Cycles) ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        //pid 0 and cpu -1: the calling thread on any CPU
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leaderFd, 0));
+        if (fd < 0)
+        {
+            if (counter == Cycles)
+            {
+                error = std::string("perf_event_open failed: ") + std::strerror(errno);
+                return false;
+            }
+            continue; //Optional member, e.g. no L1D event on this CPU
+        }
+
+        if (counter == Cycles)
+            leaderFd = fd;
+        fds[counter] = fd;
+        groupSlots[counter] = groupSize++;
+    }
+
+    ioctl(leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    error = "hardware counters need Linux perf_event_open";
+    return false;
+#endif
+}
+
+void PerfCounters::close()
+{
+#ifdef __linux__
+    for (auto& fd : fds)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+#endif
+    leaderFd = -1;
+    groupSlots.fill(-1);
+    groupSize = 0;
+}
+
+bool PerfCounters::isOpen() const
+{
+    return leaderFd >= 0;
+}
+
+bool PerfCounters::isAvailable(Counter counter) const
+{
+    return fds[counter] >= 0;
+}
+
+PerfCounters::Values PerfCounters::read() const
+{
+    Values values{};
+#ifdef __linux__
+    if (leaderFd < 0)
+        return values;
+
+    //Group read layout: nr, time_enabled, time_running, then one value per member
+    std::array<uint64_t, 3 + NumCounters> buffer{};
+    if (::read(leaderFd, buffer.data(), sizeof(uint64_t) * (3 + groupSize)) <= 0)
+        return values;
+
+    uint64_t enabled = buffer[1];
+    uint64_t running = buffer[2];
+    if (running == 0)
+        return values;
+
+    //Scale up if the group was multiplexed with other events
+    double scale = static_cast<double>(enabled) / running;
+    for (int counter = 0; counter < NumCounters; counter++)
+        if (groupSlots[counter] >= 0)
+            values[counter] = static_cast<uint64_t>(buffer[3 + groupSlots[counter]] * scale);
+#endif
+    return values;
+}
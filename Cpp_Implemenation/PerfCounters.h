@@ -0,0 +1,47 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+//Hardware counters of the calling thread, read as one perf_event_open group so all
+//values cover the same interval. Counters the CPU or kernel does not offer are left
+//out; if even the cycle counter cannot be opened the group stays closed and reads
+//return zeros, so callers fall back to timers only.
+class PerfCounters
+{
+public:
+    enum Counter
+    {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        BranchMisses,
+        NumCounters
+    };
+
+    using Values = std::array<uint64_t, NumCounters>;
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool open(std::string& error);
+    void close();
+    bool isOpen() const;
+    bool isAvailable(Counter counter) const;
+    Values read() const;
+
+    static const char* counterName(Counter counter);
+
+private:
+    int leaderFd;
+    std::array<int, NumCounters> fds;
+    std::array<int, NumCounters> groupSlots; //Position of each counter in the group read
+    int groupSize;
+};
+
+#endif
@@ -1,7 +1,20 @@
 #include "RandomNumberGenerator.h"
 
-RandomNumberGenerator::RandomNumberGenerator() : generator(std::random_device{}())
+RandomNumberGenerator::RandomNumberGenerator() : seedValue(std::random_device{}())
 {
+    //The seed is kept so that any run can be reproduced from its output header
+    generator.seed(seedValue);
+}
+
+void RandomNumberGenerator::seed(unsigned int value)
+{
+    seedValue = value;
+    generator.seed(seedValue);
+}
+
+unsigned int RandomNumberGenerator::getSeed() const
+{
+    return seedValue;
 }
 
 int RandomNumberGenerator::getRandomInt(int min, int max)
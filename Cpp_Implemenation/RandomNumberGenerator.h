@@ -13,9 +13,12 @@ public:
     double getRandomInRange(double min, double max);
     double getRandomGaussian(double mean, double stddev);
     std::mt19937& getGenerator();
+    void seed(unsigned int value);
+    unsigned int getSeed() const;
 
 protected:
     std::mt19937 generator;
+    unsigned int seedValue;
 
     RandomNumberGenerator();
 
@@ -0,0 +1,23 @@
+#include "RandomOffsetController.h"
+
+RandomOffsetController::RandomOffsetController(unsigned int cycleTime, RandomNumberGenerator& rng)
+    : TrafficLightController(cycleTime), rng(rng)
+{
+    if (cycleTime < 2)
+        throw std::invalid_argument("Random offset cycle time must be at least 2.");
+    phaseTime = cycleTime / 2;
+}
+
+void RandomOffsetController::initialize()
+{
+    TrafficLightController::initialize();
+
+    //Starting the cycle "offset" steps early is a plan delayed by cycleTime - offset
+    schedule.clear();
+    for (auto& group : trafficLightGroups)
+    {
+        unsigned int offset = static_cast<unsigned int>(rng.getRandomInt(0, cycleTime - 1));
+        addTwoPhasePlans(*group, cycleTime, (cycleTime - offset) % cycleTime, phaseTime);
+    }
+    schedule.applyAll(0);
+}
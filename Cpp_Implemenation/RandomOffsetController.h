@@ -0,0 +1,20 @@
+#ifndef RANDOM_OFFSET_CONTROLLER_H
+#define RANDOM_OFFSET_CONTROLLER_H
+
+#include "TrafficLightController.h"
+
+//Every intersection runs the same cycle as the synchronized controller but starts it
+//at a uniformly random offset, which serves as the uncoordinated baseline.
+class RandomOffsetController : public TrafficLightController
+{
+public:
+    RandomOffsetController(unsigned int cycleTime, RandomNumberGenerator& rng);
+
+    void initialize() override;
+
+private:
+    RandomNumberGenerator& rng;
+    unsigned int phaseTime;
+};
+
+#endif
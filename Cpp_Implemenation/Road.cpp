@@ -1,32 +1,186 @@
 #include "Road.h"
+#include "Checkpoint.h"
+#include "StepProfiler.h"
+#include "RoutingTable.h"
+#include "JunctionGraph.h"
+
+const std::shared_ptr<Car> Road::noCar;
 
 Road::Road(int id, int roadSize, bool isPeriodic, double beta, int maxSpd, double brakeP, int initialNumCars, RandomNumberGenerator& gen, int queueSize = 100)
-    : roadID(id), roadSize(roadSize), isPeriodic(isPeriodic), beta(beta), newCarInserted(false), maxSpeed(maxSpd), brakeProb(brakeP), initialNumCars(initialNumCars), rng(gen), averageTravelTimes(queueSize), residenceTimes(queueSize), travelTimes(queueSize), averageSpeed(0.0)
+    : roadID(id), parentRoadID(id), lane(0), roadSize(roadSize), isPeriodic(isPeriodic), alpha(0.0), beta(beta), newCarInserted(false), maxSpeed(maxSpd), brakeProb(brakeP), initialNumCars(initialNumCars), rng(gen), averageTravelTimes(queueSize), residenceTimes(queueSize), travelTimes(queueSize), averageSpeed(0.0), storage(Storage::Dense), isSparse(false), detectorCrossings(0), nextVehicleID(nullptr), routingTable(nullptr), junctionGraph(nullptr)
 {
 }
 
 Road::Road(int id, int roadSize, bool isPeriodic, double beta, int maxSpd, double brakeP, double initialDensity, RandomNumberGenerator& gen, int queueSize = 100)
-    : roadID(id), roadSize(roadSize), isPeriodic(isPeriodic), beta(beta), newCarInserted(false), maxSpeed(maxSpd), brakeProb(brakeP), initialDensity(initialDensity), rng(gen), averageTravelTimes(queueSize), residenceTimes(queueSize), travelTimes(queueSize), averageSpeed(0.0)
+    : roadID(id), parentRoadID(id), lane(0), roadSize(roadSize), isPeriodic(isPeriodic), alpha(0.0), beta(beta), newCarInserted(false), maxSpeed(maxSpd), brakeProb(brakeP), initialDensity(initialDensity), rng(gen), averageTravelTimes(queueSize), residenceTimes(queueSize), travelTimes(queueSize), averageSpeed(0.0), storage(Storage::Dense), isSparse(false), detectorCrossings(0), nextVehicleID(nullptr), routingTable(nullptr), junctionGraph(nullptr)
 {
 }
 
 void Road::setupSections()
 {
+    sections.clear();
+    sparseSections.clear();
+    sparseCars.clear();
+    sparseWiredBits.clear();
+    sparseCarBits.clear();
+    jamTracker.setup(roadSize, isPeriodic, isSparse);
+    if (isSparse)
+    {
+        sparseWiredBits.assign((roadSize + 63) / 64, 0);
+        sparseCarBits.assign((roadSize + 63) / 64, 0);
+        return;
+    }
+
+    //One allocation for all cells; each handle aliases the shared block instead of owning a control block
+    auto storage = std::make_shared<std::vector<RoadSection>>();
+    storage->reserve(roadSize);
+
+    std::weak_ptr<Road> self = weak_from_this();
+    for (int i = 0; i < roadSize; i++)
+        storage->emplace_back(self, i);
+
     sections.reserve(roadSize);
+    for (auto& section : *storage)
+        sections.emplace_back(storage, &section);
+}
+
+Road::Storage Road::parseStorage(const std::string& name)
+{
+    if (name == "dense")
+        return Storage::Dense;
+    if (name == "sparse")
+        return Storage::Sparse;
+    if (name == "auto")
+        return Storage::Auto;
+    throw std::invalid_argument("Unknown road storage: " + name);
+}
+
+std::shared_ptr<RoadSection> Road::wiredSection(int cell)
+{
+    if (!isSparse)
+        return sections[cell];
+
+    auto& section = sparseSections[cell];
+    if (!section)
+    {
+        section = std::make_shared<RoadSection>(weak_from_this(), cell);
+        sparseWiredBits[cell >> 6] |= uint64_t(1) << (cell & 63);
+    }
+    return section;
+}
+
+std::vector<RoadSection*> Road::wiredSections() const
+{
+    std::vector<RoadSection*> wired;
+    if (isSparse)
+    {
+        for (const auto& [cell, section] : sparseSections)
+            wired.push_back(section.get());
+        std::sort(wired.begin(), wired.end(), [](const RoadSection* a, const RoadSection* b) { return a->index < b->index; });
+        return wired;
+    }
+
+    for (const auto& section : sections)
+    {
+        if (section->isSharedSection || section->trafficLight)
+            wired.push_back(section.get());
+    }
+    return wired;
+}
+
+const std::shared_ptr<Car>& Road::carAt(int cell) const
+{
+    if (!isSparse)
+        return sections[cell]->currentCar;
+    if (!(sparseCarBits[cell >> 6] >> (cell & 63) & 1))
+        return noCar;
+    return sparseCars.find(cell)->second;
+}
+
+void Road::placeCar(int cell, const std::shared_ptr<Car>& car)
+{
+    if (!isSparse)
+        sections[cell]->currentCar = car;
+    else
+    {
+        sparseCars[cell] = car;
+        sparseCarBits[cell >> 6] |= uint64_t(1) << (cell & 63);
+    }
+}
+
+void Road::clearCell(int cell)
+{
+    if (!isSparse)
+        sections[cell]->currentCar = nullptr;
+    else
+    {
+        sparseCars.erase(cell);
+        sparseCarBits[cell >> 6] &= ~(uint64_t(1) << (cell & 63));
+    }
+}
+
+RoadSection* Road::sectionAt(int cell) const
+{
+    if (!isSparse)
+        return sections[cell].get();
+    if (!(sparseWiredBits[cell >> 6] >> (cell & 63) & 1))
+        return nullptr;
+    return sparseSections.find(cell)->second.get();
+}
+
+bool Road::isSharedCell(int cell) const
+{
+    const RoadSection* section = sectionAt(cell);
+    return section && section->isSharedSection;
+}
+
+TrafficLight* Road::lightAt(int cell) const
+{
+    const RoadSection* section = sectionAt(cell);
+    return section ? section->trafficLight.get() : nullptr;
+}
+
+int Road::detectorsBelow(int cell) const
+{
+    if (!detectorsBefore.empty())
+        return detectorsBefore[cell];
+    return static_cast<int>(std::lower_bound(timeHeadwayAndFlowPoints.begin(), timeHeadwayAndFlowPoints.end(), cell) - timeHeadwayAndFlowPoints.begin());
+}
+
+std::vector<int> Road::occupiedCells() const
+{
+    std::vector<int> cells;
+    if (isSparse)
+    {
+        for (const auto& [cell, car] : sparseCars)
+            cells.push_back(cell);
+        std::sort(cells.begin(), cells.end());
+        return cells;
+    }
+
     for (int i = 0; i < roadSize; i++)
     {
-        sections.emplace_back(std::make_shared<RoadSection>(shared_from_this(), i));
+        if (sections[i]->currentCar)
+            cells.push_back(i);
     }
+    return cells;
 }
 
 void Road::simulateStep(unsigned long long currentTime)
 {
-    if (!isPeriodic && sections[0]->connectedSections.empty() && rng.getRandomDouble() < alpha)
+    PROFILE_PHASE(SimulateStep, roadID);
+
+    const RoadSection* entry = sectionAt(0);
+    if (!isPeriodic && (!entry || entry->connectedSections.empty()) && rng.getRandomDouble() < alpha)
     {
-        if (!sections[0]->currentCar)
+        if (!carAt(0))
         {
             auto newCar = std::make_shared<Car>(0, roadID);
-            sections[0]->currentCar = newCar;
+            if (nextVehicleID)
+                newCar->vehicleID = (*nextVehicleID)++;
+            if (routingTable)
+                routingTable->assignDestination(*newCar, roadID, rng);
+            placeCar(0, newCar);
             carsPositions.insert(carsPositions.begin(), 0);
             newCarInserted = true;
         }
@@ -36,14 +190,55 @@ void Road::simulateStep(unsigned long long currentTime)
     else
         newCarInserted = false;
 
+    updateSpeeds();
+
+    //Metrics based on current state (before moving cars)
+    logTimeHeadways(currentTime);
+
+    //Move cars based on their current speeds
+    moveCars();
+
+    //For open boundary, verify if the car on the last section is going to be removed
+    int lastSite = roadSize - 1;
+    if (!isPeriodic)
+    {
+        const auto& car = carAt(lastSite);
+        if (car)
+        {
+            bool carLeaves = rng.getRandomDouble() < beta;
+            if (carLeaves)
+            {
+                residenceTimes.push(car->residenceTime);
+                residenceTimeHistogram.record(car->residenceTime);
+                untrackCar(*car);
+                jamTracker.markMoving(lastSite);
+                clearCell(lastSite);
+                carsPositions.erase(std::remove(carsPositions.begin(), carsPositions.end(), lastSite), carsPositions.end());
+            }
+        }
+    }
+
+    jamTracker.endStep(currentTime);
+
+    //Metrics based on updated state (after moving cars or removing from the road)
+    calculateGeneralDensity();
+    calculateAverageDistanceHeadway();
+    calculateAverageSpeed();
+}
+
+void Road::updateSpeeds()
+{
+    PROFILE_PHASE(UpdateSpeeds, roadID);
+
     for (auto& i : carsPositions)
     {
-        auto& car = sections[i]->currentCar;
+        const auto& car = carAt(i);
 
         if (car)
         {
-            //Increasing residence time for one time step more
+            //Increasing residence time and time on the current road for one time step more
             car->residenceTime++;
+            car->timeOnCurrentRoad++;
 
             //Acceleration
             if (car->speed < maxSpeed)
@@ -52,12 +247,17 @@ void Road::simulateStep(unsigned long long currentTime)
             }
 
             //Decision to change road
-            int distanceSharedSection = calculateDistanceToSharedSection(*sections[i]);
+            int distanceSharedSection = calculateDistanceToSharedSection(i);
             if (!car->roadChangeDecisionMade && car->speed >= distanceSharedSection)
             {
-                if (rng.getRandomDouble() < changingRoadProbs.get((i + distanceSharedSection) % roadSize))
+                if (routingTable && car->destinationZone >= 0)
+                {
+                    car->indexAndTargetRoad = routingTable->nextHop(*this, (i + distanceSharedSection) % roadSize, car->destinationZone);
+                    car->willChangeRoad = (car->indexAndTargetRoad.first != -1);
+                }
+                else if (rng.getRandomDouble() < changingRoadProbs.get((i + distanceSharedSection) % roadSize))
                 {
-                    car->indexAndTargetRoad = decideTargetRoad(*sections[(i + distanceSharedSection) % roadSize]);
+                    car->indexAndTargetRoad = decideTargetRoad((i + distanceSharedSection) % roadSize);
                     car->willChangeRoad = (car->indexAndTargetRoad.first != -1);
                 }
                 else
@@ -68,7 +268,7 @@ void Road::simulateStep(unsigned long long currentTime)
             }
 
             //Braking
-            int distanceToNextCar = calculateDistanceToNextCarOrTrafficLight(*sections[i], i, distanceSharedSection);
+            int distanceToNextCar = calculateDistanceToNextCarOrTrafficLight(*car, i, distanceSharedSection);
             if (car->speed > distanceToNextCar)
             {
                 car->speed = distanceToNextCar;
@@ -90,40 +290,12 @@ void Road::simulateStep(unsigned long long currentTime)
                 car->willSurpassSharedSection = false;
             }
 
-            if (!isPeriodic && i + car->speed >= roadSize && !sections[roadSize-1]->isSharedSection)
+            if (!isPeriodic && i + car->speed >= roadSize && !isSharedCell(roadSize - 1))
             {
                 car->speed = roadSize - 1 - i; //Adjust speed to prevent out-of-bound movement
             }
         }
     }
-
-    //Metrics based on current state (before moving cars)
-    logTimeHeadways(currentTime);
-
-    //Move cars based on their current speeds
-    moveCars();
-
-    //For open boundary, verify if the car on the last section is going to be removed
-    int lastSite = roadSize - 1;
-    if (!isPeriodic)
-    {
-        auto& car = sections[lastSite]->currentCar;
-        if (car)
-        {
-            bool carLeaves = rng.getRandomDouble() < beta;
-            if (carLeaves)
-            {
-                residenceTimes.push(car->residenceTime);
-                sections[lastSite]->currentCar = nullptr;
-                carsPositions.erase(std::remove(carsPositions.begin(), carsPositions.end(), lastSite), carsPositions.end());
-            }
-        }
-    }
-
-    //Metrics based on updated state (after moving cars or removing from the road)
-    calculateGeneralDensity();
-    calculateAverageDistanceHeadway();
-    calculateAverageSpeed();
 }
 
 void Road::calculateAverageTravelTime()
@@ -133,6 +305,7 @@ void Road::calculateAverageTravelTime()
 
 void Road::calculateGeneralDensity()
 {
+    PROFILE_PHASE(GeneralDensity, roadID);
     generalDensity = static_cast<double>(carsPositions.size()) / roadSize;  
 }
 
@@ -169,33 +342,29 @@ double Road::calculateRegionalDensity(int leftBoundary, int rightBoundary)
     return static_cast<double>(carCount) / regionLength;
 }
 
-bool Road::didCarCrossPoint(int position, int newPosition, int measurementPoint)
-{
-    if (isPeriodic)
-    {
-        if (position < newPosition)
-            return (position < measurementPoint && newPosition >= measurementPoint);
-        else if (position > newPosition)
-            return (position < measurementPoint) || (newPosition >= measurementPoint);
-    }
-    else
-        return (position < measurementPoint && newPosition >= measurementPoint);
-    
-    return false;
-}
-
 void Road::calculateFlowAtPoints(int position, int newPosition)
 {
     if (position < 0 || position >= roadSize || newPosition < 0)
         return;
 
-    for (auto& point : timeHeadwayAndFlowPoints)
+    //Detectors in (position, newPosition], which wraps around on a periodic road
+    newPosition = std::min(newPosition, roadSize - 1);
+    if (position < newPosition)
+        countCrossings(detectorsBelow(position + 1), detectorsBelow(newPosition + 1));
+    else if (isPeriodic && position > newPosition)
     {
-        if(didCarCrossPoint(position, newPosition, point))
-            flowAtPoints.increment(point, 1);
+        countCrossings(detectorsBelow(position + 1), detectorsBelow(roadSize));
+        countCrossings(0, detectorsBelow(newPosition + 1));
     }
 }
 
+void Road::countCrossings(int firstDetector, int lastDetector)
+{
+    for (int detector = firstDetector; detector < lastDetector; detector++)
+        flowAtPoints[detector]++;
+    detectorCrossings += lastDetector - firstDetector;
+}
+
 int Road::calculateDistanceHeadwayBetweenTwoCars(int carIndex1, int carIndex2)
 {
     //std::sort(carsPositions.begin(), carsPositions.end(), std::greater<int>());
@@ -213,6 +382,7 @@ int Road::calculateDistanceHeadwayBetweenTwoCars(int carIndex1, int carIndex2)
 
 void Road::calculateAverageDistanceHeadway()
 {
+    PROFILE_PHASE(AverageDistanceHeadway, roadID);
     //std::sort(carsPositions.begin(), carsPositions.end(), std::greater<int>());
 
     if (carsPositions.size() < 2)
@@ -232,70 +402,89 @@ void Road::calculateAverageDistanceHeadway()
     }
 }
 
-void Road::setupTimeHeadwayAndFlowPoints(int queueSize)
+std::vector<int> Road::defaultMeasurementPoints() const
 {
-    timeHeadwayAndFlowPoints.clear();
-
     //General point in the middle of the road
-    timeHeadwayAndFlowPoints.push_back(roadSize / 2);
+    std::vector<int> points{roadSize / 2};
 
     //Points 4 sites before each traffic light
     for (int position : trafficLightPositions)
     {
-        int point;
         if (isPeriodic)
-            point = (position - 4 + roadSize) % roadSize; //Handle periodic wrapping
+            points.push_back((position - 4 + roadSize) % roadSize); //Handle periodic wrapping
         else
-        {
-            point = position - 4; //No wrapping for open boundaries
-            while (point < 0)
-                point++;
-        }
-
-        if (std::find(timeHeadwayAndFlowPoints.begin(), timeHeadwayAndFlowPoints.end(), point) == timeHeadwayAndFlowPoints.end())
-            timeHeadwayAndFlowPoints.push_back(point);
+            points.push_back(std::max(position - 4, 0)); //No wrapping for open boundaries
     }
+    return points;
+}
 
-    //Initialize last timestamps and queues for all points
-    for (int point : timeHeadwayAndFlowPoints)
+void Road::setupMeasurementPoints(std::vector<int> points, int queueSize)
+{
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    if (!points.empty() && (points.front() < 0 || points.back() >= roadSize))
+        throw std::invalid_argument("Detector outside road " + std::to_string(roadID) + ".");
+    timeHeadwayAndFlowPoints = std::move(points);
+
+    detectorsBefore.clear();
+    if (!isSparse)
     {
-        flowAtPoints.add(point, 0);
-        lastTimestamps.add(point, std::numeric_limits<unsigned long long>::max()); //No car has passed yet
-        loggedTimeHeadways.add(point, LimitedQueue<unsigned long long>(queueSize));
+        detectorsBefore.assign(roadSize + 1, 0);
+        for (int point : timeHeadwayAndFlowPoints)
+            detectorsBefore[point + 1]++;
+        std::partial_sum(detectorsBefore.begin(), detectorsBefore.end(), detectorsBefore.begin());
     }
+
+    size_t numDetectors = timeHeadwayAndFlowPoints.size();
+    flowAtPoints.assign(numDetectors, 0);
+    lastTimestamps.assign(numDetectors, std::numeric_limits<unsigned long long>::max()); //No car has passed yet
+    loggedTimeHeadways.assign(numDetectors, LimitedQueue<unsigned long long>(queueSize));
+    timeHeadwayHistograms.assign(numDetectors, LogHistogram());
+    detectorCrossings = 0;
 }
 
 void Road::logTimeHeadways(unsigned long long currentTime)
 {
-    for (int point : timeHeadwayAndFlowPoints)
+    PROFILE_PHASE(LogTimeHeadways, roadID);
+
+    for (size_t detector = 0; detector < timeHeadwayAndFlowPoints.size(); detector++)
     {
-        auto& section = sections[point];
-        if (section->currentCar)
+        if (!carAt(timeHeadwayAndFlowPoints[detector]))
+            continue;
+
+        //A car is passing this point
+        auto& lastTimestamp = lastTimestamps[detector];
+        if (lastTimestamp != std::numeric_limits<unsigned long long>::max())
         {
-            //A car is passing this point
-            if (lastTimestamps.get(point) != std::numeric_limits<unsigned long long>::max())
-            {
-                //Calculate time headway
-                unsigned long long timeHeadway = currentTime - lastTimestamps.get(point);
-                loggedTimeHeadways.get(point).push(timeHeadway); // Add to point-specific queue
-            }
-            //Update the last timestamp
-            lastTimestamps.add(point, currentTime);
+            unsigned long long timeHeadway = currentTime - lastTimestamp;
+            loggedTimeHeadways[detector].push(timeHeadway);
+            timeHeadwayHistograms[detector].record(timeHeadway);
         }
+        lastTimestamp = currentTime;
     }
 }
 
-const Dictionary<int, LimitedQueue<unsigned long long>>& Road::getLoggedTimeHeadways() const
+const std::vector<LimitedQueue<unsigned long long>>& Road::getLoggedTimeHeadways() const
 {
     return loggedTimeHeadways;
 }
 
+void Road::resetDistributions()
+{
+    for (auto& histogram : timeHeadwayHistograms)
+        histogram.clear();
+    residenceTimeHistogram.clear();
+    travelTimeHistogram.clear();
+    jamTracker.resetStatistics();
+}
+
 void Road::calculateAverageSpeed()
 {
+    PROFILE_PHASE(AverageSpeed, roadID);
     int speedSum = 0;
     for(auto& position : carsPositions)
     {
-        speedSum += sections[position]->currentCar->speed;
+        speedSum += carAt(position)->speed;
     }
     averageSpeed = static_cast<double>(speedSum) / carsPositions.size();
 }
@@ -306,7 +495,7 @@ std::vector<int> Road::getRoadRepresentation() const
 
     for (int position : carsPositions)
     {
-        auto& car = sections[position]->currentCar;
+        const auto& car = carAt(position);
         if (car)
         {
             representation[position] = car->speed;
@@ -316,163 +505,216 @@ std::vector<int> Road::getRoadRepresentation() const
     return representation;
 }
 
-int Road::measureQueueSize(int trafficLightIndex, int maxSpeedThreshold = 1)
+void Road::setupQueueTracking()
 {
-    int queueSize = 0;
-    auto wrapIndex = [&](int index) -> int
-    {
-        return (index + roadSize) % roadSize;
-    };
+    //Approach of a light: from the previous light's cell (cars there have passed it) up to the cell before it
+    approachOfCell.clear();
+    approachLights.clear();
+    if (trafficLightPositions.empty())
+        return;
 
-    int currentIndex = isPeriodic ? wrapIndex(trafficLightIndex - 1) : trafficLightIndex - 1;
+    size_t numLights = trafficLightPositions.size();
+    for (int position : trafficLightPositions)
+        approachLights.push_back(lightAt(position));
 
-    while (true)
+    for (size_t k = 0; k < numLights; k++)
     {
-        const auto& section = sections[isPeriodic ? wrapIndex(currentIndex) : currentIndex];
+        if (k + 1 < numLights)
+            approachLights[k]->downstreamLight = approachLights[k + 1];
+        else if (isPeriodic && numLights > 1)
+            approachLights[k]->downstreamLight = approachLights[0];
+        else
+            approachLights[k]->downstreamLight = nullptr;
+    }
 
-        if (currentIndex != trafficLightIndex - 1 && section->trafficLight)
-            break;
+    //A sparse road keeps searching the light positions; a dense one tabulates the search per cell
+    if (!isSparse)
+    {
+        std::vector<TrafficLight*> approach(roadSize);
+        for (int i = 0; i < roadSize; i++)
+            approach[i] = approachOf(i);
+        approachOfCell = std::move(approach);
+    }
 
-        if (section->currentCar)
-        {
-            if (section->currentCar->speed <= maxSpeedThreshold)
-                queueSize++;
-            else
-                break;
-        }
-        else
-            break;
+    recountQueues();
+}
 
-        currentIndex--;
+TrafficLight* Road::approachOf(int cell) const
+{
+    if (!approachOfCell.empty())
+        return approachOfCell[cell];
+    if (approachLights.empty())
+        return nullptr;
+
+    //On a ring the cells after the last light lead to the first one
+    size_t k = std::upper_bound(trafficLightPositions.begin(), trafficLightPositions.end(), cell) - trafficLightPositions.begin();
+    if (k < approachLights.size())
+        return approachLights[k];
+    return isPeriodic ? approachLights[0] : nullptr;
+}
 
-        if (!isPeriodic && currentIndex < 0)
-            break;
+void Road::recountQueues()
+{
+    for (auto& trafficLight : trafficLights)
+    {
+        trafficLight->queueLength = 0;
+        trafficLight->approachVehicles = 0;
     }
 
-    if (isPeriodic)
+    if (approachLights.empty())
+        return;
+
+    for (int i : occupiedCells())
     {
-        currentIndex = trafficLightIndex;
-        while (true)
+        const auto& car = carAt(i);
+        car->queueLight = approachOf(i);
+        car->queued = car->speed <= queueSpeedThreshold;
+        if (car->queueLight)
         {
-            const auto& section = sections[wrapIndex(currentIndex)];
+            car->queueLight->approachVehicles++;
+            if (car->queued)
+                car->queueLight->queueLength++;
+        }
+    }
+}
 
-            if (section->trafficLight)
-                break;
+void Road::trackCar(Car& car, int position)
+{
+    if (car.speed == 0)
+        jamTracker.markStopped(position);
 
-            if (section->currentCar)
-            {
-                if (section->currentCar->speed <= maxSpeedThreshold)
-                    queueSize++;
-                else
-                    break;
-            }
-            else
-                break;
+    TrafficLight* light = approachOf(position);
+    bool queued = car.speed <= queueSpeedThreshold;
+    if (light == car.queueLight && queued == car.queued)
+        return;
 
-            currentIndex++;
-            if (wrapIndex(currentIndex) == wrapIndex(trafficLightIndex - 1))
-                break;
+    if (light != car.queueLight)
+    {
+        untrackCar(car);
+        car.queueLight = light;
+        car.queued = false;
+        if (light)
+        {
+            light->approachVehicles++;
+            light->arrivals++;
         }
     }
 
-    return queueSize;
+    if (light && queued != car.queued)
+        light->queueLength += queued ? 1 : -1;
+    car.queued = queued;
 }
 
-std::vector<std::pair<int, int>> Road::detectJams()
+void Road::untrackCar(Car& car)
 {
-    std::vector<std::pair<int, int>> jams;
-    if (carsPositions.size() >= 3)
+    if (car.queueLight)
     {
-        std::sort(carsPositions.begin(), carsPositions.end());
+        car.queueLight->approachVehicles--;
+        car.queueLight->departures++;
+        if (car.queued)
+            car.queueLight->queueLength--;
+    }
+    car.queueLight = nullptr;
+    car.queued = false;
+}
 
-        std::vector<std::pair<int, int>> jams; //starting position, size of jam
-        int consecutiveStoppedCars = 1;
-        int firstCarInJam = carsPositions[0];
+std::vector<std::pair<int, int>> Road::detectJams()
+{
+    //Upstream cell and size of each jam, maintained by jamTracker as cars stop and start
+    std::vector<std::pair<int, int>> jams;
+    for (const auto& jam : jamTracker.activeJams())
+        jams.push_back({jam.back, jam.size});
+    return jams;
+}
 
-        for (size_t i = 1; i < carsPositions.size(); i++)
+void Road::checkJams(unsigned long long currentTime) const
+{
+    //Brute-force scan of the runs of stopped cars, compared with the ones jamTracker maintains.
+    //A ring is scanned from a free cell so that no run is cut at cell 0.
+    auto stoppedAt = [this](int cell) { const auto& car = carAt(cell); return car && car->speed == 0; };
+    int start = 0;
+    while (isPeriodic && start < roadSize && stoppedAt(start))
+        start++;
+
+    std::vector<std::pair<int, int>> expected;
+    if (start == roadSize)
+        expected.push_back({0, roadSize});
+    else
+    {
+        int size = 0;
+        for (int offset = 0; offset < roadSize; offset++)
         {
-            int distance = (carsPositions[i] - carsPositions[i - 1]);
-
-            if (distance == 1)
+            int cell = (start + offset) % roadSize;
+            if (stoppedAt(cell))
+                size++;
+            else if (size > 0)
             {
-                auto& prevCar = sections[carsPositions[i - 1]]->currentCar;
-                auto& currCar = sections[carsPositions[i]]->currentCar;
-
-                if (prevCar && currCar && prevCar->speed == 0 && currCar->speed == 0)
-                {
-                    consecutiveStoppedCars++;
-
-                    if (consecutiveStoppedCars == 3)
-                    {
-                        jams.push_back({firstCarInJam, consecutiveStoppedCars});
-                    }
-                    else if (consecutiveStoppedCars > 3)
-                    {
-                        jams.back().second = consecutiveStoppedCars;
-                    }
-                }
-                else
-                {
-                    consecutiveStoppedCars = 1;
-                    firstCarInJam = carsPositions[i];
-                }
-            }
-            else
-            {
-                consecutiveStoppedCars = 1;
-                firstCarInJam = carsPositions[i];
+                expected.push_back({(cell - size + roadSize) % roadSize, size});
+                size = 0;
             }
         }
+        if (size > 0)
+            expected.push_back({(start - size + roadSize) % roadSize, size});
+        std::sort(expected.begin(), expected.end());
+    }
 
-        if (isPeriodic)
-        {
-            int circularDistance = (carsPositions[0] - carsPositions.back() + roadSize) % roadSize;
-            if (circularDistance == 1)
-            {
-                auto& lastCar = sections[carsPositions.back()]->currentCar;
-                auto& firstCar = sections[carsPositions[0]]->currentCar;
+    auto tracked = jamTracker.stoppedRuns();
+    if (tracked.size() == 1 && tracked[0].second == roadSize)
+        tracked[0].first = 0; //A full ring has no back cell of its own
+    if (tracked != expected)
+        throw std::logic_error("Jam tracker of road " + std::to_string(roadID) + " disagrees with a recount at step " + std::to_string(currentTime));
+}
 
-                if (lastCar && firstCar && lastCar->speed == 0 && firstCar->speed == 0)
-                {
-                    consecutiveStoppedCars++;
-                    if (consecutiveStoppedCars >= 3)
-                    {
-                        if (!jams.empty() && jams.back().first == firstCarInJam)
-                        {
-                            jams.back().second = consecutiveStoppedCars;
-                        }
-                        else
-                        {
-                            jams.push_back({firstCarInJam, consecutiveStoppedCars});
-                        }
-                    }
-                }
-            }
+void Road::checkQueues(unsigned long long currentTime) const
+{
+    //Full recount of every approach, compared with the counts trackCar and untrackCar maintain
+    std::unordered_map<const TrafficLight*, std::pair<int, int>> expected; //Light -> queued cars, all cars
+    for (int i : occupiedCells())
+    {
+        const auto& car = carAt(i);
+        TrafficLight* light = approachOf(i);
+        bool queued = car->speed <= queueSpeedThreshold;
+        if (car->queueLight != light || (light && car->queued != queued))
+            throw std::logic_error("Car in cell " + std::to_string(i) + " of road " + std::to_string(roadID) + " is tracked in the wrong queue at step " + std::to_string(currentTime));
+        if (light)
+        {
+            expected[light].second++;
+            if (queued)
+                expected[light].first++;
         }
     }
-    return jams;
+
+    for (const auto& trafficLight : trafficLights)
+    {
+        auto counts = expected[trafficLight.get()];
+        if (trafficLight->queueLength != counts.first || trafficLight->approachVehicles != counts.second)
+            throw std::logic_error("Queue of the light in cell " + std::to_string(trafficLight->roadPosition) + " of road " + std::to_string(roadID) +
+                                   " disagrees with a recount at step " + std::to_string(currentTime));
+    }
 }
 
 void Road::addCars(int numCars, int position)
 {
     if (position == -1)
     {
-        std::vector<int> positions(roadSize);
-        std::iota(positions.begin(), positions.end(), 0);
-        std::shuffle(positions.begin(), positions.end(), rng.getGenerator());
-
-        for (int i = 0; i < numCars; ++i)
+        //Floyd's sampling: numCars distinct positions in O(numCars), the occupied sections act as the sample set
+        numCars = std::min(numCars, roadSize);
+        carsPositions.reserve(carsPositions.size() + numCars);
+        for (int candidateMax = roadSize - numCars; candidateMax < roadSize; candidateMax++)
         {
-            int selectedPosition = positions[i];
-            sections[selectedPosition]->currentCar = std::make_shared<Car>(selectedPosition, roadID);
+            int selectedPosition = rng.getRandomInt(0, candidateMax);
+            if (carAt(selectedPosition))
+                selectedPosition = candidateMax;
+
+            placeCar(selectedPosition, std::make_shared<Car>(selectedPosition, roadID));
             carsPositions.push_back(selectedPosition);
         }
     }
     else
     {
-        if (!sections[position]->currentCar)
+        if (!carAt(position))
         {
-            sections[position]->currentCar = std::make_shared<Car>(position, roadID);
+            placeCar(position, std::make_shared<Car>(position, roadID));
             carsPositions.push_back(position);
         }
     }
@@ -496,37 +738,43 @@ void Road::addCarsBasedOnDensity(double density)
 
 void Road::moveCars()
 {
+    PROFILE_PHASE(MoveCars, roadID);
+
     for (auto& i : carsPositions)
     {
-        auto& car = sections[i]->currentCar;
+        const auto& car = carAt(i);
 
         if (car && car->speed > 0)
         {
             int newPos;
             if (car->willChangeRoad && car->willSurpassSharedSection)
             {
-                int distanceToSharedSection = calculateDistanceToSharedSection(*sections[i]);
+                int distanceToSharedSection = calculateDistanceToSharedSection(i);
                 int remainingMove = car->speed - distanceToSharedSection;
-                std::shared_ptr<Road> newRoad = car->indexAndTargetRoad.second.lock();
+                Road* newRoad = car->indexAndTargetRoad.second;
 
                 if (newRoad && newRoad->roadSize > 0)
                 {
                     newPos = (car->indexAndTargetRoad.first + remainingMove) % newRoad->roadSize;
 
-                    if (newRoad->sections[newPos]->currentCar == nullptr)
+                    if (!newRoad->carAt(newPos))
                     {
-                        travelTimes.push(car->timeOnCurrentRoad);
-                        car->timeOnCurrentRoad = 0;
-                        calculateAverageTravelTime();
-
-                        if (newRoad->sections[newPos]->trafficLight && !newRoad->sections[newPos]->trafficLight->state)
+                        TrafficLight* light = newRoad->lightAt(newPos);
+                        if (light && !light->state)
                         {
                             car->speed = 0;
+                            trackCar(*car, i);
                             newCarsPositions.push_back(i);
                             continue;
                         }
 
-                        newRoad->sections[newPos]->currentCar = car;
+                        //The trip on this road ends only once the turn goes through
+                        travelTimes.push(car->timeOnCurrentRoad);
+                        travelTimeHistogram.record(car->timeOnCurrentRoad);
+                        car->timeOnCurrentRoad = 0;
+                        calculateAverageTravelTime();
+
+                        newRoad->placeCar(newPos, car);
                         car->position = newPos;
                         car->willChangeRoad = false;
                         car->roadChangeDecisionMade = false;
@@ -537,11 +785,18 @@ void Road::moveCars()
                             car->speed = newRoad->maxSpeed;
                         }
                         newRoad->carsPositions.push_back(newPos);
-                        sections[i]->currentCar = nullptr;
+                        newRoad->trackCar(*car, newPos);
+
+                        //On a ring network a trip that ends is followed by the next one
+                        if (routingTable && newRoad->isPeriodic && routingTable->isInZone(newRoad->roadID, car->destinationZone))
+                            routingTable->assignDestination(*car, newRoad->roadID, rng);
+                        jamTracker.markMoving(i);
+                        clearCell(i);
                     }
                     else
                     {
                         car->speed = 0;
+                        trackCar(*car, i);
                         newCarsPositions.push_back(i);
                         continue;
                     }
@@ -549,6 +804,7 @@ void Road::moveCars()
                 else
                 {
                     car->speed = 0;
+                    trackCar(*car, i);
                     newCarsPositions.push_back(i);
                     continue;
                 }
@@ -557,33 +813,43 @@ void Road::moveCars()
             {
                 newPos = (i + car->speed) % roadSize;
 
-                if (sections[newPos]->currentCar)
+                if (carAt(newPos))
                     std::cout << "There is already a car in the new position" << std::endl;
 
-                if (sections[newPos]->currentCar == nullptr)
+                if (!carAt(newPos))
                 {
-                    if (sections[newPos]->trafficLight && !sections[newPos]->trafficLight->state)
+                    TrafficLight* light = lightAt(newPos);
+                    if (light && !light->state)
                     {
                         car->speed = 0;
+                        trackCar(*car, i);
                         newCarsPositions.push_back(i);
                         continue;
                     }
 
-                    sections[newPos]->currentCar = car;
+                    placeCar(newPos, car);
                     car->position = newPos;
-                    sections[i]->currentCar = nullptr;
+                    trackCar(*car, newPos);
+
+                    //A routed car decides again at every shared section, also after staying on the road
+                    if (routingTable && car->destinationZone >= 0 && car->willSurpassSharedSection)
+                        car->roadChangeDecisionMade = false;
+                    jamTracker.markMoving(i);
+                    clearCell(i);
                     newCarsPositions.push_back(newPos);
                     calculateFlowAtPoints(i, newPos);
                 }
                 else
                 {
                     car->speed = 0;
+                    trackCar(*car, i);
                     newCarsPositions.push_back(i);
                 }
             }
         }
         else if (car && car->speed == 0)
         {
+            trackCar(*car, i);
             newCarsPositions.push_back(i);
         }
         else
@@ -597,41 +863,28 @@ void Road::moveCars()
 }
 
 
-std::pair<int, std::shared_ptr<Road>> Road::decideTargetRoad(RoadSection& section)
+std::pair<int, Road*> Road::decideTargetRoad(int cell)
 {
-    std::vector<std::pair<int, std::shared_ptr<Road>>> potentialRoads;
-
-    for (auto& weakConnSection : section.connectedSections)
+    auto turns = junctionGraph->turns(roadID, cell);
+    if (!turns.empty())
     {
-        auto connSection = weakConnSection.lock();
-        if (connSection)
-        {
-            auto connRoad = connSection->road.lock();
-            if (connRoad && connRoad->roadID != roadID)
-            {
-                potentialRoads.emplace_back(connSection->index, connRoad);
-            }
-        }
+        std::uniform_int_distribution<> dist(0, turns.size() - 1);
+        const auto& turn = turns[dist(rng.getGenerator())];
+        return std::make_pair(turn.cell, junctionGraph->road(turn.roadID));
     }
 
-    if (!potentialRoads.empty())
-    {
-        std::uniform_int_distribution<> dist(0, potentialRoads.size() - 1);
-        return potentialRoads[dist(rng.getGenerator())];
-    }
-
-    return std::make_pair(-1, std::shared_ptr<Road>());
+    return std::make_pair(-1, nullptr);
 }
 
-int Road::calculateDistanceToSharedSection(RoadSection& currentSection)
+int Road::calculateDistanceToSharedSection(int position)
 {
     int distance = 0;
     int maxLookahead = maxSpeed;
 
     for (int d = 1; d <= maxLookahead; ++d)
     {
-        int index = (currentSection.index + d) % roadSize;
-        if (sections[index]->isSharedSection)
+        int index = (position + d) % roadSize;
+        if (isSharedCell(index))
         {
             return d;
         }
@@ -640,43 +893,45 @@ int Road::calculateDistanceToSharedSection(RoadSection& currentSection)
     return roadSize;
 }
 
-int Road::calculateDistanceToNextCarOrTrafficLight(RoadSection& currentSection, int currentPosition, int distanceSharedSection)
+int Road::calculateDistanceToNextCarOrTrafficLight(const Car& car, int currentPosition, int distanceSharedSection)
 {
-    int maxSpeed = currentSection.currentCar->speed;
+    int maxSpeed = car.speed;
 
     for (int d = 1; d <= maxSpeed; ++d)
     {
         int index = (currentPosition + d) % roadSize;
 
-        if (sections[index]->currentCar)
+        if (carAt(index))
             return d - 1;
 
-        if (sections[index]->trafficLight && !sections[index]->trafficLight->state)
+        const RoadSection* section = sectionAt(index);
+        if (section && section->trafficLight && !section->trafficLight->state)
             return d;
 
-        if (anyCarInSharedSection(*sections[index]))
+        if (section && section->isSharedSection && anyCarConnectedTo(*section))
             return d - 1;
 
-        if (currentSection.currentCar->willChangeRoad && currentSection.currentCar->roadChangeDecisionMade && d == distanceSharedSection)
+        if (car.willChangeRoad && car.roadChangeDecisionMade && d == distanceSharedSection)
         {
-            std::shared_ptr<Road> newRoad = currentSection.currentCar->indexAndTargetRoad.second.lock();
+            Road* newRoad = car.indexAndTargetRoad.second;
             if (newRoad)
             {
                 int remainingMove = maxSpeed - distanceSharedSection;
-                int newRoadIndex = (currentSection.currentCar->indexAndTargetRoad.first + remainingMove) % newRoad->roadSize;
+                int newRoadIndex = (car.indexAndTargetRoad.first + remainingMove) % newRoad->roadSize;
 
-                if (newRoad->sections[newRoadIndex]->currentCar)
+                if (newRoad->carAt(newRoadIndex))
                     return d - 1;
 
-                if (newRoad->sections[newRoadIndex]->trafficLight && !newRoad->sections[newRoadIndex]->trafficLight->state)
+                TrafficLight* light = newRoad->lightAt(newRoadIndex);
+                if (light && !light->state)
                 {
-                    if (newRoadIndex == currentSection.currentCar->indexAndTargetRoad.first)
+                    if (newRoadIndex == car.indexAndTargetRoad.first)
                         return d;
                     else
                         continue;
                 }
 
-                if (anyCarInSharedSection(*newRoad->sections[newRoadIndex]))
+                if (newRoad->anyCarInSharedSection(newRoadIndex))
                     return d - 1;
             }
             else
@@ -689,20 +944,134 @@ int Road::calculateDistanceToNextCarOrTrafficLight(RoadSection& currentSection,
     return maxSpeed;
 }
 
-bool Road::anyCarInSharedSection(RoadSection& section)
+bool Road::anyCarInSharedSection(int cell) const
 {
-    if (section.isSharedSection)
+    const RoadSection* section = sectionAt(cell);
+    return section && section->isSharedSection && anyCarConnectedTo(*section);
+}
+
+bool Road::anyCarConnectedTo(const RoadSection& section) const
+{
+    for (const auto& connection : junctionGraph->connections(section.junctionIndex))
     {
-        for (auto& weakConnSection : section.connectedSections)
-        {
-            auto connSection = weakConnSection.lock();
-            if (connSection && connSection->currentCar)
-                return true;
-        }
+        if (junctionGraph->road(connection.roadID)->carAt(connection.cell))
+            return true;
     }
     return false;
 }
 
+void Road::saveState(ByteWriter& output) const
+{
+    Checkpoint::writeValue(output, roadSize);
+    Checkpoint::writeValue(output, alpha);
+    Checkpoint::writeValue(output, beta);
+    Checkpoint::writeValue(output, newCarInserted);
+    Checkpoint::writeValue(output, generalDensity);
+    Checkpoint::writeValue(output, averageDistanceHeadway);
+    Checkpoint::writeValue(output, averageSpeed);
+
+    //Cars are stored per occupied section; carsPositions keeps its own order since it drives the update order
+    std::vector<int> occupiedSections = occupiedCells();
+    output.writeVarint(occupiedSections.size());
+    for (int index : occupiedSections)
+    {
+        Checkpoint::writeValue(output, index);
+        carAt(index)->saveState(output);
+    }
+
+    output.writeVarint(carsPositions.size());
+    for (int position : carsPositions)
+        Checkpoint::writeValue(output, position);
+
+    for (size_t detector = 0; detector < timeHeadwayAndFlowPoints.size(); detector++)
+    {
+        Checkpoint::writeValue(output, timeHeadwayAndFlowPoints[detector]);
+        Checkpoint::writeValue(output, flowAtPoints[detector]);
+    }
+    for (unsigned long long timestamp : lastTimestamps)
+        Checkpoint::writeValue(output, timestamp);
+    for (const auto& queue : loggedTimeHeadways)
+        Checkpoint::writeQueue(output, queue);
+
+    Checkpoint::writeQueue(output, residenceTimes);
+    Checkpoint::writeQueue(output, travelTimes);
+    Checkpoint::writeQueue(output, averageTravelTimes);
+
+    for (const auto& histogram : timeHeadwayHistograms)
+        histogram.saveState(output);
+    residenceTimeHistogram.saveState(output);
+    travelTimeHistogram.saveState(output);
+    jamTracker.saveState(output);
+
+    output.writeVarint(trafficLights.size());
+    for (const auto& trafficLight : trafficLights)
+        trafficLight->saveState(output);
+}
+
+void Road::loadState(ByteReader& input, const std::vector<std::shared_ptr<Road>>& roads)
+{
+    if (Checkpoint::readValue<int>(input) != roadSize)
+        throw std::runtime_error("Checkpoint does not match the size of road " + std::to_string(roadID) + ".");
+
+    alpha = Checkpoint::readValue<double>(input);
+    beta = Checkpoint::readValue<double>(input);
+    newCarInserted = Checkpoint::readValue<bool>(input);
+    generalDensity = Checkpoint::readValue<double>(input);
+    averageDistanceHeadway = Checkpoint::readValue<double>(input);
+    averageSpeed = Checkpoint::readValue<double>(input);
+
+    for (auto& section : sections)
+        section->currentCar = nullptr;
+    sparseCars.clear();
+    std::fill(sparseCarBits.begin(), sparseCarBits.end(), 0);
+
+    size_t numOccupied = input.readVarint();
+    for (size_t i = 0; i < numOccupied; i++)
+    {
+        int index = Checkpoint::readValue<int>(input);
+        if (index < 0 || index >= roadSize)
+            throw std::runtime_error("Invalid car position in checkpoint for road " + std::to_string(roadID) + ".");
+
+        auto car = std::make_shared<Car>(index, roadID);
+        car->loadState(input, roads);
+        placeCar(index, car);
+    }
+
+    carsPositions.resize(input.readVarint());
+    for (auto& position : carsPositions)
+        position = Checkpoint::readValue<int>(input);
+    newCarsPositions.clear();
+
+    detectorCrossings = 0;
+    for (size_t detector = 0; detector < timeHeadwayAndFlowPoints.size(); detector++)
+    {
+        if (Checkpoint::readValue<int>(input) != timeHeadwayAndFlowPoints[detector])
+            throw std::runtime_error("Checkpoint does not match the measurement points of road " + std::to_string(roadID) + ".");
+        flowAtPoints[detector] = Checkpoint::readValue<int>(input);
+        detectorCrossings += flowAtPoints[detector];
+    }
+    for (auto& timestamp : lastTimestamps)
+        timestamp = Checkpoint::readValue<unsigned long long>(input);
+    for (auto& queue : loggedTimeHeadways)
+        Checkpoint::readQueue(input, queue);
+
+    Checkpoint::readQueue(input, residenceTimes);
+    Checkpoint::readQueue(input, travelTimes);
+    Checkpoint::readQueue(input, averageTravelTimes);
+
+    for (auto& histogram : timeHeadwayHistograms)
+        histogram.loadState(input);
+    residenceTimeHistogram.loadState(input);
+    travelTimeHistogram.loadState(input);
+    jamTracker.loadState(input);
+
+    if (input.readVarint() != trafficLights.size())
+        throw std::runtime_error("Checkpoint does not match the traffic lights of road " + std::to_string(roadID) + ".");
+    for (auto& trafficLight : trafficLights)
+        trafficLight->loadState(input);
+    recountQueues();
+}
+
 Road::~Road()
 {
 }
\ No newline at end of file
@@ -6,25 +6,55 @@
 #include <iostream>
 #include <random>
 #include <limits>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+#include <string>
 #include "RoadSection.h"
 #include "TrafficLight.h"
 #include "RandomNumberGenerator.h"
 #include "LimitedQueue.h"
+#include "LogHistogram.h"
+#include "JamTracker.h"
 #include "Dictionary.h"
+#include "ByteStream.h"
 
 class RoadSection;
 class TrafficLight;
+class Car;
+class RoutingTable;
+class JunctionGraph;
 
+//A dense road keeps one RoadSection per cell. A sparse road keeps only its cars and the
+//sections that are wired to a junction or hold a light, in hash maps keyed by cell, plus one
+//bit per cell for each map so that the look-ahead over empty cells does not hash. Its memory
+//follows the number of cars instead of roadSize. The step rules read cells through carAt,
+//sectionAt and lightAt and behave the same either way.
 class Road : public std::enable_shared_from_this<Road>
 {
 public:
+    enum class Storage
+    {
+        Dense,
+        Sparse,
+        Auto //Resolved by Simulation from the initial density before setupSections
+    };
+
     int roadID;
+    int parentRoadID; //roadID of lane 0 of the same road, the road itself when it has one lane
+    int lane; //Index across the road, 0 is the rightmost lane, see LaneGroup
     int roadSize;
     bool isPeriodic;
     double generalDensity;
     double averageDistanceHeadway;
     double averageSpeed;
-    std::vector<std::shared_ptr<RoadSection>> sections;
+    Storage storage;
+    bool isSparse;
+    std::vector<std::shared_ptr<RoadSection>> sections; //One per cell, empty on a sparse road
+    std::unordered_map<int, std::shared_ptr<RoadSection>> sparseSections; //Wired cells of a sparse road
+    std::unordered_map<int, std::shared_ptr<Car>> sparseCars; //Occupied cells of a sparse road
+    std::vector<uint64_t> sparseWiredBits; //Cells in sparseSections
+    std::vector<uint64_t> sparseCarBits; //Cells in sparseCars
     std::vector<std::shared_ptr<Road>> connectedRoads;
     double alpha;
     double beta;
@@ -41,40 +71,79 @@ public:
     LimitedQueue<int> residenceTimes;
     LimitedQueue<int> travelTimes;
     LimitedQueue<double> averageTravelTimes;
-    Dictionary<int, int> flowAtPoints;
-    std::vector<int> timeHeadwayAndFlowPoints; //Indices of time headway points
-    Dictionary<int, unsigned long long> lastTimestamps; //Last timestamp a car passed each point
-    Dictionary<int, LimitedQueue<unsigned long long>> loggedTimeHeadways; //Logged time headways for each point
+    std::vector<int> timeHeadwayAndFlowPoints; //Cells of the detectors in ascending order, indexed by detector
+    std::vector<int> detectorsBefore; //Number of detectors below each cell, roadSize + 1 entries; empty on a sparse road
+    std::vector<int> flowAtPoints; //Per detector
+    unsigned long long detectorCrossings; //Sum of flowAtPoints over all points
+    std::vector<unsigned long long> lastTimestamps; //Last timestamp a car passed each point
+    std::vector<LimitedQueue<unsigned long long>> loggedTimeHeadways; //Logged time headways for each point
+    std::vector<LogHistogram> timeHeadwayHistograms; //Every time headway logged at each point
+    LogHistogram residenceTimeHistogram;
+    LogHistogram travelTimeHistogram;
+    JamTracker jamTracker;
     std::vector<std::shared_ptr<TrafficLight>> trafficLights;
+    uint32_t* nextVehicleID; //Counter shared by all roads of a simulation, nullptr until IDs are assigned
+    const RoutingTable* routingTable; //nullptr unless origin-destination routing is configured
+    const JunctionGraph* junctionGraph; //Compiled shared-section wiring, set by Simulation::setup
+    std::vector<TrafficLight*> approachOfCell; //Light whose queue a car in each cell belongs to, nullptr past the last light of an open road
+    std::vector<TrafficLight*> approachLights; //Light at each of trafficLightPositions, searched instead of approachOfCell on a sparse road
     RandomNumberGenerator& rng;
 
+    static constexpr int queueSpeedThreshold = 1; //Cars at or below this speed count as queued
+    static const std::shared_ptr<Car> noCar;
+
     Road(int id, int roadSize, bool isPeriodic, double beta, int maxSpd, double brakeP, int initialNumCars, RandomNumberGenerator& gen, int queueSize);
     Road(int id, int roadSize, bool isPeriodic, double beta, int maxSpd, double brakeP, double initialDensity, RandomNumberGenerator& gen, int queueSize);
     Road(const Road&) = delete;
     Road& operator=(const Road&) = delete;
     void setupSections();
+    static Storage parseStorage(const std::string& name);
+    std::shared_ptr<RoadSection> wiredSection(int cell); //For wiring during setup; creates the section of a sparse road's cell
+    std::vector<RoadSection*> wiredSections() const; //Sections with a connection or a light, in cell order
+    std::vector<int> occupiedCells() const; //In cell order
+
+    const std::shared_ptr<Car>& carAt(int cell) const;
+    void placeCar(int cell, const std::shared_ptr<Car>& car);
+    void clearCell(int cell);
+    RoadSection* sectionAt(int cell) const; //nullptr for an unwired cell of a sparse road
+    bool isSharedCell(int cell) const;
+    TrafficLight* lightAt(int cell) const;
+    int detectorsBelow(int cell) const;
+    TrafficLight* approachOf(int cell) const;
+
     void simulateStep(unsigned long long currentTime);
+    void updateSpeeds();
     void moveCars();
     void calculateAverageTravelTime();
     void calculateGeneralDensity();
     double calculateRegionalDensity(int leftBoundary, int rightBoundary);
-    bool didCarCrossPoint(int position, int newPosition, int measurementPoint);
     void calculateFlowAtPoints(int position, int newPosition);
+    void countCrossings(int firstDetector, int lastDetector);
     int calculateDistanceHeadwayBetweenTwoCars(int carIndex1, int carIndex2);
     void calculateAverageDistanceHeadway();
     void calculateAverageSpeed();
-    void setupTimeHeadwayAndFlowPoints(int queueSize);
+    std::vector<int> defaultMeasurementPoints() const;
+    void setupMeasurementPoints(std::vector<int> points, int queueSize);
     void logTimeHeadways(unsigned long long currentTime);
-    int measureQueueSize(int trafficLightIndex, int maxSpeedThreshold);
-    const Dictionary<int, LimitedQueue<unsigned long long>>& getLoggedTimeHeadways() const;
+    void setupQueueTracking();
+    void recountQueues();
+    void trackCar(Car& car, int position);
+    void untrackCar(Car& car);
+    const std::vector<LimitedQueue<unsigned long long>>& getLoggedTimeHeadways() const;
+    void resetDistributions();
     std::vector<int> getRoadRepresentation() const;
     std::vector<std::pair<int, int>> detectJams();
+    void checkJams(unsigned long long currentTime) const;
+    void checkQueues(unsigned long long currentTime) const;
     void addCars(int numCars, int position = -1);
     void addCarsBasedOnDensity(double density);
-    int calculateDistanceToNextCarOrTrafficLight(RoadSection& currentSection, int currentPosition, int distanceSharedSection);
-    bool anyCarInSharedSection(RoadSection& section);
-    int calculateDistanceToSharedSection(RoadSection& currentSection);
-    std::pair<int, std::shared_ptr<Road>> decideTargetRoad(RoadSection& section);
+    int calculateDistanceToNextCarOrTrafficLight(const Car& car, int currentPosition, int distanceSharedSection);
+    bool anyCarInSharedSection(int cell) const;
+    bool anyCarConnectedTo(const RoadSection& section) const;
+    int calculateDistanceToSharedSection(int position);
+    std::pair<int, Road*> decideTargetRoad(int cell);
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input, const std::vector<std::shared_ptr<Road>>& roads);
     ~Road();
 };
 
@@ -1,7 +1,7 @@
 #include "RoadSection.h"
 
-RoadSection::RoadSection(std::shared_ptr<Road> roadPtr, int idx)
-    : road(roadPtr), index(idx), currentCar(nullptr), trafficLight(nullptr), isSharedSection(false){}
+RoadSection::RoadSection(std::weak_ptr<Road> roadPtr, int idx)
+    : currentCar(nullptr), isSharedSection(false), road(roadPtr), trafficLight(nullptr), index(idx), junctionIndex(-1){}
 
 
 RoadSection::~RoadSection()
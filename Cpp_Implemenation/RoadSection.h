@@ -10,7 +10,7 @@ class Road;
 class Car;
 class TrafficLight;
 
-class RoadSection: public std::enable_shared_from_this<RoadSection>
+class RoadSection
 {
 public:
     std::shared_ptr<Car> currentCar;
@@ -19,10 +19,11 @@ public:
     std::weak_ptr<Road> road;
     std::shared_ptr<TrafficLight> trafficLight;
     int index;
+    int junctionIndex; //Index of a shared section in the JunctionGraph, -1 otherwise
 
     RoadSection();
 
-    RoadSection(std::shared_ptr<Road> road, int index);
+    RoadSection(std::weak_ptr<Road> road, int index);
 
     void addCar();
 
@@ -0,0 +1,329 @@
+#include "RoutingTable.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+RoutingTable::RoutingTable(const std::vector<std::shared_ptr<Road>>& roads, const JunctionGraph& junctionGraph, const nlohmann::json& settings)
+    : roads(roads), junctionGraph(junctionGraph), zoneCount(0)
+{
+    zoneOfRoad.assign(roads.size(), -1);
+    if (settings.contains("zones"))
+    {
+        for (const auto& zone : settings["zones"])
+        {
+            for (int roadID : zone)
+            {
+                if (roadID < 0 || roadID >= static_cast<int>(roads.size()))
+                    throw std::invalid_argument("Invalid roadID in routing zone: " + std::to_string(roadID));
+                if (zoneOfRoad[roadID] >= 0)
+                    throw std::invalid_argument("Road " + std::to_string(roadID) + " is in more than one routing zone.");
+                zoneOfRoad[roadID] = static_cast<int>(zoneCount);
+            }
+            zoneCount++;
+        }
+
+        //Lanes not listed themselves go where their road goes
+        for (size_t i = 0; i < roads.size(); i++)
+        {
+            if (zoneOfRoad[i] < 0)
+                zoneOfRoad[i] = zoneOfRoad[roads[i]->parentRoadID];
+        }
+    }
+    else
+    {
+        //One zone per configured road, numbered by its roadID; extra lanes leave their IDs unused
+        for (size_t i = 0; i < roads.size(); i++)
+            zoneOfRoad[i] = roads[i]->parentRoadID;
+        zoneCount = roads.size();
+    }
+
+    demandSettings = settings.value("demand", nlohmann::json::array());
+    buildGraph();
+}
+
+size_t RoutingTable::numNodes() const
+{
+    return roadOfNode.size();
+}
+
+size_t RoutingTable::numZones() const
+{
+    return zoneCount;
+}
+
+void RoutingTable::buildGraph()
+{
+    //Nodes: the distinct shared sections of each road, in the direction of travel
+    std::vector<std::vector<int>> positionsOfRoad(roads.size());
+    firstNodeOfRoad.assign(roads.size(), -1);
+    for (size_t r = 0; r < roads.size(); r++)
+    {
+        auto& positions = positionsOfRoad[r];
+        positions = roads[r]->sharedSectionsPositions;
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    }
+
+    nodeOfCell.assign(junctionGraph.numCells(), -1);
+    roadOfNode.clear();
+    for (size_t r = 0; r < roads.size(); r++)
+    {
+        if (!positionsOfRoad[r].empty())
+            firstNodeOfRoad[r] = static_cast<int>(roadOfNode.size());
+        for (int position : positionsOfRoad[r])
+        {
+            nodeOfCell[junctionGraph.cellIndex(static_cast<int>(r), position)] = static_cast<int>(roadOfNode.size());
+            roadOfNode.push_back(static_cast<int>(r));
+        }
+    }
+
+    //The node a car reaches after passing cell on road r, with the cells travelled to it
+    auto nextNode = [&](int r, int cell, int& length)
+    {
+        const auto& positions = positionsOfRoad[r];
+        auto it = std::upper_bound(positions.begin(), positions.end(), cell);
+        if (it != positions.end())
+        {
+            length = *it - cell;
+            return nodeOfCell[junctionGraph.cellIndex(r, *it)];
+        }
+        if (!roads[r]->isPeriodic || positions.empty())
+        {
+            length = roads[r]->roadSize - cell;
+            return -1;
+        }
+        length = roads[r]->roadSize - cell + positions.front();
+        return nodeOfCell[junctionGraph.cellIndex(r, positions.front())];
+    };
+
+    edges.clear();
+    for (size_t r = 0; r < roads.size(); r++)
+    {
+        const auto& road = *roads[r];
+        for (int position : positionsOfRoad[r])
+        {
+            int node = nodeOfCell[junctionGraph.cellIndex(static_cast<int>(r), position)];
+            int length;
+            int target = nextNode(static_cast<int>(r), position, length);
+            if (target != node)
+                edges.push_back(Edge{node, target, static_cast<int>(r), length, stay});
+
+            //Turns the random walk never takes, with a zero changing probability, are not offered either
+            if (!road.changingRoadProbs.isThere(position) || road.changingRoadProbs.get(position) <= 0.0)
+                continue;
+            auto turns = junctionGraph.turns(road.roadID, position);
+            if (turns.size() >= noRoute)
+                throw std::runtime_error("Too many roads meet at cell " + std::to_string(position) + " of road " + std::to_string(r) + " for routing.");
+
+            for (size_t i = 0; i < turns.size(); i++)
+            {
+                target = nextNode(turns[i].roadID, turns[i].cell, length);
+                edges.push_back(Edge{node, target, turns[i].roadID, length, static_cast<uint8_t>(i + 1)});
+            }
+        }
+    }
+
+    incomingOffsets.assign(numNodes() + 1, 0);
+    for (const auto& edge : edges)
+    {
+        if (edge.to >= 0)
+            incomingOffsets[edge.to + 1]++;
+    }
+    for (size_t node = 0; node < numNodes(); node++)
+        incomingOffsets[node + 1] += incomingOffsets[node];
+
+    std::vector<size_t> filled(incomingOffsets.begin(), incomingOffsets.end() - 1);
+    incomingEdges.assign(incomingOffsets.back(), 0);
+    for (size_t e = 0; e < edges.size(); e++)
+    {
+        if (edges[e].to >= 0)
+            incomingEdges[filled[edges[e].to]++] = static_cast<int>(e);
+    }
+}
+
+void RoutingTable::compute(unsigned int numThreads)
+{
+    size_t n = numNodes();
+    choices.assign(zoneCount * n, noRoute);
+    numThreads = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(numThreads, zoneCount)));
+
+    int maxLength = 1;
+    for (const auto& edge : edges)
+        maxLength = std::max(maxLength, edge.length);
+
+    std::atomic<size_t> nextZone(0);
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+
+    auto worker = [&]()
+    {
+        try
+        {
+            std::vector<long long> distance(n, -1);
+            //Dial's bucket queue, as in NetworkCentrality: lengths are small positive integers
+            std::vector<std::vector<int>> buckets(maxLength + 1);
+
+            for (size_t zone = nextZone++; zone < zoneCount; zone = nextZone++)
+            {
+                uint8_t* choice = choices.data() + zone * n;
+                std::fill(distance.begin(), distance.end(), -1);
+                size_t pendingEntries = 0;
+
+                //Sources: nodes on the zone's roads, and nodes with a turn onto one of them
+                for (size_t node = 0; node < n; node++)
+                {
+                    if (zoneOfRoad[roadOfNode[node]] == static_cast<int>(zone))
+                    {
+                        distance[node] = 0;
+                        choice[node] = stay;
+                    }
+                }
+                for (const auto& edge : edges)
+                {
+                    if (edge.choice != stay && zoneOfRoad[edge.toRoad] == static_cast<int>(zone) && distance[edge.from] != 0)
+                    {
+                        distance[edge.from] = 0;
+                        choice[edge.from] = edge.choice;
+                    }
+                }
+                for (size_t node = 0; node < n; node++)
+                {
+                    if (distance[node] == 0)
+                    {
+                        buckets[0].push_back(static_cast<int>(node));
+                        pendingEntries++;
+                    }
+                }
+
+                for (long long currentDistance = 0; pendingEntries > 0; currentDistance++)
+                {
+                    auto& bucket = buckets[currentDistance % buckets.size()];
+                    for (size_t b = 0; b < bucket.size(); b++)
+                    {
+                        int node = bucket[b];
+                        pendingEntries--;
+                        if (distance[node] != currentDistance)
+                            continue; //Superseded by a shorter path
+
+                        for (size_t i = incomingOffsets[node]; i < incomingOffsets[node + 1]; i++)
+                        {
+                            const Edge& edge = edges[incomingEdges[i]];
+                            long long sourceDistance = currentDistance + edge.length;
+                            if (distance[edge.from] < 0 || sourceDistance < distance[edge.from])
+                            {
+                                distance[edge.from] = sourceDistance;
+                                choice[edge.from] = edge.choice;
+                                buckets[sourceDistance % buckets.size()].push_back(edge.from);
+                                pendingEntries++;
+                            }
+                        }
+                    }
+                    bucket.clear();
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+                failure = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+    if (failure)
+        std::rethrow_exception(failure);
+
+    setupDemand();
+}
+
+void RoutingTable::setupDemand()
+{
+    //"demand": [[originRoadID, zone, weight], ...]; origins without entries pick uniformly among the
+    //other zones reachable from their first shared section
+    demandOfRoad.assign(roads.size(), {});
+    std::vector<bool> listed(roads.size(), false);
+    for (const auto& entry : demandSettings)
+    {
+        int origin = entry.at(0).get<int>();
+        int zone = entry.at(1).get<int>();
+        double weight = entry.at(2).get<double>();
+        if (origin < 0 || origin >= static_cast<int>(roads.size()) || zone < 0 || zone >= static_cast<int>(zoneCount) || weight < 0.0)
+            throw std::invalid_argument("Invalid routing demand entry: " + entry.dump());
+
+        listed[origin] = true;
+        if (weight > 0.0)
+        {
+            double cumulative = demandOfRoad[origin].empty() ? 0.0 : demandOfRoad[origin].back().first;
+            demandOfRoad[origin].emplace_back(cumulative + weight, zone);
+        }
+    }
+    for (size_t r = 0; r < roads.size(); r++)
+    {
+        int parent = roads[r]->parentRoadID;
+        if (!listed[r] && listed[parent])
+        {
+            listed[r] = true;
+            demandOfRoad[r] = demandOfRoad[parent];
+        }
+    }
+
+    size_t n = numNodes();
+    for (size_t r = 0; r < roads.size(); r++)
+    {
+        if (listed[r] || firstNodeOfRoad[r] < 0)
+            continue;
+
+        for (size_t zone = 0; zone < zoneCount; zone++)
+        {
+            if (static_cast<int>(zone) != zoneOfRoad[r] && choices[zone * n + firstNodeOfRoad[r]] != noRoute)
+                demandOfRoad[r].emplace_back(static_cast<double>(demandOfRoad[r].size() + 1), static_cast<int>(zone));
+        }
+    }
+}
+
+std::pair<int, Road*> RoutingTable::nextHop(const Road& road, int cell, int zone) const
+{
+    int index = junctionGraph.cellIndex(road.roadID, cell);
+    int node = index >= 0 ? nodeOfCell[index] : -1;
+    if (node < 0 || zone < 0 || zone >= static_cast<int>(zoneCount))
+        return std::make_pair(-1, nullptr);
+
+    uint8_t choice = choices[zone * numNodes() + node];
+    if (choice == stay || choice == noRoute)
+        return std::make_pair(-1, nullptr);
+
+    const auto& turn = junctionGraph.turns(index)[choice - 1];
+    return std::make_pair(turn.cell, junctionGraph.road(turn.roadID));
+}
+
+bool RoutingTable::isInZone(int roadID, int zone) const
+{
+    return zone >= 0 && zoneOfRoad[roadID] == zone;
+}
+
+void RoutingTable::assignDestination(Car& car, int roadID, RandomNumberGenerator& rng) const
+{
+    const auto& options = demandOfRoad[roadID];
+    if (options.empty())
+    {
+        car.destinationZone = -1;
+        return;
+    }
+
+    double draw = rng.getRandomDouble() * options.back().first;
+    auto it = std::upper_bound(options.begin(), options.end(), draw, [](double value, const std::pair<double, int>& option)
+                               {
+                                   return value < option.first;
+                               });
+    car.destinationZone = it != options.end() ? it->second : options.back().second;
+}
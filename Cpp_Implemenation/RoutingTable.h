@@ -0,0 +1,61 @@
+#ifndef ROUTING_TABLE_H
+#define ROUTING_TABLE_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "Road.h"
+#include "JunctionGraph.h"
+#include "RandomNumberGenerator.h"
+
+//Next-hop tables for origin-destination routing. A decision node is a road together with one
+//of its shared sections: a car approaching that cell either stays on the road or turns onto one
+//of the sections wired to it, which leads to the next node downstream. Destinations are zones,
+//disjoint sets of roads, and a car has arrived once it is on a road of its zone. For every zone
+//a multi-source shortest path pass over the reversed node graph, with cells as lengths, stores
+//the first move from each node as one byte, so memory is nodes x zones bytes and a turning
+//decision is two array lookups.
+class RoutingTable
+{
+public:
+    static constexpr uint8_t stay = 0; //Choices above this are 1 + index into JunctionGraph::turns
+    static constexpr uint8_t noRoute = 255;
+
+    RoutingTable(const std::vector<std::shared_ptr<Road>>& roads, const JunctionGraph& junctionGraph, const nlohmann::json& settings);
+    void compute(unsigned int numThreads);
+    std::pair<int, Road*> nextHop(const Road& road, int cell, int zone) const;
+    bool isInZone(int roadID, int zone) const;
+    void assignDestination(Car& car, int roadID, RandomNumberGenerator& rng) const;
+    size_t numNodes() const;
+    size_t numZones() const;
+
+private:
+    struct Edge
+    {
+        int from;
+        int to; //-1 when the move leaves an open road without reaching another node
+        int toRoad;
+        int length;
+        uint8_t choice;
+    };
+
+    const std::vector<std::shared_ptr<Road>>& roads;
+    const JunctionGraph& junctionGraph;
+    nlohmann::json demandSettings;
+    std::vector<int> zoneOfRoad; //-1 for roads outside every zone
+    size_t zoneCount;
+    std::vector<int> nodeOfCell; //By JunctionGraph::cellIndex
+    std::vector<int> roadOfNode;
+    std::vector<int> firstNodeOfRoad; //-1 for roads without shared sections
+    std::vector<Edge> edges;
+    std::vector<size_t> incomingOffsets; //CSR of edges by target node: [incomingOffsets[v], incomingOffsets[v+1])
+    std::vector<int> incomingEdges;
+    std::vector<uint8_t> choices; //Choice of node n for zone z at z * numNodes() + n
+    std::vector<std::vector<std::pair<double, int>>> demandOfRoad; //Cumulative weight and zone, per origin road
+
+    void buildGraph();
+    void setupDemand();
+};
+
+#endif
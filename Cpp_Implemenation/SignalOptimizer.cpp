@@ -0,0 +1,300 @@
+#include "SignalOptimizer.h"
+#include "Simulation.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+SignalOptimizer::SignalOptimizer(const Simulation& network)
+    : network(network), numGroups(network.trafficLightGroups.size()), numEvaluations(0), numRejected(0)
+{
+    const auto& simulationConfig = network.config["simulation"];
+    nlohmann::json optimizerConfig = simulationConfig.value("optimizer", nlohmann::json::object());
+
+    cycleTime = optimizerConfig.value("cycleTime", simulationConfig.value("cycleTime", 60u));
+    minGreen = optimizerConfig.value("minGreen", 1u);
+    warmUpEpisodes = optimizerConfig.value("warmUpEpisodes", 200ULL);
+    measuredEpisodes = optimizerConfig.value("episodes", 600ULL);
+    rejectionInterval = std::max(1ULL, optimizerConfig.value("rejectionInterval", 50ULL));
+    maxIterations = optimizerConfig.value("iterations", 20u);
+    numThreads = std::max(1u, optimizerConfig.value("threads", std::max(1u, std::thread::hardware_concurrency())));
+    seeds = optimizerConfig.value("seeds", std::vector<unsigned int>{network.rng.getSeed()});
+
+    if (numGroups == 0)
+        throw std::invalid_argument("The optimizer needs traffic light groups to tune.");
+    if (cycleTime < 2 || minGreen == 0 || 2 * minGreen > cycleTime)
+        throw std::invalid_argument("Optimizer cycleTime must be at least 2 and leave minGreen steps to each phase.");
+    if (seeds.empty() || measuredEpisodes == 0)
+        throw std::invalid_argument("Optimizer needs at least one seed and one measured episode.");
+
+    //Candidates rebuild the same network without any of the outputs of a full run
+    candidateConfig = network.config;
+    auto& candidate = candidateConfig["simulation"];
+    for (const char* key : {"checkpoint", "tracePath", "spaceTimeDiagram", "profiling", "centrality", "optimizer"})
+        candidate.erase(key);
+    candidate["controllerType"] = "signal_plan";
+    candidate["episodes"] = warmUpEpisodes + measuredEpisodes;
+    candidate["setupThreads"] = 1;
+}
+
+SignalOptimizer::Plan SignalOptimizer::initialPlan() const
+{
+    Plan plan;
+    plan.offsets.assign(numGroups, 0);
+    plan.greenTimes.assign(numGroups, cycleTime / 2);
+
+    //Start from a configured signal plan, or from the green wave for the optimizer's cycle
+    const auto& simulationConfig = network.config["simulation"];
+    if (simulationConfig.contains("signalPlan"))
+    {
+        auto offsets = simulationConfig["signalPlan"].value("offsets", std::vector<unsigned int>());
+        auto greenTimes = simulationConfig["signalPlan"].value("greenTimes", std::vector<unsigned int>());
+        for (size_t i = 0; i < numGroups; i++)
+        {
+            if (i < offsets.size())
+                plan.offsets[i] = offsets[i] % cycleTime;
+            if (i < greenTimes.size())
+                plan.greenTimes[i] = std::clamp(greenTimes[i], minGreen, cycleTime - minGreen);
+        }
+    }
+    else if (simulationConfig.value("optimizer", nlohmann::json::object()).value("start", "green_wave") == "green_wave")
+    {
+        size_t defaultColumns = (network.gridColumns > 0) ? network.gridColumns : 4;
+        GreenWaveController greenWave(cycleTime, network.vMax, network.brakeProbability, simulationConfig.value("numberOfColumns", defaultColumns));
+        for (const auto& group : network.trafficLightGroups)
+            greenWave.addTrafficLightGroup(group);
+        for (size_t i = 0; i < numGroups; i++)
+            plan.offsets[i] = greenWave.calculateOffset(i);
+    }
+
+    return plan;
+}
+
+nlohmann::json SignalOptimizer::planToJson(const Plan& plan) const
+{
+    return {{"cycleTime", cycleTime}, {"offsets", plan.offsets}, {"greenTimes", plan.greenTimes}};
+}
+
+SignalOptimizer::Evaluation SignalOptimizer::evaluate(const Plan& plan, double bound) const
+{
+    nlohmann::json config = candidateConfig;
+    config["simulation"]["signalPlan"] = planToJson(plan);
+
+    //Delay is summed over the seeds, so the bound on the mean scales with their number
+    double totalBound = bound * seeds.size();
+    double totalDelay = 0.0;
+    double totalThroughput = 0.0;
+    Evaluation evaluation;
+
+    for (unsigned int seed : seeds)
+    {
+        Simulation simulation(config, network.resultsPath, 0);
+        simulation.setSeed(seed);
+        simulation.verbose = false;
+        simulation.setup();
+        simulation.scheduleEvents(0);
+
+        std::vector<TrafficLight*> lights;
+        for (const auto& road : simulation.roads)
+            for (const auto& trafficLight : road->trafficLights)
+                lights.push_back(trafficLight.get());
+
+        unsigned long long departuresAtWarmUp = 0;
+        unsigned long long lastEpisode = warmUpEpisodes + measuredEpisodes;
+        for (unsigned long long episode = 0; episode < lastEpisode; episode++)
+        {
+            if (episode == warmUpEpisodes)
+                for (const auto* trafficLight : lights)
+                    departuresAtWarmUp += trafficLight->departures;
+
+            simulation.simulateEpisode(episode);
+            simulation.finishEpisode(episode);
+
+            if (episode < warmUpEpisodes)
+                continue;
+
+            for (const auto* trafficLight : lights)
+                totalDelay += trafficLight->queueLength;
+
+            if ((episode + 1 - warmUpEpisodes) % rejectionInterval == 0 && totalDelay > totalBound)
+            {
+                evaluation.rejected = true;
+                evaluation.delay = totalDelay / seeds.size();
+                return evaluation;
+            }
+        }
+
+        unsigned long long departures = 0;
+        for (const auto* trafficLight : lights)
+            departures += trafficLight->departures;
+        totalThroughput += departures - departuresAtWarmUp;
+    }
+
+    evaluation.delay = totalDelay / seeds.size();
+    evaluation.throughput = totalThroughput / seeds.size();
+    return evaluation;
+}
+
+std::vector<SignalOptimizer::Evaluation> SignalOptimizer::evaluateBatch(const std::vector<Plan>& plans, double bound)
+{
+    std::vector<Evaluation> evaluations(plans.size());
+
+    std::atomic<size_t> nextPlan(0);
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto worker = [&]()
+    {
+        try
+        {
+            for (size_t i = nextPlan++; i < plans.size(); i = nextPlan++)
+                evaluations[i] = evaluate(plans[i], bound);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+                failure = std::current_exception();
+            nextPlan = plans.size();
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(numThreads, plans.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < threadCount; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+    if (failure)
+        std::rethrow_exception(failure);
+
+    numEvaluations += plans.size();
+    for (const auto& evaluation : evaluations)
+        numRejected += evaluation.rejected;
+    return evaluations;
+}
+
+void SignalOptimizer::run()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    Plan best = initialPlan();
+    Evaluation bestEvaluation = evaluateBatch({best}, std::numeric_limits<double>::infinity())[0];
+    Evaluation initialEvaluation = bestEvaluation;
+    std::cout << "Initial plan: delay " << bestEvaluation.delay << ", throughput " << bestEvaluation.throughput << std::endl;
+
+    unsigned int offsetStep = std::max(1u, cycleTime / 4);
+    unsigned int greenStep = std::max(1u, cycleTime / 8);
+    unsigned int iteration = 0;
+    for (; iteration < maxIterations; iteration++)
+    {
+        //One coordinate move per candidate: offset or green time of one group, one step either way
+        std::vector<Plan> candidates;
+        std::vector<size_t> candidateGroup;
+        for (size_t g = 0; g < numGroups; g++)
+        {
+            unsigned int later = (best.offsets[g] + offsetStep) % cycleTime;
+            unsigned int earlier = (best.offsets[g] + cycleTime - offsetStep % cycleTime) % cycleTime;
+            for (unsigned int offset : {later, earlier})
+            {
+                if (offset == best.offsets[g] || (offset == earlier && earlier == later))
+                    continue;
+                candidates.push_back(best);
+                candidates.back().offsets[g] = offset;
+                candidateGroup.push_back(g);
+            }
+
+            for (int direction : {1, -1})
+            {
+                int greenTime = static_cast<int>(best.greenTimes[g]) + direction * static_cast<int>(greenStep);
+                if (greenTime < static_cast<int>(minGreen) || greenTime > static_cast<int>(cycleTime - minGreen))
+                    continue;
+                candidates.push_back(best);
+                candidates.back().greenTimes[g] = greenTime;
+                candidateGroup.push_back(g);
+            }
+        }
+
+        std::vector<Evaluation> evaluations = evaluateBatch(candidates, bestEvaluation.delay);
+
+        //Best improving move of every group
+        std::vector<size_t> bestMoveOfGroup(numGroups, candidates.size());
+        size_t bestMove = candidates.size();
+        for (size_t c = 0; c < candidates.size(); c++)
+        {
+            if (evaluations[c].rejected || evaluations[c].delay >= bestEvaluation.delay)
+                continue;
+            size_t& groupMove = bestMoveOfGroup[candidateGroup[c]];
+            if (groupMove == candidates.size() || evaluations[c].delay < evaluations[groupMove].delay)
+                groupMove = c;
+            if (bestMove == candidates.size() || evaluations[c].delay < evaluations[bestMove].delay)
+                bestMove = c;
+        }
+
+        if (bestMove == candidates.size())
+        {
+            if (offsetStep == 1 && greenStep == 1)
+                break;
+            offsetStep = std::max(1u, offsetStep / 2);
+            greenStep = std::max(1u, greenStep / 2);
+            std::cout << "Iteration " << iteration << ": no improving move, steps now " << offsetStep << "/" << greenStep << std::endl;
+            continue;
+        }
+
+        //Moves of different groups usually add up; keep the combination only if it beats the best single move
+        Plan combined = best;
+        size_t numMoves = 0;
+        for (size_t g = 0; g < numGroups; g++)
+        {
+            if (bestMoveOfGroup[g] == candidates.size())
+                continue;
+            combined.offsets[g] = candidates[bestMoveOfGroup[g]].offsets[g];
+            combined.greenTimes[g] = candidates[bestMoveOfGroup[g]].greenTimes[g];
+            numMoves++;
+        }
+
+        best = candidates[bestMove];
+        bestEvaluation = evaluations[bestMove];
+        if (numMoves > 1)
+        {
+            Evaluation combinedEvaluation = evaluateBatch({combined}, bestEvaluation.delay)[0];
+            if (!combinedEvaluation.rejected && combinedEvaluation.delay < bestEvaluation.delay)
+            {
+                best = combined;
+                bestEvaluation = combinedEvaluation;
+            }
+        }
+
+        std::cout << "Iteration " << iteration << ": delay " << bestEvaluation.delay << ", throughput " << bestEvaluation.throughput
+                  << " (" << numMoves << " improving groups, " << numEvaluations << " evaluations, " << numRejected << " rejected early)" << std::endl;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    nlohmann::json report;
+    report["controllerType"] = "signal_plan";
+    report["signalPlan"] = planToJson(best);
+    report["delay"] = bestEvaluation.delay;
+    report["throughput"] = bestEvaluation.throughput;
+    report["delayPerDeparture"] = bestEvaluation.throughput > 0 ? bestEvaluation.delay / bestEvaluation.throughput : 0.0;
+    report["initialDelay"] = initialEvaluation.delay;
+    report["initialThroughput"] = initialEvaluation.throughput;
+    report["iterations"] = iteration;
+    report["evaluations"] = numEvaluations;
+    report["rejectedEarly"] = numRejected;
+    report["seconds"] = seconds;
+
+    std::string reportPath = network.uniqueResultsPath("optimized_signal_plan.json");
+    std::ofstream file(reportPath);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to write optimizer report: " + reportPath);
+    file << report.dump(4);
+
+    std::cout << "Best plan: delay " << bestEvaluation.delay << " (initial " << initialEvaluation.delay << "), throughput "
+              << bestEvaluation.throughput << " (initial " << initialEvaluation.throughput << "), " << numEvaluations
+              << " evaluations in " << seconds << " s; written to " << reportPath << std::endl;
+}
@@ -0,0 +1,59 @@
+#ifndef SIGNAL_OPTIMIZER_H
+#define SIGNAL_OPTIMIZER_H
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+class Simulation;
+
+//Tunes the per-group offsets and green times of a two-phase fixed-time plan (the
+//"signal_plan" controller) by batched coordinate descent. Every round moves each group's
+//offset and green time one step either way, evaluates all those candidates in parallel as
+//short in-process runs of the configured network, and keeps the best move of every group,
+//combined when that is better still. Steps halve when no move helps.
+//A candidate is scored by its delay, the queued vehicle-steps summed over all lights after a
+//warm-up. Delay only grows during a run, so a candidate is abandoned as soon as it exceeds
+//the delay of the incumbent plan.
+class SignalOptimizer
+{
+public:
+    struct Plan
+    {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> greenTimes;
+    };
+
+    struct Evaluation
+    {
+        double delay = std::numeric_limits<double>::infinity(); //Mean over seeds; partial if rejected
+        double throughput = 0.0; //Mean light departures after the warm-up
+        bool rejected = false;
+    };
+
+    explicit SignalOptimizer(const Simulation& network);
+    void run();
+
+private:
+    const Simulation& network;
+    nlohmann::json candidateConfig;
+    size_t numGroups;
+    unsigned int cycleTime;
+    unsigned int minGreen;
+    unsigned long long warmUpEpisodes;
+    unsigned long long measuredEpisodes;
+    unsigned long long rejectionInterval;
+    unsigned int maxIterations;
+    unsigned int numThreads;
+    std::vector<unsigned int> seeds;
+    size_t numEvaluations;
+    size_t numRejected;
+
+    Plan initialPlan() const;
+    Evaluation evaluate(const Plan& plan, double bound) const;
+    std::vector<Evaluation> evaluateBatch(const std::vector<Plan>& plans, double bound);
+    nlohmann::json planToJson(const Plan& plan) const;
+};
+
+#endif
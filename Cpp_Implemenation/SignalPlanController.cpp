@@ -0,0 +1,25 @@
+#include "SignalPlanController.h"
+
+SignalPlanController::SignalPlanController(unsigned int cycleTime, std::vector<unsigned int> offsets, std::vector<unsigned int> greenTimes)
+    : TrafficLightController(cycleTime), offsets(std::move(offsets)), greenTimes(std::move(greenTimes))
+{
+    if (cycleTime < 2)
+        throw std::invalid_argument("Signal plan cycle time must be at least 2.");
+}
+
+void SignalPlanController::initialize()
+{
+    TrafficLightController::initialize();
+
+    //Groups missing from the plan run the synchronized split
+    schedule.clear();
+    for (size_t i = 0; i < trafficLightGroups.size(); i++)
+    {
+        unsigned int offset = (i < offsets.size()) ? offsets[i] % cycleTime : 0;
+        unsigned int greenTime = (i < greenTimes.size()) ? greenTimes[i] : cycleTime / 2;
+        if (greenTime > cycleTime)
+            throw std::invalid_argument("Signal plan green time exceeds the cycle time.");
+        addTwoPhasePlans(*trafficLightGroups[i], cycleTime, offset, greenTime);
+    }
+    schedule.applyAll(0);
+}
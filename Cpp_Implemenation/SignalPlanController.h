@@ -0,0 +1,21 @@
+#ifndef SIGNAL_PLAN_CONTROLLER_H
+#define SIGNAL_PLAN_CONTROLLER_H
+
+#include "TrafficLightController.h"
+
+//Two-phase fixed-time plan given per group: a common cycle, the offset at which the group's
+//cycle starts and how long its even-indexed lights stay green. This is the form in which
+//SignalOptimizer reports its plans.
+class SignalPlanController : public TrafficLightController
+{
+public:
+    SignalPlanController(unsigned int cycleTime, std::vector<unsigned int> offsets, std::vector<unsigned int> greenTimes);
+
+    void initialize() override;
+
+private:
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> greenTimes;
+};
+
+#endif
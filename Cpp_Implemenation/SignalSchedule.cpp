@@ -0,0 +1,94 @@
+#include "SignalSchedule.h"
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+
+bool SignalPlan::isGreenAt(unsigned long long time) const
+{
+    unsigned int phase = static_cast<unsigned int>((time % cycle + cycle - offset) % cycle);
+    return phase >= greenStart && phase < greenEnd;
+}
+
+void SignalSchedule::clear()
+{
+    plans.clear();
+    switchesByCycle.clear();
+    switchPhases.clear();
+    applied = false;
+}
+
+void SignalSchedule::add(TrafficLight& trafficLight, const SignalPlan& plan)
+{
+    if (plan.cycle == 0 || plan.greenStart > plan.greenEnd || plan.greenEnd > plan.cycle)
+        throw std::invalid_argument("Invalid signal plan: the green window must lie inside a non-empty cycle.");
+
+    SignalPlan normalized = plan;
+    normalized.offset %= plan.cycle;
+    plans.emplace_back(&trafficLight, normalized);
+    applied = false;
+
+    //Always red or always green lights never switch
+    if (plan.greenStart == plan.greenEnd || plan.greenEnd - plan.greenStart == plan.cycle)
+        return;
+
+    auto& switches = switchesByCycle[plan.cycle];
+    if (switches.empty())
+        switches.resize(plan.cycle);
+    unsigned int onPhase = (normalized.offset + plan.greenStart) % plan.cycle;
+    unsigned int offPhase = (normalized.offset + plan.greenEnd) % plan.cycle;
+    switches[onPhase].push_back({&trafficLight, true});
+    switches[offPhase].push_back({&trafficLight, false});
+
+    auto& phases = switchPhases[plan.cycle];
+    for (unsigned int phase : {onPhase, offPhase})
+    {
+        auto position = std::lower_bound(phases.begin(), phases.end(), phase);
+        if (position == phases.end() || *position != phase)
+            phases.insert(position, phase);
+    }
+}
+
+void SignalSchedule::apply(unsigned long long time)
+{
+    //Incremental only when no switch was skipped since the last applied time
+    if (!applied || time <= lastTime || nextSwitchTime(lastTime) < time)
+    {
+        if (!applied || time != lastTime)
+            applyAll(time);
+        return;
+    }
+
+    for (auto& [cycle, switches] : switchesByCycle)
+        for (const auto& event : switches[time % cycle])
+            event.trafficLight->setState(event.state, time);
+    lastTime = time;
+}
+
+void SignalSchedule::applyAll(unsigned long long time)
+{
+    for (auto& [trafficLight, plan] : plans)
+        trafficLight->setState(plan.isGreenAt(time), time);
+    lastTime = time;
+    applied = true;
+}
+
+unsigned long long SignalSchedule::nextSwitchTime(unsigned long long time) const
+{
+    unsigned long long next = ULLONG_MAX;
+    for (const auto& [cycle, phases] : switchPhases)
+    {
+        unsigned int phase = static_cast<unsigned int>(time % cycle);
+        auto position = std::upper_bound(phases.begin(), phases.end(), phase);
+        unsigned long long cycleStart = time - phase;
+        if (position != phases.end())
+            next = std::min(next, cycleStart + *position);
+        else
+            next = std::min(next, cycleStart + cycle + phases.front());
+    }
+    return next;
+}
+
+size_t SignalSchedule::size() const
+{
+    return plans.size();
+}
@@ -0,0 +1,48 @@
+#ifndef SIGNAL_SCHEDULE_H
+#define SIGNAL_SCHEDULE_H
+
+#include <vector>
+#include <map>
+#include <utility>
+#include "TrafficLight.h"
+
+//Fixed-time plan of one light: green while (time - offset) mod cycle lies in [greenStart, greenEnd)
+struct SignalPlan
+{
+    unsigned int cycle;
+    unsigned int offset;
+    unsigned int greenStart;
+    unsigned int greenEnd;
+
+    bool isGreenAt(unsigned long long time) const;
+};
+
+//Compiled form of the fixed-time controllers. Every light contributes at most two switch
+//events per cycle, bucketed by time modulo its cycle, so moving to the next switch time only
+//touches the lights that change then. Any other jump in time (first step, restored
+//checkpoint) evaluates every plan directly.
+class SignalSchedule
+{
+public:
+    void clear();
+    void add(TrafficLight& trafficLight, const SignalPlan& plan);
+    void apply(unsigned long long time);
+    void applyAll(unsigned long long time);
+    unsigned long long nextSwitchTime(unsigned long long time) const; //First time after time at which a light switches, ULLONG_MAX if none
+    size_t size() const;
+
+private:
+    struct Switch
+    {
+        TrafficLight* trafficLight;
+        bool state;
+    };
+
+    std::vector<std::pair<TrafficLight*, SignalPlan>> plans;
+    std::map<unsigned int, std::vector<std::vector<Switch>>> switchesByCycle; //Cycle length -> events per phase
+    std::map<unsigned int, std::vector<unsigned int>> switchPhases; //Cycle length -> sorted phases that have events
+    unsigned long long lastTime = 0;
+    bool applied = false;
+};
+
+#endif
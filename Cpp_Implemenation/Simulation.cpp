@@ -1,6 +1,12 @@
 #include "Simulation.h"
 
-Simulation::Simulation(const std::string& configFilePath, std::string resultsPath = "./", short executionType = 0) : resultsPath(resultsPath), executionType(executionType)
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+Simulation::Simulation(const std::string& configFilePath, std::string resultsPath = "./", short executionType = 0) : resultsPath(resultsPath), executionType(executionType), nextVehicleID(0), verbose(true), warmedUpEpisodes(0)
 {
     std::ifstream file(configFilePath);
     if (file.is_open())
@@ -12,10 +18,41 @@ Simulation::Simulation(const std::string& configFilePath, std::string resultsPat
         throw std::runtime_error("Unable to open configuration file.");
 }
 
+Simulation::Simulation(const nlohmann::json& config, std::string resultsPath, short executionType) : config(config), executionType(executionType), resultsPath(resultsPath), nextVehicleID(0), verbose(true), warmedUpEpisodes(0)
+{
+}
+
+void Simulation::setSeed(unsigned int seed)
+{
+    seedOverride = seed;
+}
+
 void Simulation::setup()
 {
-    if (!config.contains("simulation") || !config["simulation"].contains("roads"))
-        throw std::runtime_error("Invalid configuration: missing 'simulation' or 'roads' key.");
+    if (!config.contains("simulation") || (!NetworkImage::hasTopology(config["simulation"]) && !config["simulation"].contains("networkImage")))
+        throw std::runtime_error("Invalid configuration: missing 'simulation' or 'roads'/'grid'/'networkImage' key.");
+
+    auto setupStart = std::chrono::steady_clock::now();
+
+    //Seed before anything draws random numbers (initial car placement included)
+    if (seedOverride)
+        rng.seed(*seedOverride);
+    else if (config["simulation"].contains("seed"))
+        rng.seed(config["simulation"]["seed"].get<unsigned int>());
+
+    tracePath = config["simulation"].value("tracePath", "");
+
+    if (config["simulation"].contains("profiling"))
+    {
+#ifdef NASCH_PROFILING
+        const auto& profilingConfig = config["simulation"]["profiling"];
+        StepProfiler::instance().configureTrace(profilingConfig.value("tracePath", ""), profilingConfig.value("traceFrom", 0ULL), profilingConfig.value("traceEpisodes", 100ULL));
+        if (profilingConfig.value("hardwareCounters", false))
+            StepProfiler::instance().enableHardwareCounters();
+#else
+        std::cerr << "Profiling settings ignored: the simulation was built without ENABLE_PROFILING." << std::endl;
+#endif
+    }
 
     if (config["simulation"].contains("episodes"))
         episodes = config["simulation"]["episodes"];
@@ -35,204 +72,191 @@ void Simulation::setup()
     else
         brakeProbability = 0.1;
 
-    const auto& roadsConfig = config["simulation"]["roads"];
-
-    std::vector<double> alphas;
+    outputFormat = config["simulation"].value("outputFormat", "json");
+    if (outputFormat != "json" && outputFormat != "compressed")
+        throw std::invalid_argument("Unknown outputFormat in configuration: " + outputFormat);
+    sampleOutput = config["simulation"].value("sampleOutput", "new");
+    if (sampleOutput != "new" && sampleOutput != "window" && sampleOutput != "none")
+        throw std::invalid_argument("Unknown sampleOutput in configuration: " + sampleOutput);
 
-    for (const auto& roadConfig : roadsConfig)
+    checkpointInterval = 0;
+    if (config["simulation"].contains("checkpoint"))
     {
-        int roadID = roadConfig.value("roadID", 0);
-        int roadSize = roadConfig.value("roadSize", 50);
+        const auto& checkpointConfig = config["simulation"]["checkpoint"];
+        checkpointInterval = checkpointConfig.value("interval", 0ULL);
+        checkpointPath = checkpointConfig.value("path", resultsPath + "/checkpoint.nsck");
+        restorePath = checkpointConfig.value("restoreFrom", "");
+    }
 
-        int numCars = 0;
-        double density = 0.0;
-        if (roadConfig.contains("density"))
-            density = roadConfig["density"];
-        if (density <= 0.0 && roadConfig.contains("numCars"))
-            numCars = roadConfig["numCars"];
-        
-        int maxSpeed = vMax;
-        if (roadConfig.contains("maxSpeed"))
-            int maxSpeed = roadConfig.value("maxSpeed", 3);
-
-        double brakeProb = brakeProbability;
-        if (roadConfig.contains("brakeProbability"))
-            brakeProb = roadConfig.value("brakeProbability", 0.1);
-        
-        bool isPeriodic = roadConfig.value("isPeriodic", true);
-        double alpha = roadConfig.value("alphaWeight", 0.0);
-        if (alpha > 0.0)
-        {
-            roadsWithAlpha.push_back(roadID);
-            alphaWeights.add(roadID, alpha);
-            alphas.push_back(alpha);
-        }
+    if (config["simulation"].contains("steadyState"))
+        steadyStateConfig = config["simulation"]["steadyState"];
 
-        double beta = roadConfig.value("beta", 0.0);
-        if (beta > 0.0)
-            roadsWithBeta.push_back(roadID);
+    setupThreads = config["simulation"].value("setupThreads", std::max(1u, std::thread::hardware_concurrency()));
+    sparseDensity = config["simulation"].value("sparseDensity", 0.02);
+    gridColumns = 0;
 
-        if (numCars == 0)
+    //A compiled network image replaces the topology part of the configuration when its hash matches
+    std::string networkImagePath = config["simulation"].value("networkImage", "");
+    bool hasTopology = NetworkImage::hasTopology(config["simulation"]);
+    uint64_t topologyHash = hasTopology ? NetworkImage::topologyHash(config["simulation"]) : 0;
+
+    NetworkImage networkImage;
+    bool imageLoaded = false;
+    if (!networkImagePath.empty() && networkImage.open(networkImagePath))
+    {
+        if (!hasTopology || networkImage.header().topologyHash == topologyHash)
         {
-            auto road = std::make_shared<Road>(roadID, roadSize, isPeriodic, beta, vMax, brakeProbability, density, rng, queueSize);
-            roads.emplace_back(road);
-            road->setupSections();
-            road->addCarsBasedOnDensity(density);
+            setupFromImage(networkImage);
+            imageLoaded = true;
         }
         else
+            std::cout << "Network image " << networkImagePath << " does not match the configured topology; rebuilding it." << std::endl;
+    }
+
+    if (!imageLoaded)
+    {
+        if (!hasTopology)
+            throw std::runtime_error("Network image not found and no 'roads'/'grid' in configuration: " + networkImagePath);
+
+        setupTopology();
+        if (!networkImagePath.empty())
         {
-            auto road = std::make_shared<Road>(roadID, roadSize, isPeriodic, beta, vMax, brakeProbability, numCars, rng, queueSize);
-            roads.emplace_back(road);
-            road->setupSections();
-            road->addCars(numCars);
+            NetworkImage::write(networkImagePath, topologyHash, gridColumns, roads, initialLoads, alphaWeights, trafficLightGroups);
+            std::cout << "Network image written to " << networkImagePath << std::endl;
         }
     }
 
-    double alphasSum = std::accumulate(alphas.begin(), alphas.end(), 0.0);
-    if ((std::abs(alphasSum - 1.0) > 1e-6) && alphasSum != 0.0)
-        for (auto& id : roadsWithAlpha)
-            alphaWeights.add(id, (alphaWeights.get(id)/alphasSum));
+    //The wiring is final from here on; the step loop reads it from the compiled graph
+    junctionGraph = std::make_unique<JunctionGraph>(roads);
+    for (auto& road : roads)
+    {
+        road->setupQueueTracking();
+        road->junctionGraph = junctionGraph.get();
+    }
+    setupLaneGroups();
+    resetSampleCursors(); //execute() resets them again; sized here so that collectMetrics works without it
 
-    if (config["simulation"].contains("roads"))
+    if (config["simulation"].contains("spaceTimeDiagram"))
     {
-        const auto& roadsConfig = config["simulation"]["roads"];
-        for (const auto& roadConfig : roadsConfig)
+        const auto& spaceTimeConfig = config["simulation"]["spaceTimeDiagram"];
+
+        std::vector<std::shared_ptr<Road>> recordedRoads;
+        if (spaceTimeConfig.contains("roads"))
         {
-            int roadID = roadConfig["roadID"];
-            const auto& sharedSections = roadConfig["sharedSections"];
-            for (const auto& sharedSection : sharedSections)
+            for (int roadID : spaceTimeConfig["roads"])
             {
-                if (sharedSection.size() == 5)
-                {
-                    int otherRoadID = sharedSection[0];
-                    int currentSite = sharedSection[1];
-                    int otherSite = sharedSection[2];
-                    double currentToOtherProb = sharedSection[3];
-                    double otherToCurrentProb = sharedSection[4];
-
-                    if ((roadID >= 0 && roadID < roads.size() && currentSite >= 0 && currentSite < roads[roadID]->roadSize) &&
-                        (otherRoadID >= 0 && otherRoadID < roads.size() && otherSite >= 0 && otherSite < roads[otherRoadID]->sections.size()))
-                    {
-                        roads[roadID]->changingRoadProbs.add(currentSite, currentToOtherProb);
-                        roads[otherRoadID]->changingRoadProbs.add(otherSite, otherToCurrentProb);
-                        roads[roadID]->sections[currentSite]->connect(roads[otherRoadID]->sections[otherSite]);
-                        roads[otherRoadID]->sections[otherSite]->connect(roads[roadID]->sections[currentSite]);
-                    }
-                    else
-                        std::cerr << "Invalid roadID or section index in sharedSection." << std::endl;
-                }
+                if (roadID >= 0 && roadID < static_cast<int>(roads.size()))
+                    recordedRoads.push_back(roads[roadID]);
                 else
-                    std::cerr << "Not enough parameters on shared section specifications" << std::endl;
+                    std::cerr << "Invalid roadID for space-time diagram: " << roadID << std::endl;
             }
-            for (auto& road : roads)
-                std::sort(road->sharedSectionsPositions.begin(), road->sharedSectionsPositions.end());
         }
-    }
-    
-    if (config["simulation"].contains("trafficLightGroups"))
-    {
-        const auto& trafficLightGroupsConfig = config["simulation"]["trafficLightGroups"];
-        for (const auto& groupConfig : trafficLightGroupsConfig)
-        {
-            int groupID = groupConfig.value("groupID", -1);
-            int transitionTime = groupConfig.value("transitionTime", 0);
+        else
+            recordedRoads = roads;
 
-            if (groupID >= 0)
-            {
-                if (groupID >= trafficLightGroups.size())
-                    trafficLightGroups.resize(groupID + 1);
+        std::vector<std::pair<unsigned long long, unsigned long long>> windows;
+        if (spaceTimeConfig.contains("windows"))
+        {
+            for (const auto& window : spaceTimeConfig["windows"])
+                windows.emplace_back(window[0].get<unsigned long long>(), window[1].get<unsigned long long>());
+        }
+        else
+            windows.emplace_back(0, episodes);
 
-                std::shared_ptr<TrafficLightGroup> group;
-                if (!trafficLightGroups[groupID])
-                {
-                    group = std::make_shared<TrafficLightGroup>();
-                    trafficLightGroups[groupID] = group;
-                }
-                else
-                    group = trafficLightGroups[groupID];
+        spaceTimeRecorder = std::make_unique<SpaceTimeRecorder>(recordedRoads, windows);
+    }
 
-                group->setTransitionTime(transitionTime);
-            }
-        }
+    //"trajectories": {"fraction": f, "interval": n} follows a fraction of the vehicles
+    if (config["simulation"].contains("trajectories"))
+    {
+        const auto& trajectoryConfig = config["simulation"]["trajectories"];
+        trajectoryLogger = std::make_unique<TrajectoryLogger>(roads, trajectoryConfig.value("fraction", 1.0), trajectoryConfig.value("interval", 1ULL));
     }
-    if (config["simulation"].contains("trafficLights"))
+    assignVehicleIDs();
+
+    //"routing": {"zones": [[roadIDs], ...], "demand": [[originRoadID, zone, weight], ...], "threads": n}
+    //gives every car a destination zone and turns it along shortest paths instead of at random
+    if (config["simulation"].contains("routing"))
     {
-        const auto& trafficLightsConfig = config["simulation"]["trafficLights"];
-        for (const auto& trafficLightConfig : trafficLightsConfig)
+        const auto& routingConfig = config["simulation"]["routing"];
+        auto routingStart = std::chrono::steady_clock::now();
+        routingTable = std::make_unique<RoutingTable>(roads, *junctionGraph, routingConfig);
+        routingTable->compute(routingConfig.value("threads", setupThreads));
+        for (auto& road : roads)
         {
-            int roadID = trafficLightConfig["roadID"];
-            if (roadID >= 0 && roadID < roads.size())
-            {
-                auto road = roads[roadID];
-                int position = trafficLightConfig["position"];
-
-                if (position >= 0 && position < road->sections.size())
-                {
-                    bool externalControl = trafficLightConfig["externalControl"];
-                    int timeOpen = trafficLightConfig.value("timeOpen", 10);
-                    int timeClosed = trafficLightConfig.value("timeClosed", 10);
-                    bool paired = trafficLightConfig.value("paired", false);
-
-                    auto trafficLight = std::make_shared<TrafficLight>(externalControl, timeOpen, timeClosed, roads[roadID], position);
-
-                    if (paired)
-                    {
-                        std::shared_ptr<TrafficLightGroup> group;
-
-                        if (trafficLightConfig.contains("groupID"))
-                        {
-                            int groupID = trafficLightConfig["groupID"];
-                            if (groupID >= 0 && groupID < trafficLightGroups.size())
-                                group = trafficLightGroups[groupID];
-                            else
-                            {
-                                group = std::make_shared<TrafficLightGroup>();
-                                trafficLightGroups.push_back(group);
-                            }
-                        }
-                        else
-                        {
-                            group = std::make_shared<TrafficLightGroup>();
-                            trafficLightGroups.push_back(group);
-                        }
-
-                        group->addTrafficLight(trafficLight);
-                    }
-
-                    road->sections[position]->trafficLight = trafficLight;
-                    road->trafficLights.push_back(trafficLight);
-                    road->trafficLightPositions.push_back(position);
-                }
-                else
-                    std::cerr << "Invalid position: " << position << " on roadID: " << roadID << std::endl;
-            }
-            else
-                std::cerr << "Invalid roadID: " << roadID << std::endl;
+            road->routingTable = routingTable.get();
+            for (int cell : road->occupiedCells())
+                routingTable->assignDestination(*road->carAt(cell), road->roadID, rng);
         }
+        if (verbose)
+            std::cout << "Next-hop tables of " << routingTable->numNodes() << " decision points for " << routingTable->numZones() << " zones computed in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - routingStart).count() << " ms" << std::endl;
     }
-    for (auto& road : roads)
+
+    setupController();
+
+    currentDay = 0;
+    currentHour = 0;
+
+    size_t totalCells = 0;
+    size_t sparseRoads = 0;
+    for (const auto& road : roads)
     {
-        road->setupTimeHeadwayAndFlowPoints(queueSize);
+        totalCells += road->roadSize;
+        sparseRoads += road->isSparse ? 1 : 0;
+    }
+    setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+    simulationResults["setupSeconds"] = setupSeconds;
+    if (verbose)
+        std::cout << "Setup: " << roads.size() << " roads" << (sparseRoads > 0 ? " (" + std::to_string(sparseRoads) + " sparse)" : "") << ", " << totalCells << " cells, "
+              << trafficLightGroups.size() << " traffic light groups in " << setupSeconds * 1e3 << " ms" << std::endl;
 
-        std::sort(road->trafficLightPositions.begin(), road->trafficLightPositions.end());
-        for (auto& TLPosition : road->trafficLightPositions)
-            road->sections[TLPosition]->trafficLight->calculateDistanceToPreviousTrafficLight();
+    //printSimulationSettings();
+}
+
+
+void Simulation::assignVehicleIDs()
+{
+    //Cars placed during setup are numbered by road and cell, cars entering later take the next IDs
+    nextVehicleID = 0;
+    for (auto& road : roads)
+    {
+        for (int cell : road->occupiedCells())
+            road->carAt(cell)->vehicleID = nextVehicleID++;
+        road->nextVehicleID = &nextVehicleID;
     }
+}
 
+void Simulation::setupController()
+{
+    trafficLightController.reset();
     if (config["simulation"].contains("controllerType") && !trafficLightGroups.empty())
     {
         std::string controllerType = config["simulation"]["controllerType"].get<std::string>();
+        unsigned int cycleTime = config["simulation"].value("cycleTime", 60);
         if (controllerType == "synchronized")
             trafficLightController = std::make_shared<SyncController>();
         else if (controllerType == "green_wave")
         {
             double vMax = config["simulation"].value("vMax", 3.0);
             double brakeProbability = config["simulation"].value("brakeProbability", 0.2);
-            size_t numberOfColumns = config["simulation"].value("numberOfColumns", 4);
-            trafficLightController = std::make_shared<GreenWaveController>(60, vMax, brakeProbability, numberOfColumns);
+            size_t defaultColumns = (gridColumns > 0) ? gridColumns : 4;
+            size_t numberOfColumns = config["simulation"].value("numberOfColumns", defaultColumns);
+            trafficLightController = std::make_shared<GreenWaveController>(cycleTime, vMax, brakeProbability, numberOfColumns);
         }
         else if (controllerType == "random_offset")
-            trafficLightController = std::make_shared<RandomOffsetController>(rng);
+            trafficLightController = std::make_shared<RandomOffsetController>(cycleTime, rng);
+        else if (controllerType == "group_cycle")
+            trafficLightController = std::make_shared<GroupCycleController>();
+        else if (controllerType == "signal_plan")
+        {
+            //"signalPlan": {"cycleTime": C, "offsets": [...], "greenTimes": [...]}, one entry per group
+            nlohmann::json planConfig = config["simulation"].value("signalPlan", nlohmann::json::object());
+            trafficLightController = std::make_shared<SignalPlanController>(planConfig.value("cycleTime", cycleTime),
+                planConfig.value("offsets", std::vector<unsigned int>()), planConfig.value("greenTimes", std::vector<unsigned int>()));
+        }
+        else if (controllerType == "max_pressure")
+            trafficLightController = std::make_shared<MaxPressureController>(config["simulation"].value("minGreen", 10u), config["simulation"].value("maxGreen", cycleTime));
         else
             throw std::invalid_argument("Unknown controller type in configuration.");
             
@@ -240,13 +264,537 @@ void Simulation::setup()
             trafficLightController->addTrafficLightGroup(TLGroup);
     }
 
-    if (!trafficLightGroups.empty())
+    if (trafficLightController)
         trafficLightController->initialize();
+}
 
-    currentDay = 0;
-    currentHour = 0;
+void Simulation::setupTopology()
+{
+    if (config["simulation"].contains("grid"))
+        setupGrid(config["simulation"]["grid"]);
+    else
+        setupNetwork();
 
-    //printSimulationSettings();
+    for (auto& road : roads)
+        std::sort(road->sharedSectionsPositions.begin(), road->sharedSectionsPositions.end());
+
+    for (auto& road : roads)
+    {
+        road->setupMeasurementPoints(detectorPoints(*road), queueSize);
+
+        std::sort(road->trafficLightPositions.begin(), road->trafficLightPositions.end());
+        for (auto& TLPosition : road->trafficLightPositions)
+            road->lightAt(TLPosition)->calculateDistanceToPreviousTrafficLight();
+    }
+
+    //"centrality": {"weighted": bool, "threads": n} turns on the network-wide centrality pass
+    if (config["simulation"].contains("centrality"))
+    {
+        const auto& centralityConfig = config["simulation"]["centrality"];
+        bool weighted = centralityConfig.is_object() && centralityConfig.value("weighted", false);
+        unsigned int numThreads = centralityConfig.is_object() ? centralityConfig.value("threads", setupThreads) : setupThreads;
+
+        auto centralityStart = std::chrono::steady_clock::now();
+        NetworkCentrality centrality(roads, weighted);
+        centrality.compute(numThreads);
+        centrality.assignTo(trafficLightGroups);
+        std::cout << "Centralities of " << centrality.numJunctions() << " junctions computed in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - centralityStart).count() << " ms" << std::endl;
+    }
+}
+
+std::vector<int> Simulation::detectorPoints(const Road& road) const
+{
+    //"detectors": {"defaultPoints": bool, "spacing": n, "roads": {"<roadID>": [cells]}}
+    nlohmann::json detectorConfig = config["simulation"].value("detectors", nlohmann::json::object());
+
+    std::vector<int> points;
+    if (detectorConfig.value("defaultPoints", true))
+        points = road.defaultMeasurementPoints();
+
+    int spacing = detectorConfig.value("spacing", 0);
+    if (spacing > 0)
+    {
+        for (int cell = spacing - 1; cell < road.roadSize; cell += spacing)
+            points.push_back(cell);
+    }
+
+    std::string roadKey = std::to_string(road.parentRoadID); //Lanes share the detectors of their road
+    if (detectorConfig.contains("roads") && detectorConfig["roads"].contains(roadKey))
+    {
+        for (int cell : detectorConfig["roads"][roadKey].get<std::vector<int>>())
+            points.push_back(cell);
+    }
+    return points;
+}
+
+void Simulation::setupFromImage(const NetworkImage& image)
+{
+    const auto& header = image.header();
+    const int32_t* tables = image.tables();
+    gridColumns = header.gridColumns;
+
+    auto readTable = [tables](uint64_t offset, uint32_t count, int roadSize)
+    {
+        std::vector<int> values(tables + offset, tables + offset + count);
+        for (int value : values)
+            if (value < 0 || value >= roadSize)
+                throw std::runtime_error("Network image has a position outside its road.");
+        return values;
+    };
+
+    roads.reserve(header.numRoads);
+    for (uint64_t i = 0; i < header.numRoads; i++)
+    {
+        const auto& record = image.roads()[i];
+        addRoad(record.roadID, record.roadSize, record.isPeriodic != 0, record.density, record.numCars, record.alphaWeight, record.beta);
+        roads.back()->parentRoadID = record.parentRoadID;
+        roads.back()->lane = record.lane;
+        roads.back()->storage = static_cast<Road::Storage>(record.storage);
+    }
+    normalizeAlphaWeights();
+    buildRoads();
+
+    std::vector<std::shared_ptr<TrafficLight>> trafficLights;
+    trafficLights.reserve(header.numLights);
+    for (uint64_t i = 0; i < header.numRoads; i++)
+    {
+        const auto& record = image.roads()[i];
+        auto& road = roads[i];
+
+        for (uint32_t c = 0; c < record.numConnections; c++)
+        {
+            const auto& connection = image.connections()[record.firstConnection + c];
+            if (connection.site < 0 || connection.site >= road->roadSize || connection.otherRoadID < 0 || connection.otherRoadID >= static_cast<int32_t>(roads.size()) ||
+                connection.otherSite < 0 || connection.otherSite >= roads[connection.otherRoadID]->roadSize)
+                throw std::runtime_error("Network image has an invalid shared section.");
+
+            auto section = road->wiredSection(connection.site);
+            section->connectedSections.push_back(roads[connection.otherRoadID]->wiredSection(connection.otherSite));
+            section->isSharedSection = true;
+        }
+
+        for (uint32_t p = 0; p < record.numProbabilities; p++)
+        {
+            const auto& probability = image.probabilities()[record.firstProbability + p];
+            road->changingRoadProbs.add(probability.site, probability.probability);
+        }
+
+        road->sharedSectionsPositions = readTable(record.sharedSectionsTable, record.numSharedSections, road->roadSize);
+        road->trafficLightPositions = readTable(record.trafficLightsTable, record.numTrafficLightPositions, road->roadSize);
+        road->setupMeasurementPoints(readTable(record.measurementPointsTable, record.numMeasurementPoints, road->roadSize), queueSize);
+
+        for (uint32_t l = 0; l < record.numLights; l++)
+        {
+            const auto& lightRecord = image.lights()[record.firstLight + l];
+            if (lightRecord.position < 0 || lightRecord.position >= road->roadSize)
+                throw std::runtime_error("Network image has a traffic light outside its road.");
+
+            auto trafficLight = std::make_shared<TrafficLight>(lightRecord.externalControl != 0, lightRecord.timeOpen, lightRecord.timeClosed, road, lightRecord.position);
+            trafficLight->distanceToPreviousTrafficLight = lightRecord.distanceToPreviousTrafficLight;
+            road->wiredSection(lightRecord.position)->trafficLight = trafficLight;
+            road->trafficLights.push_back(trafficLight);
+            trafficLights.push_back(trafficLight);
+        }
+    }
+
+    trafficLightGroups.resize(header.numGroups);
+    for (uint64_t i = 0; i < header.numGroups; i++)
+    {
+        const auto& record = image.groups()[i];
+        if (!record.exists)
+            continue;
+
+        auto group = std::make_shared<TrafficLightGroup>();
+        group->setTransitionTime(record.transitionTime);
+        group->degreeCentrality = record.degreeCentrality;
+        group->betweennessCentrality = record.betweennessCentrality;
+        group->closenessCentrality = record.closenessCentrality;
+        for (uint32_t l = 0; l < record.numLights; l++)
+        {
+            int32_t lightIndex = tables[record.lightsTable + l];
+            if (lightIndex < 0 || lightIndex >= static_cast<int32_t>(trafficLights.size()))
+                throw std::runtime_error("Network image has an invalid traffic light group member.");
+            group->addTrafficLight(trafficLights[lightIndex]);
+        }
+        trafficLightGroups[i] = group;
+    }
+}
+
+void Simulation::setupNetwork()
+{
+    const auto& roadsConfig = config["simulation"]["roads"];
+
+    for (const auto& roadConfig : roadsConfig)
+    {
+        int roadID = roadConfig.value("roadID", 0);
+        int roadSize = roadConfig.value("roadSize", 50);
+
+        int numCars = 0;
+        double density = 0.0;
+        if (roadConfig.contains("density"))
+            density = roadConfig["density"];
+        if (density <= 0.0 && roadConfig.contains("numCars"))
+            numCars = roadConfig["numCars"];
+
+        bool isPeriodic = roadConfig.value("isPeriodic", true);
+        double alpha = roadConfig.value("alphaWeight", 0.0);
+        double beta = roadConfig.value("beta", 0.0);
+
+        addRoad(roadID, roadSize, isPeriodic, density, numCars, alpha, beta);
+        roads.back()->storage = Road::parseStorage(roadConfig.value("storage", "dense"));
+    }
+    for (const auto& roadConfig : roadsConfig)
+    {
+        int numLanes = roadConfig.value("lanes", 1);
+        if (numLanes > 1)
+            addLanes(roadConfig.value("roadID", 0), numLanes);
+    }
+    normalizeAlphaWeights();
+    buildRoads();
+
+    for (const auto& roadConfig : roadsConfig)
+    {
+        if (!roadConfig.contains("sharedSections"))
+            continue;
+
+        int roadID = roadConfig["roadID"];
+        for (const auto& sharedSection : roadConfig["sharedSections"])
+        {
+            if (sharedSection.size() == 5)
+                connectRoads(roadID, sharedSection[1], sharedSection[0], sharedSection[2], sharedSection[3], sharedSection[4]);
+            else
+                std::cerr << "Not enough parameters on shared section specifications" << std::endl;
+        }
+    }
+
+    if (config["simulation"].contains("trafficLightGroups"))
+    {
+        for (const auto& groupConfig : config["simulation"]["trafficLightGroups"])
+            addTrafficLightGroup(groupConfig.value("groupID", -1), groupConfig.value("transitionTime", 0));
+    }
+
+    if (config["simulation"].contains("trafficLights"))
+    {
+        for (const auto& trafficLightConfig : config["simulation"]["trafficLights"])
+        {
+            addTrafficLight(trafficLightConfig["roadID"], trafficLightConfig["position"], trafficLightConfig["externalControl"],
+                            trafficLightConfig.value("timeOpen", 10), trafficLightConfig.value("timeClosed", 10),
+                            trafficLightConfig.value("paired", false), trafficLightConfig.value("groupID", -1));
+        }
+    }
+}
+
+void Simulation::setupGrid(const nlohmann::json& gridConfig)
+{
+    //Same network as settings_generator.py: vertical roads 0..N-1, horizontal roads N..2N-1
+    //and one pair of lights per intersection, built without materialising the JSON
+    int N = gridConfig.value("N", 0);
+    int roadSize = gridConfig.value("roadSize", 50);
+    bool isPeriodic = gridConfig.value("isPeriodic", true);
+    double alphaWeight = isPeriodic ? 0.0 : gridConfig.value("alphaWeight", 0.0);
+    double beta = isPeriodic ? 0.0 : gridConfig.value("beta", 0.0);
+    double density = gridConfig.value("density", 0.0);
+    double probChange = gridConfig.value("probChange", 0.0);
+    int transitionTime = gridConfig.value("transitionTime", 5);
+
+    bool externalControl = gridConfig.value("externalControl", config["simulation"].value("controllerType", "") == "external");
+    int timeOpen = externalControl ? -1 : static_cast<int>(gridConfig.value("timeOpen", 10.0));
+    int timeClosed = externalControl ? -1 : static_cast<int>(gridConfig.value("timeClosed", 10.0));
+
+    if (N < 0 || roadSize <= 0)
+        throw std::invalid_argument("Invalid grid specification: N must be >= 0 and roadSize > 0.");
+    gridColumns = N;
+
+    int numberOfRoads = (N == 0) ? 1 : 2 * N;
+    roads.reserve(numberOfRoads);
+    Road::Storage storage = Road::parseStorage(gridConfig.value("storage", "dense"));
+    for (int roadID = 0; roadID < numberOfRoads; roadID++)
+    {
+        addRoad(roadID, roadSize, isPeriodic, density, 0, alphaWeight, beta);
+        roads.back()->storage = storage;
+    }
+    int numLanes = gridConfig.value("lanes", 1);
+    if (numLanes > 1)
+    {
+        for (int roadID = 0; roadID < numberOfRoads; roadID++)
+            addLanes(roadID, numLanes);
+    }
+    normalizeAlphaWeights();
+    buildRoads();
+
+    //Python's round() breaks ties to even; nearbyint does the same in the default rounding mode
+    std::vector<int> intersectionIndices(N);
+    for (int i = 0; i < N; i++)
+        intersectionIndices[i] = static_cast<int>(std::nearbyint((i + 0.5) / N * (roadSize - 1)));
+
+    //Shared sections are listed per vertical road, which fixes the connection order
+    for (int column = 0; column < N; column++)
+        for (int row = 0; row < N; row++)
+            connectRoads(column, intersectionIndices[row], N + row, intersectionIndices[column], probChange, probChange);
+
+    trafficLightGroups.reserve(static_cast<size_t>(N) * N);
+    for (int row = 0; row < N; row++)
+    {
+        for (int column = 0; column < N; column++)
+        {
+            int groupID = row * N + column;
+            addTrafficLightGroup(groupID, transitionTime);
+            addTrafficLight(column, intersectionIndices[row], externalControl, timeOpen, timeClosed, true, groupID);
+            addTrafficLight(N + row, intersectionIndices[column], externalControl, timeOpen, timeClosed, true, groupID);
+        }
+    }
+}
+
+void Simulation::addRoad(int roadID, int roadSize, bool isPeriodic, double density, int numCars, double alpha, double beta)
+{
+    if (alpha > 0.0)
+    {
+        roadsWithAlpha.push_back(roadID);
+        alphaWeights.add(roadID, alpha);
+    }
+
+    if (beta > 0.0)
+        roadsWithBeta.push_back(roadID);
+
+    //Sections and initial cars are created in bulk by buildRoads once every road exists
+    if (numCars == 0)
+        roads.emplace_back(std::make_shared<Road>(roadID, roadSize, isPeriodic, beta, vMax, brakeProbability, density, rng, queueSize));
+    else
+        roads.emplace_back(std::make_shared<Road>(roadID, roadSize, isPeriodic, beta, vMax, brakeProbability, numCars, rng, queueSize));
+    initialLoads.emplace_back(density, numCars);
+}
+
+void Simulation::buildRoads()
+{
+    chooseRoadStorage();
+
+    size_t totalCells = 0;
+    for (const auto& road : roads)
+    {
+        if (!road->isSparse)
+            totalCells += road->roadSize;
+    }
+
+    //Roads are independent until connected, so their sections are allocated in parallel
+    size_t numThreads = std::min<size_t>(setupThreads, roads.size());
+    if (totalCells < minCellsForParallelSetup)
+        numThreads = 1;
+
+    std::atomic<size_t> nextRoad(0);
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto worker = [&]()
+    {
+        try
+        {
+            for (size_t i = nextRoad++; i < roads.size(); i = nextRoad++)
+                roads[i]->setupSections();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+                failure = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+    if (failure)
+        std::rethrow_exception(failure);
+
+    //Car placement draws from the shared generator, so it stays sequential and in road order
+    for (size_t i = 0; i < roads.size(); i++)
+    {
+        auto [density, numCars] = initialLoads[i];
+        if (numCars == 0)
+            roads[i]->addCarsBasedOnDensity(density);
+        else
+            roads[i]->addCars(numCars);
+    }
+}
+
+void Simulation::chooseRoadStorage()
+{
+    //"storage": "auto" makes a long road sparse when it starts with at most sparseDensity cars per cell.
+    //Lane changing scans every cell of every lane, so multi-lane roads stay dense
+    std::vector<bool> hasLanes(roads.size(), false);
+    for (const auto& road : roads)
+    {
+        if (road->parentRoadID != road->roadID)
+            hasLanes[road->parentRoadID] = true;
+    }
+
+    for (size_t i = 0; i < roads.size(); i++)
+    {
+        auto& road = roads[i];
+        bool multiLane = hasLanes[road->parentRoadID];
+        if (road->storage == Road::Storage::Sparse && multiLane)
+            throw std::invalid_argument("Road " + std::to_string(road->parentRoadID) + " has several lanes and cannot use sparse storage.");
+
+        auto [density, numCars] = initialLoads[i];
+        double initialDensity = numCars > 0 ? static_cast<double>(numCars) / road->roadSize : density;
+        road->isSparse = road->storage == Road::Storage::Sparse ||
+                         (road->storage == Road::Storage::Auto && !multiLane && road->roadSize >= minCellsForSparseStorage && initialDensity <= sparseDensity);
+    }
+}
+
+void Simulation::normalizeAlphaWeights()
+{
+    double alphasSum = 0.0;
+    for (int id : roadsWithAlpha)
+        alphasSum += alphaWeights.get(id);
+
+    if ((std::abs(alphasSum - 1.0) > 1e-6) && alphasSum != 0.0)
+        for (auto& id : roadsWithAlpha)
+            alphaWeights.add(id, (alphaWeights.get(id)/alphasSum));
+}
+
+void Simulation::connectRoads(int roadID, int currentSite, int otherRoadID, int otherSite, double currentToOtherProb, double otherToCurrentProb)
+{
+    if ((roadID >= 0 && roadID < roads.size() && currentSite >= 0 && currentSite < roads[roadID]->roadSize) &&
+        (otherRoadID >= 0 && otherRoadID < roads.size() && otherSite >= 0 && otherSite < roads[otherRoadID]->roadSize))
+    {
+        //Every lane of one road meets every lane of the other: the junction box is shared as a whole
+        for (int lane : lanesOf(roadID))
+        {
+            for (int otherLane : lanesOf(otherRoadID))
+            {
+                roads[lane]->changingRoadProbs.add(currentSite, currentToOtherProb);
+                roads[otherLane]->changingRoadProbs.add(otherSite, otherToCurrentProb);
+                auto currentSection = roads[lane]->wiredSection(currentSite);
+                auto otherSection = roads[otherLane]->wiredSection(otherSite);
+                currentSection->connect(otherSection);
+                otherSection->connect(currentSection);
+            }
+        }
+    }
+    else
+        std::cerr << "Invalid roadID or section index in sharedSection." << std::endl;
+}
+
+void Simulation::addTrafficLightGroup(int groupID, int transitionTime)
+{
+    if (groupID < 0)
+        return;
+
+    if (groupID >= trafficLightGroups.size())
+        trafficLightGroups.resize(groupID + 1);
+
+    if (!trafficLightGroups[groupID])
+        trafficLightGroups[groupID] = std::make_shared<TrafficLightGroup>();
+
+    trafficLightGroups[groupID]->setTransitionTime(transitionTime);
+}
+
+void Simulation::addTrafficLight(int roadID, int position, bool externalControl, int timeOpen, int timeClosed, bool paired, int groupID)
+{
+    if (roadID < 0 || roadID >= roads.size())
+    {
+        std::cerr << "Invalid roadID: " << roadID << std::endl;
+        return;
+    }
+
+    auto road = roads[roadID];
+    if (position < 0 || position >= road->roadSize)
+    {
+        std::cerr << "Invalid position: " << position << " on roadID: " << roadID << std::endl;
+        return;
+    }
+
+    std::shared_ptr<TrafficLightGroup> group;
+    if (paired)
+    {
+        if (groupID >= 0 && groupID < trafficLightGroups.size())
+            group = trafficLightGroups[groupID];
+        else
+        {
+            group = std::make_shared<TrafficLightGroup>();
+            trafficLightGroups.push_back(group);
+        }
+    }
+
+    //One light per lane, all in the same group and approach so they switch together
+    for (int lane : lanesOf(roadID))
+    {
+        auto laneRoad = roads[lane];
+        auto trafficLight = std::make_shared<TrafficLight>(externalControl, timeOpen, timeClosed, laneRoad, position);
+        if (group)
+            group->addTrafficLight(trafficLight);
+
+        laneRoad->wiredSection(position)->trafficLight = trafficLight;
+        laneRoad->trafficLights.push_back(trafficLight);
+        laneRoad->trafficLightPositions.push_back(position);
+    }
+}
+
+void Simulation::addLanes(int roadID, int numLanes)
+{
+    //Lanes 1.. are appended after the configured roads; they copy the shape and load of lane 0
+    if (roadID < 0 || roadID >= static_cast<int>(roads.size()) || roads[roadID]->lane != 0)
+        throw std::invalid_argument("Invalid roadID for lanes: " + std::to_string(roadID));
+
+    const auto parent = roads[roadID];
+    auto [density, numCars] = initialLoads[roadID];
+    double alpha = alphaWeights.isThere(roadID) ? alphaWeights.get(roadID) : 0.0;
+
+    if (lanesOfRoad.size() <= static_cast<size_t>(roadID))
+        lanesOfRoad.resize(roadID + 1);
+    lanesOfRoad[roadID] = {roadID};
+    for (int lane = 1; lane < numLanes; lane++)
+    {
+        int laneID = static_cast<int>(roads.size());
+        addRoad(laneID, parent->roadSize, parent->isPeriodic, density, numCars, alpha, parent->beta);
+        roads.back()->storage = parent->storage;
+        roads.back()->parentRoadID = roadID;
+        roads.back()->lane = lane;
+        lanesOfRoad[roadID].push_back(laneID);
+    }
+}
+
+std::vector<int> Simulation::lanesOf(int roadID) const
+{
+    if (roadID < static_cast<int>(lanesOfRoad.size()) && !lanesOfRoad[roadID].empty())
+        return lanesOfRoad[roadID];
+    return {roadID};
+}
+
+void Simulation::setupLaneGroups()
+{
+    //"laneChange": {"rule": "symmetric" | "asymmetric", "probability": p, "lookBack": cells}
+    nlohmann::json laneChangeConfig = config["simulation"].value("laneChange", nlohmann::json::object());
+
+    lanesOfRoad.assign(roads.size(), {});
+    for (const auto& road : roads)
+    {
+        if (road->parentRoadID == road->roadID)
+            continue;
+        if (road->parentRoadID < 0 || road->parentRoadID >= static_cast<int>(roads.size()))
+            throw std::runtime_error("Lane " + std::to_string(road->roadID) + " belongs to an invalid road.");
+
+        auto& lanes = lanesOfRoad[road->parentRoadID];
+        if (lanes.empty())
+            lanes.push_back(road->parentRoadID);
+        lanes.push_back(road->roadID);
+    }
+
+    laneGroups.clear();
+    for (auto& lanes : lanesOfRoad)
+    {
+        if (lanes.empty())
+            continue;
+
+        std::sort(lanes.begin(), lanes.end(), [this](int a, int b) { return roads[a]->lane < roads[b]->lane; });
+        std::vector<std::shared_ptr<Road>> laneRoads;
+        for (int laneID : lanes)
+            laneRoads.push_back(roads[laneID]);
+        laneGroups.push_back(std::make_unique<LaneGroup>(laneRoads, laneChangeConfig));
+    }
 }
 
 
@@ -269,7 +817,7 @@ void Simulation::printSimulationSettings() const
     for (const auto& road : roads)
     {
         std::cout << std::setw(20) << "Road ID" << road->roadID << "\n";
-        std::cout << std::setw(20) << "Road Size" << road->sections.size() << "\n";
+        std::cout << std::setw(20) << "Road Size" << road->roadSize << "\n";
         road->isPeriodic ? std::cout << std::setw(20) << "Periodic boundary" <<  "\n" : std::cout << std::setw(20) << "Open boundary" <<  "\n";
         std::cout << std::setw(20) << "Max Speed" << road->maxSpeed << "\n";
         std::cout << std::setw(20) << "Brake Probability" << road->brakeProb << "\n";
@@ -293,26 +841,227 @@ void Simulation::run()
     case 1:
         break;
 
+    case 2: //Compile only; setup() has already written the network image.
+        break;
+
+    case 4: //Shared warm-up, then one forked run per variant, see runBranches
+        runBranches();
+        break;
+
+    case 3: //Tune a fixed-time signal plan for this network, see SignalOptimizer
+    {
+        SignalOptimizer optimizer(*this);
+        optimizer.run();
+        break;
+    }
+
     default:
         break;
     }
 }
 
 
+void Simulation::runBranches()
+{
+    //"branches": {"warmUpEpisodes": W, "processes": P, "variants": [{...}, ...]}. The warm-up runs
+    //once without outputs; each variant then continues from it in a forked child that shares the
+    //warmed-up state copy-on-write, with its own controller settings and random stream.
+    if (!config["simulation"].contains("branches"))
+        throw std::invalid_argument("executionType 4 needs a 'branches' section in the configuration.");
+
+    const nlohmann::json branchConfig = config["simulation"]["branches"];
+    unsigned long long warmUp = branchConfig.value("warmUpEpisodes", 0ULL);
+    nlohmann::json variants = branchConfig.value("variants", nlohmann::json::array());
+    size_t maxProcesses = std::max(1u, branchConfig.value("processes", std::max(1u, std::thread::hardware_concurrency())));
+    if (warmUp >= episodes || variants.empty())
+        throw std::invalid_argument("Branches need at least one variant and a warm-up shorter than the run.");
+
+    //Everything else (vMax, roads, ...) is fixed by the warm-up, and setupController() would
+    //otherwise read a variant's value for roads that never use it
+    static const std::set<std::string> branchKeys = {"controllerType", "cycleTime", "numberOfColumns", "signalPlan", "minGreen", "maxGreen", "seed", "episodes", "outputFormat"};
+    for (const auto& variant : variants)
+    {
+        if (!variant.is_object())
+            throw std::invalid_argument("Branch variants must be objects of simulation settings.");
+        for (const auto& [key, value] : variant.items())
+            if (branchKeys.count(key) == 0)
+                throw std::invalid_argument("Branch setting '" + key + "' only applies before the warm-up and cannot differ between variants.");
+    }
+
+#ifdef _WIN32
+    throw std::runtime_error("Branching after a shared warm-up needs fork(), which this platform lacks.");
+#else
+    auto warmUpStart = std::chrono::steady_clock::now();
+    scheduleEvents(0);
+    for (unsigned long long episode = 0; episode < warmUp; episode++)
+    {
+        simulateEpisode(episode);
+        finishEpisode(episode);
+    }
+    std::cout << "Warm-up of " << warmUp << " episodes in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - warmUpStart).count() << " s; branching into "
+              << variants.size() << " variants" << std::endl;
+
+    unsigned int warmUpSeed = rng.getSeed();
+    size_t running = 0;
+    size_t failed = 0;
+    auto waitForChild = [&]()
+    {
+        int status = 0;
+        if (wait(&status) > 0)
+        {
+            running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        }
+    };
+
+    std::cout.flush();
+    std::cerr.flush();
+    for (size_t i = 0; i < variants.size(); i++)
+    {
+        if (running == maxProcesses)
+            waitForChild();
+
+        pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error("fork() failed while branching variant " + std::to_string(i) + ".");
+
+        if (pid == 0)
+        {
+            int status = 0;
+            try
+            {
+                config["simulation"].merge_patch(variants[i]);
+                episodes = config["simulation"].value("episodes", episodes);
+                outputFormat = config["simulation"].value("outputFormat", outputFormat);
+                if (episodes <= warmUp || (outputFormat != "json" && outputFormat != "compressed"))
+                    throw std::invalid_argument("Invalid episodes or outputFormat in branch variant.");
+
+                //Distinct, reproducible streams unless the variant names its own seed
+                std::seed_seq branchSeed{warmUpSeed, static_cast<unsigned int>(i)};
+                unsigned int seed;
+                branchSeed.generate(&seed, &seed + 1);
+                rng.seed(variants[i].value("seed", seed));
+
+                runLabel = "_branch_" + std::to_string(i);
+                if (!tracePath.empty())
+                {
+                    //Label before the extension, as in the results and space-time file names
+                    std::filesystem::path branchTracePath(tracePath);
+                    branchTracePath.replace_filename(branchTracePath.stem().string() + runLabel + branchTracePath.extension().string());
+                    tracePath = branchTracePath.string();
+                }
+                checkpointInterval = 0;
+                warmedUpEpisodes = warmUp;
+                setupController();
+                execute();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Branch " << i << " failed: " << e.what() << std::endl;
+                status = 1;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(status); //Skip destructors that belong to the parent
+        }
+        running++;
+    }
+
+    while (running > 0)
+        waitForChild();
+
+    if (failed > 0)
+        throw std::runtime_error(std::to_string(failed) + " of " + std::to_string(variants.size()) + " branches failed.");
+#endif
+}
+
+unsigned long long Simulation::eventTick(unsigned long long episode, StepPhase phase)
+{
+    return 2 * episode + phase;
+}
+
+static unsigned long long firstMultiple(unsigned long long from, unsigned long long interval)
+{
+    return (from + interval - 1) / interval * interval;
+}
+
+void Simulation::scheduleEvents(unsigned long long firstEpisode)
+{
+    //Rare events are scheduled on a timing wheel with two ticks per episode, one dispatched
+    //before the step and one after it, instead of being polled every step
+    trafficGen = std::make_unique<TrafficVolumeGenerator>(roads, roadsWithAlpha, alphaWeights, rng, 0.05, 300);
+    events = std::make_unique<TimingWheel>(eventTick(firstEpisode, BeforeStep));
+
+    setCalendar(firstEpisode);
+    events->schedulePeriodic(eventTick(firstMultiple(firstEpisode, 60), BeforeStep), 2 * 60, [this](unsigned long long tick)
+    {
+        setCalendar(tick / 2);
+    });
+
+    unsigned long long rebalanceInterval = trafficGen->getUpdateInterval();
+    events->schedulePeriodic(eventTick(firstMultiple(firstEpisode, rebalanceInterval), BeforeStep), 2 * rebalanceInterval, [this](unsigned long long tick)
+    {
+        unsigned long long episode = tick / 2;
+        trafficGen->rebalanceAlpha(episode, (episode / 86400) % 7);
+    });
+
+    if (trafficLightController)
+        events->schedule(eventTick(firstEpisode, BeforeStep), [this](unsigned long long tick) { updateController(tick); });
+}
+
+void Simulation::setCalendar(unsigned long long episode)
+{
+    currentMinute = (episode / 60) % 60;
+    currentHour = (episode / 3600) % 24; //Calculate current hour based on elapsed time
+    currentDay = (episode / 86400) % 7;  //Calculate current day of the week (0=Sunday, 6=Saturday)
+}
+
+void Simulation::updateController(unsigned long long tick)
+{
+    //The controller tells when its lights switch next, so it only runs at those steps
+    unsigned long long episode = tick / 2;
+    unsigned long long nextUpdate;
+    {
+        PROFILE_PHASE(ControllerUpdate, -1);
+        trafficLightController->update(episode);
+        nextUpdate = trafficLightController->nextUpdateTime(episode);
+    }
+    if (nextUpdate < episodes)
+        events->schedule(eventTick(nextUpdate, BeforeStep), [this](unsigned long long tick) { updateController(tick); });
+}
+
+void Simulation::simulateEpisode(unsigned long long episode)
+{
+    events->advance(eventTick(episode, BeforeStep));
+
+    for (auto& group : laneGroups)
+        group->changeLanes(rng);
+
+    for (auto& road : roads)
+        road->simulateStep(episode);
+
+#ifdef NASCH_CHECK_JAMS
+    for (const auto& road : roads)
+        road->checkJams(episode);
+#endif
+#ifdef NASCH_CHECK_QUEUES
+    for (const auto& road : roads)
+        road->checkQueues(episode);
+#endif
+}
+
+void Simulation::finishEpisode(unsigned long long episode)
+{
+    events->advance(eventTick(episode, AfterStep));
+}
+
 void Simulation::execute()
 {
     int numberRoads = roads.size();
 
-    TrafficVolumeGenerator trafficGen(
-        roads,
-        roadsWithAlpha,
-        alphaWeights,
-        rng,                  
-        0.05,                 
-        300                   
-    );
-
-    simulationResults["episodes"] = nlohmann::json::array();
+    simulationResults["seed"] = rng.getSeed();
 
     auto now = std::chrono::system_clock::now();
     auto now_time_t = std::chrono::system_clock::to_time_t(now);
@@ -322,26 +1071,159 @@ void Simulation::execute()
     simInfoStream << std::put_time(std::localtime(&now_time_t), "%Y-%m-%d_%H-%M-%S");
     simInfoStream << "." << std::setfill('0') << std::setw(3) << now_ms.count();
     simInfoStream << "_eps_" << episodes
-                  << "_roads_" << numberRoads;
+                  << "_roads_" << numberRoads
+                  << runLabel;
+
+    std::string filename = "sim_results_" + simInfoStream.str() + (outputFormat == "compressed" ? ".nsc" : ".json");
+    if (outputFormat == "compressed")
+    {
+        createHeader();
+        compressedResults = std::make_unique<CompressedResultsWriter>(roads);
+    }
+    else
+        jsonResults = std::make_unique<JsonResultsWriter>();
+    std::string spaceTimePath = uniqueResultsPath("space_time_" + simInfoStream.str() + ".nst");
+    std::string trajectoryPath = uniqueResultsPath("trajectories_" + simInfoStream.str() + ".ntj");
+    steadyState.reset();
+    unsigned long long firstEpisode = warmedUpEpisodes;
+    if (!restorePath.empty())
+        firstEpisode = restoreCheckpoint(filename, spaceTimePath, trajectoryPath);
+    else
+    {
+        if (jsonResults)
+            jsonResults->open(uniqueResultsPath(filename));
+        if (spaceTimeRecorder)
+            spaceTimeRecorder->open(spaceTimePath);
+        if (trajectoryLogger)
+            trajectoryLogger->open(trajectoryPath);
+    }
 
-    std::string filename = "sim_results_" + simInfoStream.str() + ".json";
-    for (unsigned long long episode = 0; episode < episodes; episode++)
+    if (restorePath.empty())
     {
-        currentMinute = (episode / 60) % 60;
-        currentHour = (episode / 3600) % 24; //Calculate current hour based on elapsed time
-        currentDay = (episode / 86400) % 7;  //Calculate current day of the week (0=Sunday, 6=Saturday)
-        trafficGen.update(episode, currentDay);
+        //Samples of a warm-up that ran before execute() are not part of the results
+        for (const auto& road : roads)
+            road->resetDistributions();
+    }
+    resetSampleCursors();
 
-        if (trafficLightController)
-            trafficLightController->update(episode);
+    std::unique_ptr<StateTrace> stateTrace;
+    if (!tracePath.empty())
+    {
+        stateTrace = std::make_unique<StateTrace>(roads);
+        stateTrace->open(tracePath, firstEpisode);
+    }
 
-        for (int roadIndex = 0; roadIndex < numberRoads; roadIndex++)
-            roads[roadIndex]->simulateStep(episode);
+    scheduleEvents(firstEpisode);
+
+    if (checkpointInterval > 0)
+    {
+        //Written after the steps whose successor is a multiple of the interval
+        unsigned long long firstCheckpoint = firstMultiple(firstEpisode + 1, checkpointInterval) - 1;
+        events->schedulePeriodic(eventTick(firstCheckpoint, AfterStep), 2 * checkpointInterval, [&](unsigned long long tick)
+        {
+            unsigned long long nextEpisode = tick / 2 + 1;
+            if (nextEpisode < episodes)
+                writeCheckpoint(nextEpisode, filename, spaceTimePath, trajectoryPath);
+        });
+    }
+
+    if (!steadyStateConfig.is_null() && !steadyState)
+        steadyState = std::make_unique<SteadyStateDetector>(roads, steadyStateConfig, firstEpisode);
+
+#ifdef NASCH_PROFILING
+    StepProfiler::instance().beginRun();
+#endif
+
+    unsigned long long endEpisode = episodes;
+    for (unsigned long long episode = firstEpisode; episode < episodes; episode++)
+    {
+#ifdef NASCH_PROFILING
+        StepProfiler::instance().setEpisode(episode);
+#endif
+        simulateEpisode(episode);
+
+#ifdef NASCH_PROFILING
+        for (const auto& road : roads)
+            StepProfiler::instance().addCarSteps(road->roadID, road->carsPositions.size());
+#endif
+
+        if (stateTrace)
+            stateTrace->record();
 
         collectMetrics(episode);
+
+        if (spaceTimeRecorder)
+            spaceTimeRecorder->record(episode);
+
+        if (trajectoryLogger)
+            trajectoryLogger->record(episode);
+
+        //Observed before finishEpisode, so a checkpoint written after this step includes it
+        bool steady = steadyState && steadyState->observe(episode);
+
+        finishEpisode(episode);
+
+        if (steady)
+        {
+            endEpisode = episode + 1;
+            break;
+        }
+    }
+
+#ifdef NASCH_PROFILING
+    unsigned long long cellUpdates = 0;
+    for (const auto& road : roads)
+        cellUpdates += static_cast<unsigned long long>(road->roadSize) * (endEpisode - firstEpisode);
+    StepProfiler::instance().endRun(cellUpdates);
+#endif
+
+    checkpointWriter.wait();
+    if (stateTrace)
+        stateTrace->close();
+
+    if (spaceTimeRecorder)
+        spaceTimeRecorder->close();
+
+    if (trajectoryLogger)
+        trajectoryLogger->close();
+
+    if (compressedResults)
+        simulationResults["header"]["distributions"] = collectDistributions();
+    else
+        simulationResults["distributions"] = collectDistributions();
+
+    if (steadyState)
+    {
+        nlohmann::json report = steadyState->report();
+        report["episodesRun"] = endEpisode;
+        simulationResults["steadyState"] = report;
+        if (compressedResults)
+            simulationResults["header"]["steadyState"] = report;
+
+        if (steadyState->transientDetected())
+            std::cout << "Steady state from episode " << steadyState->transientEnd();
+        else
+            std::cout << "No steady state detected";
+        std::cout << ", stopped after " << endEpisode << " of " << episodes << " episodes" << std::endl;
+    }
+
+    if (!laneGroups.empty())
+    {
+        nlohmann::json multiLaneSummary = nlohmann::json::array();
+        for (const auto& group : laneGroups)
+            multiLaneSummary.push_back(group->summary());
+        if (compressedResults)
+            simulationResults["header"]["multiLaneRoads"] = multiLaneSummary;
+        else
+            simulationResults["multiLaneRoads"] = multiLaneSummary;
     }
 
     serializeResults(filename);
+
+#ifdef NASCH_PROFILING
+    StepProfiler::instance().printSummary(std::cout);
+    StepProfiler::instance().writeTrace();
+#endif
 }
 
 void Simulation::clearScreen() const
@@ -362,21 +1244,21 @@ void Simulation::printRoadStates() const
         std::stringstream tlLine;
         std::stringstream carLine;
 
-        int roadSize = roads[roadIndex]->sections.size();
+        int roadSize = roads[roadIndex]->roadSize;
         for (int sectionIndex = 0; sectionIndex < roadSize; sectionIndex++)
         {
-            if (roads[roadIndex]->sections[sectionIndex]->trafficLight)
+            if (roads[roadIndex]->lightAt(sectionIndex))
             {
-                tlLine << (roads[roadIndex]->sections[sectionIndex]->trafficLight->state ? "[O]" : "[C]");
+                tlLine << (roads[roadIndex]->lightAt(sectionIndex)->state ? "[O]" : "[C]");
             }
             else
             {
                 tlLine << "   ";
             }
 
-            if (roads[roadIndex]->sections[sectionIndex]->currentCar)
+            if (roads[roadIndex]->carAt(sectionIndex))
             {
-                carLine << " " << roads[roadIndex]->sections[sectionIndex]->currentCar->originalRoadID << " ";
+                carLine << " " << roads[roadIndex]->carAt(sectionIndex)->originalRoadID << " ";
             }
             else
             {
@@ -397,6 +1279,7 @@ void Simulation::createHeader()
     headerData["simulationConfig"]["queueSize"] = queueSize;
     headerData["simulationConfig"]["vMax"] = vMax;
     headerData["simulationConfig"]["brakeProbability"] = brakeProbability;
+    headerData["simulationConfig"]["seed"] = rng.getSeed();
 
     for (const auto& road : roads)
     {
@@ -451,8 +1334,72 @@ void Simulation::createHeader()
 }
 
 
+template <typename T>
+static std::vector<T> queueSamples(const LimitedQueue<T>& queue, unsigned long long& lastSeen, bool onlyNew)
+{
+    //Samples pushed and evicted again since the previous episode are lost either way
+    size_t count = onlyNew ? std::min<unsigned long long>(queue.totalPushed() - lastSeen, queue.size()) : queue.size();
+    lastSeen = queue.totalPushed();
+    return std::vector<T>(queue.end() - count, queue.end());
+}
+
+void Simulation::resetSampleCursors()
+{
+    sampleCursors.assign(roads.size(), SampleCursors());
+    for (const auto& road : roads)
+    {
+        auto& cursors = sampleCursors[road->roadID];
+        for (const auto& queue : road->getLoggedTimeHeadways())
+            cursors.timeHeadways.push_back(queue.totalPushed());
+        cursors.residenceTimes = road->residenceTimes.totalPushed();
+        cursors.travelTimes = road->travelTimes.totalPushed();
+        cursors.averageTravelTimes = road->averageTravelTimes.totalPushed();
+    }
+}
+
+nlohmann::json Simulation::collectDistributions() const
+{
+    nlohmann::json distributions = nlohmann::json::array();
+    for (const auto& road : roads)
+    {
+        nlohmann::json roadData;
+        roadData["roadID"] = road->roadID;
+
+        LogHistogram allPoints;
+        nlohmann::json pointsData = nlohmann::json::array();
+        for (size_t detector = 0; detector < road->timeHeadwayAndFlowPoints.size(); detector++)
+        {
+            const auto& histogram = road->timeHeadwayHistograms[detector];
+            pointsData.push_back({{"pointIndex", road->timeHeadwayAndFlowPoints[detector]}, {"timeHeadways", histogram.toJson()}});
+            allPoints.merge(histogram);
+        }
+        roadData["points"] = pointsData;
+        roadData["timeHeadways"] = allPoints.toJson();
+        roadData["residenceTimes"] = road->residenceTimeHistogram.toJson();
+        roadData["travelTimes"] = road->travelTimeHistogram.toJson();
+        roadData["jamLifetimes"] = road->jamTracker.lifetimes.toJson();
+        roadData["jamSizes"] = road->jamTracker.sizes.toJson();
+        roadData["jamsStarted"] = road->jamTracker.jamsStarted();
+
+        nlohmann::json activeJams = nlohmann::json::array();
+        for (const auto& jam : road->jamTracker.activeJams())
+            activeJams.push_back({{"id", jam.id}, {"birth", jam.birth}, {"back", jam.back}, {"front", jam.front}, {"size", jam.size}, {"maxSize", jam.maxSize}});
+        roadData["activeJams"] = activeJams;
+        distributions.push_back(roadData);
+    }
+    return distributions;
+}
+
 void Simulation::collectMetrics(unsigned long long episode)
 {
+    PROFILE_PHASE(CollectMetrics, -1);
+
+    if (compressedResults)
+    {
+        compressedResults->recordEpisode(episode);
+        return;
+    }
+
     nlohmann::json episodeData;
     episodeData["episode"]       = episode;
     episodeData["currentDay"]    = currentDay;
@@ -471,35 +1418,38 @@ void Simulation::collectMetrics(unsigned long long episode)
         roadData["numCars"] = road->carsPositions.size();
         //roadData["roadRepresentation"] = road->getRoadRepresentation();
 
-        nlohmann::json timeHeadwaysData = nlohmann::json::array();
-        const auto& timeHeadways = road->getLoggedTimeHeadways();
-        for (const auto& [point, queue] : timeHeadways)
+        auto& cursors = sampleCursors[road->roadID];
+        if (sampleOutput != "none")
         {
-            nlohmann::json pointData;
-            pointData["pointIndex"] = point;
-            std::vector<unsigned long long> timeHeadwayValues(queue.begin(), queue.end());
-            pointData["timeHeadways"] = timeHeadwayValues;
-            timeHeadwaysData.push_back(pointData);
+            nlohmann::json timeHeadwaysData = nlohmann::json::array();
+            const auto& timeHeadways = road->getLoggedTimeHeadways();
+            for (size_t detector = 0; detector < timeHeadways.size(); detector++)
+            {
+                nlohmann::json pointData;
+                pointData["pointIndex"] = road->timeHeadwayAndFlowPoints[detector];
+                pointData["timeHeadways"] = queueSamples(timeHeadways[detector], cursors.timeHeadways[detector], sampleOutput == "new");
+                timeHeadwaysData.push_back(pointData);
+            }
+            roadData["timeHeadways"] = timeHeadwaysData;
         }
-        roadData["timeHeadways"] = timeHeadwaysData;
 
         nlohmann::json flowData = nlohmann::json::array();
-        const auto& flow = road->flowAtPoints;
-        for (const auto& [point, value] : flow)
+        for (size_t detector = 0; detector < road->flowAtPoints.size(); detector++)
         {
             nlohmann::json pointData;
-            pointData["pointIndex"] = point;
-            pointData["flow"] = value;
+            pointData["pointIndex"] = road->timeHeadwayAndFlowPoints[detector];
+            pointData["flow"] = road->flowAtPoints[detector];
             flowData.push_back(pointData);
         }
         roadData["flow"] = flowData;
 
-        std::vector<int> resTimesVec(road->residenceTimes.begin(), road->residenceTimes.end());
-        roadData["residenceTimes"] = resTimesVec;
-        std::vector<int> travelTimesVec(road->travelTimes.begin(), road->travelTimes.end());
-        roadData["travelTimes"] = travelTimesVec;
-        std::vector<double> avgTravelVec(road->averageTravelTimes.begin(), road->averageTravelTimes.end());
-        roadData["averageTravelTimes"] = avgTravelVec;
+        if (sampleOutput != "none")
+        {
+            bool onlyNew = sampleOutput == "new";
+            roadData["residenceTimes"] = queueSamples(road->residenceTimes, cursors.residenceTimes, onlyNew);
+            roadData["travelTimes"] = queueSamples(road->travelTimes, cursors.travelTimes, onlyNew);
+            roadData["averageTravelTimes"] = queueSamples(road->averageTravelTimes, cursors.averageTravelTimes, onlyNew);
+        }
 
         roadData["newCarInserted"] = road->newCarInserted;
 
@@ -508,7 +1458,7 @@ void Simulation::collectMetrics(unsigned long long episode)
         {
             nlohmann::json tlData;
             tlData["isGreen"] = tl->isGreen();
-            tlData["timer"]   = tl->timer;
+            tlData["timer"]   = tl->timeInState(episode);
             trafficLightsArray.push_back(tlData);
         }
         roadData["trafficLights"] = trafficLightsArray;
@@ -524,10 +1474,21 @@ void Simulation::collectMetrics(unsigned long long episode)
     }
     episodeData["trafficLightGroups"] = tlGroupsData;
 
-    simulationResults["episodes"].push_back(episodeData);
+    if (!laneGroups.empty())
+    {
+        nlohmann::json multiLaneData = nlohmann::json::array();
+        for (const auto& group : laneGroups)
+            multiLaneData.push_back(group->episodeMetrics());
+        episodeData["multiLaneRoads"] = multiLaneData;
+    }
+
+    if (jsonResults)
+        jsonResults->record(episodeData);
+    else
+        simulationResults["episodes"].push_back(episodeData);
 }
 
-void Simulation::serializeResults(const std::string& filename) const
+std::string Simulation::uniqueResultsPath(const std::string& filename) const
 {
     std::string fullPath = resultsPath + "/" + filename;
     std::string modifiedPath = fullPath;
@@ -542,6 +1503,29 @@ void Simulation::serializeResults(const std::string& filename) const
             modifiedPath = fullPath.substr(0, dotPos) + "_" + std::to_string(++counter) + fullPath.substr(dotPos);
     }
 
+    return modifiedPath;
+}
+
+void Simulation::serializeResults(const std::string& filename) const
+{
+    PROFILE_PHASE(SerializeResults, -1);
+
+    if (jsonResults)
+    {
+        jsonResults->close(simulationResults);
+        std::cout << "Results serialized to " << jsonResults->getPath() << std::endl;
+        return;
+    }
+
+    std::string modifiedPath = uniqueResultsPath(filename);
+
+    if (compressedResults)
+    {
+        compressedResults->writeToFile(modifiedPath, simulationResults["header"]);
+        std::cout << "Results serialized to " << modifiedPath << std::endl;
+        return;
+    }
+
     std::ofstream file(modifiedPath);
     if (file.is_open())
     {
@@ -552,3 +1536,148 @@ void Simulation::serializeResults(const std::string& filename) const
     else
         std::cerr << "Unable to open file for serialization: " << modifiedPath << std::endl;
 }
+
+void Simulation::writeCheckpoint(unsigned long long nextEpisode, const std::string& filename, const std::string& spaceTimePath, const std::string& trajectoryPath)
+{
+    if (jsonResults)
+        jsonResults->flush();
+    if (spaceTimeRecorder)
+        spaceTimeRecorder->flush();
+    if (trajectoryLogger)
+        trajectoryLogger->flush();
+
+    checkpointWriter.write(checkpointPath, [&](ByteWriter& output)
+    {
+        output.writeBytes(reinterpret_cast<const uint8_t*>("NSCK"), 4);
+        output.writeByte(Checkpoint::formatVersion);
+        output.writeVarint(nextEpisode);
+        output.writeString(filename);
+        output.writeString(spaceTimePath);
+        output.writeString(trajectoryPath);
+
+        std::ostringstream rngState;
+        rngState << rng.generator;
+        output.writeString(rngState.str());
+        output.writeVarint(nextVehicleID);
+
+        output.writeVarint(roads.size());
+        for (const auto& road : roads)
+            road->saveState(output);
+
+        output.writeVarint(laneGroups.size());
+        for (const auto& group : laneGroups)
+            group->saveState(output);
+
+        output.writeByte(trafficLightController ? 1 : 0);
+        if (trafficLightController)
+            trafficLightController->saveState(output);
+
+        output.writeByte(compressedResults ? 1 : 0);
+        if (compressedResults)
+            compressedResults->saveState(output);
+        else
+        {
+            //The episodes are already in the results file, only the other keys are kept in memory
+            std::vector<uint8_t> results = nlohmann::json::to_cbor(simulationResults);
+            output.writeVarint(results.size());
+            output.writeBytes(results.data(), results.size());
+            jsonResults->saveState(output);
+        }
+
+        output.writeByte(spaceTimeRecorder ? 1 : 0);
+        if (spaceTimeRecorder)
+            spaceTimeRecorder->saveState(output);
+
+        output.writeByte(trajectoryLogger ? 1 : 0);
+        if (trajectoryLogger)
+            trajectoryLogger->saveState(output);
+
+        output.writeByte(steadyState ? 1 : 0);
+        if (steadyState)
+            steadyState->saveState(output);
+    });
+}
+
+unsigned long long Simulation::restoreCheckpoint(std::string& filename, std::string& spaceTimePath, std::string& trajectoryPath)
+{
+    std::vector<uint8_t> data = Checkpoint::readFile(restorePath);
+    ByteReader input(data.data(), data.size());
+
+    uint8_t magic[4];
+    input.readBytes(magic, 4);
+    if (std::memcmp(magic, "NSCK", 4) != 0 || input.readByte() != Checkpoint::formatVersion)
+        throw std::runtime_error("Not a checkpoint file of this version: " + restorePath);
+
+    unsigned long long nextEpisode = input.readVarint();
+    filename = input.readString();
+    spaceTimePath = input.readString();
+    trajectoryPath = input.readString();
+
+    std::istringstream rngState(input.readString());
+    rngState >> rng.generator;
+    nextVehicleID = static_cast<uint32_t>(input.readVarint());
+
+    if (input.readVarint() != roads.size())
+        throw std::runtime_error("Checkpoint does not match the number of roads in the configuration.");
+    for (auto& road : roads)
+        road->loadState(input, roads);
+    if (routingTable)
+    {
+        for (const auto& road : roads)
+        {
+            for (int position : road->carsPositions)
+            {
+                if (road->carAt(position)->destinationZone >= static_cast<int>(routingTable->numZones()))
+                    throw std::runtime_error("Checkpoint does not match the routing zones in the configuration.");
+            }
+        }
+    }
+
+    if (input.readVarint() != laneGroups.size())
+        throw std::runtime_error("Checkpoint does not match the lanes in the configuration.");
+    for (auto& group : laneGroups)
+        group->loadState(input);
+
+    bool hasController = input.readByte() != 0;
+    if (hasController != static_cast<bool>(trafficLightController))
+        throw std::runtime_error("Checkpoint does not match the controllerType in the configuration.");
+    if (trafficLightController)
+        trafficLightController->loadState(input);
+
+    bool compressed = input.readByte() != 0;
+    if (compressed != static_cast<bool>(compressedResults))
+        throw std::runtime_error("Checkpoint was written with a different outputFormat.");
+    if (compressedResults)
+        compressedResults->loadState(input);
+    else
+    {
+        size_t resultsSize = input.readVarint();
+        const uint8_t* results = input.skip(resultsSize);
+        simulationResults = nlohmann::json::from_cbor(results, results + resultsSize);
+        jsonResults->resume(input);
+    }
+
+    bool recordsSpaceTime = input.readByte() != 0;
+    if (recordsSpaceTime != static_cast<bool>(spaceTimeRecorder))
+        throw std::runtime_error("Checkpoint does not match the spaceTimeDiagram configuration.");
+    if (spaceTimeRecorder)
+        spaceTimeRecorder->resume(spaceTimePath, input);
+
+    bool logsTrajectories = input.readByte() != 0;
+    if (logsTrajectories != static_cast<bool>(trajectoryLogger))
+        throw std::runtime_error("Checkpoint does not match the trajectories configuration.");
+    if (trajectoryLogger)
+        trajectoryLogger->resume(trajectoryPath, input);
+
+    bool detectsSteadyState = input.readByte() != 0;
+    if (detectsSteadyState != !steadyStateConfig.is_null())
+        throw std::runtime_error("Checkpoint does not match the steadyState configuration.");
+    if (detectsSteadyState)
+    {
+        steadyState = std::make_unique<SteadyStateDetector>(roads, steadyStateConfig, nextEpisode);
+        steadyState->loadState(input);
+    }
+
+    std::cout << "Restored checkpoint " << restorePath << ", resuming at episode " << nextEpisode << std::endl;
+    return nextEpisode;
+}
@@ -14,7 +14,9 @@
 #include <chrono>
 #include <thread>
 #include <ctime>
-#include <iomanip>
+#include <filesystem>
+#include <numeric>
+#include <algorithm>
 #include <nlohmann/json.hpp>
 #include "Dictionary.h"
 #include "RandomNumberGenerator.h"
@@ -24,7 +26,30 @@
 #include "SyncController.h"
 #include "GreenWaveController.h"
 #include "RandomOffsetController.h"
+#include "GroupCycleController.h"
+#include "MaxPressureController.h"
+#include "SignalPlanController.h"
 #include "TrafficVolumeGenerator.h"
+#include "CompressedResultsWriter.h"
+#include "JsonResultsWriter.h"
+#include "SpaceTimeRecorder.h"
+#include "TrajectoryLogger.h"
+#include "Checkpoint.h"
+#include "StateTrace.h"
+#include "StepProfiler.h"
+#include "NetworkImage.h"
+#include "NetworkCentrality.h"
+#include "JunctionGraph.h"
+#include "LaneGroup.h"
+#include "RoutingTable.h"
+#include "TimingWheel.h"
+#include "SignalOptimizer.h"
+#include "SteadyStateDetector.h"
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
 
 class TrafficLightGroup;
 
@@ -49,18 +74,95 @@ private:
     std::shared_ptr<TrafficLightController> trafficLightController;
     short executionType;
     std::string resultsPath;
+    std::string outputFormat; //"json" or "compressed"
+    std::string sampleOutput; //Per-episode samples in the JSON output: "new", "window" or "none"
+    std::unique_ptr<CompressedResultsWriter> compressedResults;
+    std::unique_ptr<JsonResultsWriter> jsonResults; //Streams the episodes of the JSON output during execute()
+    std::unique_ptr<SpaceTimeRecorder> spaceTimeRecorder;
+    std::unique_ptr<TrajectoryLogger> trajectoryLogger;
+    std::unique_ptr<JunctionGraph> junctionGraph;
+    std::unique_ptr<RoutingTable> routingTable;
+    std::vector<std::unique_ptr<LaneGroup>> laneGroups;
+    std::vector<std::vector<int>> lanesOfRoad; //roadIDs of the lanes of each multi-lane road, its own first; empty otherwise
+    uint32_t nextVehicleID;
+    unsigned long long checkpointInterval;
+    std::string checkpointPath;
+    std::string restorePath;
+    CheckpointWriter checkpointWriter;
+    std::optional<unsigned int> seedOverride;
+    std::string tracePath;
+    nlohmann::json steadyStateConfig; //Null unless steady-state detection is enabled
+    std::unique_ptr<SteadyStateDetector> steadyState; //Of the current execute(), restored with the checkpoint
+    unsigned int setupThreads;
+    double setupSeconds;
+    std::vector<std::pair<double, int>> initialLoads; //(density, numCars) per road, as configured
+    int gridColumns; //N of a "grid" topology, 0 otherwise
+    static constexpr size_t minCellsForParallelSetup = 1 << 18;
+    static constexpr int minCellsForSparseStorage = 1000; //Shorter roads stay dense under "storage": "auto"
+    double sparseDensity; //Initial density up to which "storage": "auto" picks sparse storage
+    std::unique_ptr<TrafficVolumeGenerator> trafficGen;
+    std::unique_ptr<TimingWheel> events; //Two ticks per episode, see eventTick
+
+    enum StepPhase { BeforeStep = 0, AfterStep = 1 };
+    static unsigned long long eventTick(unsigned long long episode, StepPhase phase);
+
+    struct SampleCursors
+    {
+        std::vector<unsigned long long> timeHeadways;
+        unsigned long long residenceTimes;
+        unsigned long long travelTimes;
+        unsigned long long averageTravelTimes;
+    };
+    std::vector<SampleCursors> sampleCursors; //totalPushed of each road queue at the previous episode
+
+    bool verbose; //Prints the setup summary
+    unsigned long long warmedUpEpisodes; //Episodes already run before execute(), see runBranches
+    std::string runLabel; //Appended to output file names
+    friend class SimulationBenchmarks;
+    friend class SignalOptimizer;
+
+    void setupTopology();
+    void setupFromImage(const NetworkImage& image);
+    std::vector<int> detectorPoints(const Road& road) const;
+    void setupNetwork();
+    void setupGrid(const nlohmann::json& gridConfig);
+    void addRoad(int roadID, int roadSize, bool isPeriodic, double density, int numCars, double alpha, double beta);
+    void addLanes(int roadID, int numLanes);
+    void chooseRoadStorage();
+    std::vector<int> lanesOf(int roadID) const;
+    void setupLaneGroups();
+    void buildRoads();
+    void normalizeAlphaWeights();
+    void connectRoads(int roadID, int currentSite, int otherRoadID, int otherSite, double currentToOtherProb, double otherToCurrentProb);
+    void addTrafficLightGroup(int groupID, int transitionTime);
+    void addTrafficLight(int roadID, int position, bool externalControl, int timeOpen, int timeClosed, bool paired, int groupID);
+    void setupController();
+    void assignVehicleIDs();
+    void setCalendar(unsigned long long episode);
+    void updateController(unsigned long long tick);
 
 public:
     Simulation(const std::string& configFilePath, std::string resultsPath, short executionType);
+    Simulation(const nlohmann::json& config, std::string resultsPath, short executionType);
+    void setSeed(unsigned int seed);
     void setup();
     int countTotalCars() const;
     void printSimulationSettings() const;
     void run();
     void execute();
+    void runBranches();
+    void scheduleEvents(unsigned long long firstEpisode);
+    void simulateEpisode(unsigned long long episode); //Events due before the step, then every road
+    void finishEpisode(unsigned long long episode); //Events due after the step
     void clearScreen() const;
     void printRoadStates() const;
     void createHeader();
     void collectMetrics(unsigned long long episode);
+    void resetSampleCursors();
+    nlohmann::json collectDistributions() const;
+    std::string uniqueResultsPath(const std::string& filename) const;
+    void writeCheckpoint(unsigned long long nextEpisode, const std::string& filename, const std::string& spaceTimePath, const std::string& trajectoryPath);
+    unsigned long long restoreCheckpoint(std::string& filename, std::string& spaceTimePath, std::string& trajectoryPath);
     void serializeResults(const std::string& filename) const; 
 };
 
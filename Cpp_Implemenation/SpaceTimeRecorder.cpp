@@ -0,0 +1,178 @@
+#include "SpaceTimeRecorder.h"
+#include <filesystem>
+
+SpaceTimeRecorder::SpaceTimeRecorder(const std::vector<std::shared_ptr<Road>>& roads, const std::vector<std::pair<unsigned long long, unsigned long long>>& windows)
+    : windows(windows), lastRecordedEpisode(0), bytesWritten(0)
+{
+    for (const auto& road : roads)
+    {
+        if (road->maxSpeed > 15)
+            throw std::invalid_argument("Space-time recording supports speeds up to 15, road " + std::to_string(road->roadID) + " allows " + std::to_string(road->maxSpeed) + ".");
+
+        RoadFrames frames;
+        frames.road = road;
+        frames.bitsPerSpeed = road->maxSpeed <= 7 ? 3 : 4;
+        frames.occupancyWords = (road->roadSize + 63) / 64;
+        size_t speedWords = (static_cast<size_t>(road->roadSize) * frames.bitsPerSpeed + 63) / 64;
+        frames.previousFrame.assign(frames.occupancyWords + speedWords, 0);
+        frames.currentFrame.assign(frames.occupancyWords + speedWords, 0);
+        frames.hasPrevious = false;
+        recordedRoads.push_back(std::move(frames));
+    }
+}
+
+void SpaceTimeRecorder::open(const std::string& path)
+{
+    file.open(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open space-time diagram file: " + path);
+
+    buffer.writeBytes(reinterpret_cast<const uint8_t*>("NSST"), 4);
+    buffer.writeByte(formatVersion);
+    buffer.writeVarint(recordedRoads.size());
+    for (const auto& frames : recordedRoads)
+    {
+        buffer.writeVarint(frames.road->roadID);
+        buffer.writeVarint(frames.road->roadSize);
+        buffer.writeVarint(frames.bitsPerSpeed);
+    }
+    flushBuffer();
+}
+
+bool SpaceTimeRecorder::isRecording(unsigned long long episode) const
+{
+    for (const auto& [start, end] : windows)
+        if (episode >= start && episode < end)
+            return true;
+    return false;
+}
+
+void SpaceTimeRecorder::buildFrame(RoadFrames& frames)
+{
+    auto& frame = frames.currentFrame;
+    std::fill(frame.begin(), frame.end(), 0);
+
+    const auto& road = *frames.road;
+    for (int position : road.carsPositions)
+    {
+        const auto& car = road.carAt(position);
+        if (!car)
+            continue;
+
+        frame[position / 64] |= 1ULL << (position % 64);
+
+        size_t bitIndex = static_cast<size_t>(position) * frames.bitsPerSpeed;
+        size_t word = frames.occupancyWords + bitIndex / 64;
+        int shift = bitIndex % 64;
+        uint64_t speed = static_cast<uint64_t>(car->speed);
+        frame[word] |= speed << shift;
+        if (shift + frames.bitsPerSpeed > 64) //Cell straddles two words
+            frame[word + 1] |= speed >> (64 - shift);
+    }
+}
+
+void SpaceTimeRecorder::record(unsigned long long episode)
+{
+    if (!file.is_open() || !isRecording(episode))
+        return;
+
+    //Start each window with keyframes
+    if (lastRecordedEpisode + 1 != episode)
+        for (auto& frames : recordedRoads)
+            frames.hasPrevious = false;
+
+    for (size_t slot = 0; slot < recordedRoads.size(); slot++)
+    {
+        auto& frames = recordedRoads[slot];
+        buildFrame(frames);
+
+        bool keyframe = !frames.hasPrevious;
+        if (keyframe)
+            std::fill(frames.previousFrame.begin(), frames.previousFrame.end(), 0);
+
+        size_t changedWords = 0;
+        for (size_t i = 0; i < frames.currentFrame.size(); i++)
+            if (frames.currentFrame[i] != frames.previousFrame[i])
+                changedWords++;
+
+        buffer.writeVarint(episode);
+        buffer.writeVarint(slot);
+        buffer.writeByte(keyframe ? 1 : 0);
+        buffer.writeVarint(changedWords);
+
+        size_t lastIndex = 0;
+        for (size_t i = 0; i < frames.currentFrame.size(); i++)
+        {
+            uint64_t delta = frames.currentFrame[i] ^ frames.previousFrame[i];
+            if (delta != 0)
+            {
+                buffer.writeVarint(i - lastIndex);
+                buffer.writeFixed64(delta);
+                lastIndex = i;
+            }
+        }
+
+        std::swap(frames.previousFrame, frames.currentFrame);
+        frames.hasPrevious = true;
+    }
+
+    lastRecordedEpisode = episode;
+    if (buffer.size() >= (1 << 20))
+        flushBuffer();
+}
+
+void SpaceTimeRecorder::flushBuffer()
+{
+    file.write(reinterpret_cast<const char*>(buffer.bytes.data()), buffer.size());
+    bytesWritten += buffer.size();
+    buffer.clear();
+}
+
+void SpaceTimeRecorder::flush()
+{
+    if (file.is_open())
+    {
+        flushBuffer();
+        file.flush();
+    }
+}
+
+void SpaceTimeRecorder::saveState(ByteWriter& output) const
+{
+    //Expects flush() beforehand, so everything up to bytesWritten is on disk
+    output.writeVarint(bytesWritten);
+    output.writeVarint(lastRecordedEpisode);
+    for (const auto& frames : recordedRoads)
+    {
+        output.writeByte(frames.hasPrevious ? 1 : 0);
+        for (uint64_t word : frames.previousFrame)
+            output.writeFixed64(word);
+    }
+}
+
+void SpaceTimeRecorder::resume(const std::string& path, ByteReader& input)
+{
+    bytesWritten = input.readVarint();
+    lastRecordedEpisode = input.readVarint();
+    for (auto& frames : recordedRoads)
+    {
+        frames.hasPrevious = input.readByte() != 0;
+        for (auto& word : frames.previousFrame)
+            word = input.readFixed64();
+    }
+
+    //Drop frames recorded after the checkpoint was taken
+    std::filesystem::resize_file(path, bytesWritten);
+    file.open(path, std::ios::binary | std::ios::app);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to reopen space-time diagram file: " + path);
+}
+
+void SpaceTimeRecorder::close()
+{
+    if (file.is_open())
+    {
+        flushBuffer();
+        file.close();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef SPACE_TIME_RECORDER_H
+#define SPACE_TIME_RECORDER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <utility>
+#include <cstdint>
+#include "Road.h"
+#include "ByteStream.h"
+
+//Records the space-time diagram of selected roads inside configured episode windows.
+//Each frame is an occupancy bit plane followed by a speed plane with 3 bits per cell
+//(4 when the road allows speeds above 7), stored as 64-bit words. A frame is XORed with
+//the previous frame of the same road and only the non-zero words are written.
+//
+//File layout: "NSST", format version byte, varint road count, then for each road its
+//varint roadID, roadSize and bits per speed. Records follow until the end of the file:
+//varint episode, varint road slot, keyframe byte, varint number of changed words and
+//for each of them a varint gap to the previous changed word and the fixed64 XOR word.
+class SpaceTimeRecorder
+{
+public:
+    static constexpr uint8_t formatVersion = 1;
+
+    SpaceTimeRecorder(const std::vector<std::shared_ptr<Road>>& recordedRoads, const std::vector<std::pair<unsigned long long, unsigned long long>>& windows);
+    void open(const std::string& path);
+    void record(unsigned long long episode);
+    void close();
+    void flush();
+    bool isRecording(unsigned long long episode) const;
+    void saveState(ByteWriter& output) const;
+    void resume(const std::string& path, ByteReader& input);
+
+private:
+    struct RoadFrames
+    {
+        std::shared_ptr<Road> road;
+        int bitsPerSpeed;
+        size_t occupancyWords;
+        std::vector<uint64_t> previousFrame;
+        std::vector<uint64_t> currentFrame;
+        bool hasPrevious;
+    };
+
+    std::vector<RoadFrames> recordedRoads;
+    std::vector<std::pair<unsigned long long, unsigned long long>> windows; //[start, end) episode ranges
+    std::ofstream file;
+    ByteWriter buffer;
+    unsigned long long lastRecordedEpisode;
+    unsigned long long bytesWritten;
+
+    void buildFrame(RoadFrames& frames);
+    void flushBuffer();
+};
+
+#endif
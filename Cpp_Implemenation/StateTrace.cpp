@@ -0,0 +1,75 @@
+#include "StateTrace.h"
+
+namespace
+{
+    constexpr uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+    constexpr uint64_t fnvPrime = 1099511628211ULL;
+
+    void hashInt(uint64_t& hash, int64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            hash ^= static_cast<uint8_t>(value >> (8 * i));
+            hash *= fnvPrime;
+        }
+    }
+}
+
+StateTrace::StateTrace(const std::vector<std::shared_ptr<Road>>& roads) : roads(roads)
+{
+}
+
+void StateTrace::open(const std::string& path, unsigned long long firstEpisode)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open trace file: " + path);
+
+    buffer.writeBytes(reinterpret_cast<const uint8_t*>("NSTR"), 4);
+    buffer.writeByte(formatVersion);
+    buffer.writeFixed64(firstEpisode);
+}
+
+uint64_t StateTrace::hashState() const
+{
+    uint64_t hash = fnvOffsetBasis;
+    for (const auto& road : roads)
+    {
+        hashInt(hash, road->roadID);
+        for (int i = 0; i < road->roadSize; i++)
+        {
+            const auto& car = road->carAt(i);
+            if (car)
+            {
+                hashInt(hash, i);
+                hashInt(hash, car->speed);
+            }
+        }
+        for (const auto& trafficLight : road->trafficLights)
+            hashInt(hash, trafficLight->state ? 1 : 0);
+    }
+    return hash;
+}
+
+void StateTrace::record()
+{
+    if (!file.is_open())
+        return;
+
+    buffer.writeFixed64(hashState());
+    if (buffer.size() >= (1 << 16))
+    {
+        file.write(reinterpret_cast<const char*>(buffer.bytes.data()), buffer.size());
+        buffer.clear();
+    }
+}
+
+void StateTrace::close()
+{
+    if (file.is_open())
+    {
+        file.write(reinterpret_cast<const char*>(buffer.bytes.data()), buffer.size());
+        buffer.clear();
+        file.close();
+    }
+}
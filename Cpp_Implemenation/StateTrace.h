@@ -0,0 +1,35 @@
+#ifndef STATE_TRACE_H
+#define STATE_TRACE_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include "Road.h"
+#include "ByteStream.h"
+
+//Per-step fingerprint of the simulation state, used to check that engine changes keep
+//the behaviour of the reference build. Each step is reduced to a 64-bit FNV-1a hash of
+//every road's car positions and speeds (in cell order) and its traffic light states.
+//
+//File layout: "NSTR", format version byte, fixed64 first episode, then one fixed64
+//hash per step.
+class StateTrace
+{
+public:
+    static constexpr uint8_t formatVersion = 1;
+
+    StateTrace(const std::vector<std::shared_ptr<Road>>& roads);
+    void open(const std::string& path, unsigned long long firstEpisode);
+    void record();
+    void close();
+    uint64_t hashState() const;
+
+private:
+    std::vector<std::shared_ptr<Road>> roads;
+    std::ofstream file;
+    ByteWriter buffer;
+};
+
+#endif
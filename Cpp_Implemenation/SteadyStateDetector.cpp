@@ -0,0 +1,228 @@
+#include "SteadyStateDetector.h"
+#include <cmath>
+#include <limits>
+
+SteadyStateDetector::SteadyStateDetector(const std::vector<std::shared_ptr<Road>>& roads, const nlohmann::json& settings, unsigned long long firstEpisode)
+    : roads(roads), firstEpisode(firstEpisode), lastEpisode(firstEpisode), numDetectors(0), lastCrossings(0), pendingSums{}, pending(0),
+      detected(false), truncation(0), precise(false), estimated(false), means{}, halfWidths{}
+{
+    checkInterval = std::max(1ULL, settings.value("checkInterval", 500ULL));
+    numBatches = std::max(2u, settings.value("numBatches", 20u));
+    minBatchMeans = std::max<unsigned long long>(numBatches, settings.value("minEpisodes", 1000ULL) / mserBatchSize);
+    relativeHalfWidth = settings.value("relativeHalfWidth", 0.02);
+    stopWhenPrecise = settings.value("stop", true);
+
+    for (const auto& road : roads)
+    {
+        numDetectors += road->timeHeadwayAndFlowPoints.size();
+        lastCrossings += road->detectorCrossings;
+    }
+}
+
+bool SteadyStateDetector::observe(unsigned long long episode)
+{
+    //Network-wide values of this step: occupancy, speed averaged over cars, crossings per detector
+    size_t numCars = 0;
+    size_t numCells = 0;
+    double speedSum = 0.0;
+    unsigned long long crossings = 0;
+    for (const auto& road : roads)
+    {
+        numCars += road->carsPositions.size();
+        numCells += road->roadSize;
+        if (!road->carsPositions.empty())
+            speedSum += road->averageSpeed * road->carsPositions.size();
+        crossings += road->detectorCrossings;
+    }
+
+    pendingSums[Density] += numCells > 0 ? static_cast<double>(numCars) / numCells : 0.0;
+    pendingSums[Speed] += numCars > 0 ? speedSum / numCars : 0.0;
+    pendingSums[Flow] += numDetectors > 0 ? static_cast<double>(crossings - lastCrossings) / numDetectors : 0.0;
+    lastCrossings = crossings;
+    lastEpisode = episode;
+
+    if (++pending == mserBatchSize)
+    {
+        for (int s = 0; s < NumSeries; s++)
+        {
+            batchMeans[s].push_back(pendingSums[s] / mserBatchSize);
+            pendingSums[s] = 0.0;
+        }
+        pending = 0;
+    }
+
+    if ((episode + 1 - firstEpisode) % checkInterval == 0)
+        check();
+
+    return stopWhenPrecise && precise;
+}
+
+size_t SteadyStateDetector::mserTruncation(const std::vector<double>& values) const
+{
+    //MSER(d) = sum over i >= d of (Z_i - mean_d)^2 / (n - d)^2, from suffix sums in one backward pass
+    size_t n = values.size();
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double bestStatistic = std::numeric_limits<double>::infinity();
+    size_t best = n;
+    for (size_t d = n; d-- > 0;)
+    {
+        sum += values[d];
+        sumSquares += values[d] * values[d];
+        double remaining = static_cast<double>(n - d);
+        if (n - d < 2)
+            continue;
+
+        double statistic = std::max(0.0, sumSquares - sum * sum / remaining) / (remaining * remaining);
+        if (statistic <= bestStatistic)
+        {
+            bestStatistic = statistic;
+            best = d;
+        }
+    }
+    return best;
+}
+
+void SteadyStateDetector::estimate(const std::vector<double>& values, double& mean, double& halfWidth) const
+{
+    //numBatches equal batches of the data after the truncation; the oldest remainder is dropped
+    size_t available = values.size() - truncation;
+    size_t batchLength = available / numBatches;
+    size_t start = values.size() - batchLength * numBatches;
+
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    for (unsigned int b = 0; b < numBatches; b++)
+    {
+        double batchSum = 0.0;
+        for (size_t i = 0; i < batchLength; i++)
+            batchSum += values[start + b * batchLength + i];
+        double batchMean = batchSum / batchLength;
+        sum += batchMean;
+        sumSquares += batchMean * batchMean;
+    }
+
+    mean = sum / numBatches;
+    double variance = std::max(0.0, (sumSquares - numBatches * mean * mean) / (numBatches - 1));
+
+    //Student t quantile for 97.5% from its Cornish-Fisher expansion around the normal one
+    const double z = 1.959964;
+    double degrees = numBatches - 1;
+    double t = z + (z * z * z + z) / (4 * degrees) + (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * degrees * degrees);
+    halfWidth = t * std::sqrt(variance / numBatches);
+}
+
+void SteadyStateDetector::check()
+{
+    estimated = false;
+    precise = false;
+
+    size_t n = batchMeans[Density].size();
+    if (n < 2 * static_cast<size_t>(numBatches))
+        return;
+
+    //The transient ends where the slowest series settles; a minimum past half the data means not yet
+    size_t latest = 0;
+    for (int s = 0; s < NumSeries; s++)
+    {
+        size_t d = mserTruncation(batchMeans[s]);
+        if (d > n / 2)
+            return;
+        latest = std::max(latest, d);
+    }
+
+    if (!detected || latest > truncation)
+        truncation = latest;
+    detected = true;
+
+    if (n - truncation < minBatchMeans)
+        return;
+
+    for (int s = 0; s < NumSeries; s++)
+        estimate(batchMeans[s], means[s], halfWidths[s]);
+    estimated = true;
+
+    precise = true;
+    for (int s : {Speed, Flow})
+        precise = precise && halfWidths[s] <= relativeHalfWidth * std::abs(means[s]);
+}
+
+bool SteadyStateDetector::transientDetected() const
+{
+    return detected;
+}
+
+unsigned long long SteadyStateDetector::transientEnd() const
+{
+    return firstEpisode + truncation * mserBatchSize;
+}
+
+nlohmann::json SteadyStateDetector::report() const
+{
+    nlohmann::json result;
+    result["transientDetected"] = detected;
+    result["lastEpisode"] = lastEpisode;
+    if (detected)
+        result["transientEnd"] = transientEnd();
+    result["confidenceReached"] = precise;
+    if (estimated)
+    {
+        const char* names[NumSeries] = {"density", "speed", "flow"};
+        for (int s = 0; s < NumSeries; s++)
+        {
+            result[names[s]]["mean"] = means[s];
+            result[names[s]]["halfWidth"] = halfWidths[s];
+        }
+    }
+    return result;
+}
+
+void SteadyStateDetector::saveState(ByteWriter& output) const
+{
+    output.writeVarint(firstEpisode);
+    output.writeVarint(lastEpisode);
+    output.writeVarint(lastCrossings);
+    output.writeVarint(pending);
+    for (int s = 0; s < NumSeries; s++)
+    {
+        output.writeDouble(pendingSums[s]);
+        output.writeVarint(batchMeans[s].size());
+        for (double value : batchMeans[s])
+            output.writeDouble(value);
+    }
+
+    output.writeByte(detected ? 1 : 0);
+    output.writeVarint(truncation);
+    output.writeByte(precise ? 1 : 0);
+    output.writeByte(estimated ? 1 : 0);
+    for (int s = 0; s < NumSeries; s++)
+    {
+        output.writeDouble(means[s]);
+        output.writeDouble(halfWidths[s]);
+    }
+}
+
+void SteadyStateDetector::loadState(ByteReader& input)
+{
+    firstEpisode = input.readVarint();
+    lastEpisode = input.readVarint();
+    lastCrossings = input.readVarint();
+    pending = static_cast<int>(input.readVarint());
+    for (int s = 0; s < NumSeries; s++)
+    {
+        pendingSums[s] = input.readDouble();
+        batchMeans[s].resize(input.readVarint());
+        for (double& value : batchMeans[s])
+            value = input.readDouble();
+    }
+
+    detected = input.readByte() != 0;
+    truncation = input.readVarint();
+    precise = input.readByte() != 0;
+    estimated = input.readByte() != 0;
+    for (int s = 0; s < NumSeries; s++)
+    {
+        means[s] = input.readDouble();
+        halfWidths[s] = input.readDouble();
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef STEADY_STATE_DETECTOR_H
+#define STEADY_STATE_DETECTOR_H
+
+#include <vector>
+#include <memory>
+#include <array>
+#include <nlohmann/json.hpp>
+#include "Road.h"
+#include "ByteStream.h"
+
+//Watches the network-wide density, mean speed and detector flow of a running simulation.
+//The end of the transient is found with MSER-5: observations are averaged in batches of
+//five and the series is truncated where the squared standard error of the remaining batch
+//means is smallest, which must lie in the first half of the data. After that, the mean flow
+//and speed are estimated by non-overlapping batch means, and the run may stop once their
+//95% confidence half-widths are below the target fraction of the means.
+class SteadyStateDetector
+{
+public:
+    SteadyStateDetector(const std::vector<std::shared_ptr<Road>>& roads, const nlohmann::json& settings, unsigned long long firstEpisode);
+
+    bool observe(unsigned long long episode); //True once the stopping rule is met
+    bool transientDetected() const;
+    unsigned long long transientEnd() const;
+    nlohmann::json report() const;
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
+
+private:
+    enum Series { Density = 0, Speed = 1, Flow = 2, NumSeries = 3 };
+
+    static constexpr int mserBatchSize = 5;
+
+    const std::vector<std::shared_ptr<Road>>& roads;
+    unsigned long long firstEpisode;
+    unsigned long long lastEpisode;
+    unsigned long long checkInterval;
+    unsigned int numBatches;
+    unsigned long long minBatchMeans; //Batch means of five needed after the transient before stopping
+    double relativeHalfWidth;
+    bool stopWhenPrecise;
+
+    size_t numDetectors;
+    unsigned long long lastCrossings;
+    std::array<double, NumSeries> pendingSums;
+    int pending;
+    std::array<std::vector<double>, NumSeries> batchMeans;
+
+    bool detected;
+    size_t truncation; //In batch means of five
+    bool precise;
+    bool estimated; //means and halfWidths belong to the latest check()
+    std::array<double, NumSeries> means;
+    std::array<double, NumSeries> halfWidths;
+
+    size_t mserTruncation(const std::vector<double>& values) const;
+    void estimate(const std::vector<double>& values, double& mean, double& halfWidth) const;
+    void check();
+};
+
+#endif
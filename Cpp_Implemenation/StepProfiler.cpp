@@ -0,0 +1,215 @@
+#include "StepProfiler.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+StepProfiler& StepProfiler::instance()
+{
+    static thread_local StepProfiler profiler;
+    return profiler;
+}
+
+const char* StepProfiler::phaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::TrafficGeneration:      return "trafficGen.update";
+    case Phase::ControllerUpdate:       return "controller.update";
+    case Phase::SimulateStep:           return "simulateStep";
+    case Phase::UpdateSpeeds:           return "updateSpeeds";
+    case Phase::LogTimeHeadways:        return "logTimeHeadways";
+    case Phase::MoveCars:               return "moveCars";
+    case Phase::GeneralDensity:         return "calculateGeneralDensity";
+    case Phase::AverageDistanceHeadway: return "calculateAverageDistanceHeadway";
+    case Phase::AverageSpeed:           return "calculateAverageSpeed";
+    case Phase::CollectMetrics:         return "collectMetrics";
+    case Phase::SerializeResults:       return "serializeResults";
+    default:                            return "unknown";
+    }
+}
+
+void StepProfiler::configureTrace(const std::string& path, unsigned long long firstEpisode, unsigned long long numEpisodes)
+{
+    tracePath = path;
+    traceFirstEpisode = firstEpisode;
+    traceEndEpisode = firstEpisode + numEpisodes;
+}
+
+bool StepProfiler::enableHardwareCounters()
+{
+    std::string error;
+    if (counters.open(error))
+        return true;
+
+    std::cerr << "Hardware counters unavailable (" << error << "); profiling with timers only." << std::endl;
+    return false;
+}
+
+void StepProfiler::beginRun()
+{
+    for (auto& phaseStats : stats)
+        phaseStats.clear();
+    carSteps.clear();
+    traceEvents.clear();
+    runStart = Clock::now();
+    runEnd = runStart;
+}
+
+void StepProfiler::endRun(unsigned long long cellUpdates)
+{
+    runEnd = Clock::now();
+    runCellUpdates = cellUpdates;
+}
+
+void StepProfiler::setEpisode(unsigned long long episode)
+{
+    currentEpisode = episode;
+    tracing = !tracePath.empty() && episode >= traceFirstEpisode && episode < traceEndEpisode;
+}
+
+void StepProfiler::record(Phase phase, int roadID, Clock::time_point start, Clock::time_point end, const PerfCounters::Values* startCounters)
+{
+    uint64_t durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    auto& phaseStats = stats[static_cast<size_t>(phase)];
+    size_t slot = static_cast<size_t>(roadID + 1);
+    if (slot >= phaseStats.size())
+        phaseStats.resize(slot + 1);
+
+    auto& entry = phaseStats[slot];
+    entry.calls++;
+    entry.totalNs += durationNs;
+    entry.maxNs = std::max(entry.maxNs, durationNs);
+
+    if (startCounters)
+    {
+        //Read after the clock so the read() itself is not part of the timed interval
+        auto endCounters = counters.read();
+        for (size_t counter = 0; counter < endCounters.size(); counter++)
+            entry.counters[counter] += endCounters[counter] - (*startCounters)[counter];
+    }
+
+    if (tracing)
+    {
+        uint64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - runStart).count();
+        traceEvents.push_back({phase, roadID, startNs, durationNs, currentEpisode});
+    }
+}
+
+void StepProfiler::addCarSteps(int roadID, unsigned long long cars)
+{
+    size_t slot = static_cast<size_t>(roadID + 1);
+    if (slot >= carSteps.size())
+        carSteps.resize(slot + 1, 0);
+    carSteps[slot] += cars;
+    carSteps[0] += cars;
+}
+
+void StepProfiler::printSummary(std::ostream& output) const
+{
+    double runSeconds = std::chrono::duration<double>(runEnd - runStart).count();
+    double runNs = runSeconds * 1e9;
+
+    output << "Step profile: " << std::fixed << std::setprecision(1) << runSeconds * 1e3 << " ms, "
+           << std::setprecision(0) << (runSeconds > 0.0 ? runCellUpdates / runSeconds : 0.0) << " cell updates/s" << std::endl;
+    output << std::left << std::setw(34) << "phase" << std::right << std::setw(6) << "road"
+           << std::setw(12) << "calls" << std::setw(12) << "total ms" << std::setw(12) << "mean ns"
+           << std::setw(12) << "max ns" << std::setw(8) << "share" << std::endl;
+
+    for (size_t phase = 0; phase < stats.size(); phase++)
+    {
+        const auto& phaseStats = stats[phase];
+        for (size_t slot = 0; slot < phaseStats.size(); slot++)
+        {
+            const auto& entry = phaseStats[slot];
+            if (entry.calls == 0)
+                continue;
+
+            output << std::left << std::setw(34) << phaseName(static_cast<Phase>(phase)) << std::right << std::setw(6)
+                   << (slot == 0 ? std::string("-") : std::to_string(slot - 1))
+                   << std::setw(12) << entry.calls
+                   << std::setw(12) << std::setprecision(2) << entry.totalNs / 1e6
+                   << std::setw(12) << std::setprecision(0) << static_cast<double>(entry.totalNs) / entry.calls
+                   << std::setw(12) << entry.maxNs
+                   << std::setw(7) << std::setprecision(1) << (runNs > 0.0 ? 100.0 * entry.totalNs / runNs : 0.0) << "%"
+                   << std::endl;
+        }
+    }
+    output << std::defaultfloat;
+
+    if (counters.isOpen())
+        printCounterSummary(output);
+}
+
+void StepProfiler::printCounterSummary(std::ostream& output) const
+{
+    output << "Hardware counters per car-step (per road for road phases, over all roads otherwise)" << std::endl;
+    output << std::left << std::setw(34) << "phase" << std::right << std::setw(6) << "road" << std::setw(8) << "IPC";
+    for (int counter : {PerfCounters::Cycles, PerfCounters::L1DMisses, PerfCounters::LLCMisses, PerfCounters::BranchMisses})
+        output << std::setw(16) << PerfCounters::counterName(static_cast<PerfCounters::Counter>(counter));
+    output << std::endl;
+
+    for (size_t phase = 0; phase < stats.size(); phase++)
+    {
+        const auto& phaseStats = stats[phase];
+        for (size_t slot = 0; slot < phaseStats.size(); slot++)
+        {
+            const auto& entry = phaseStats[slot];
+            if (entry.calls == 0)
+                continue;
+
+            unsigned long long cars = slot < carSteps.size() ? carSteps[slot] : 0;
+            const auto& values = entry.counters;
+
+            output << std::left << std::setw(34) << phaseName(static_cast<Phase>(phase)) << std::right << std::setw(6)
+                   << (slot == 0 ? std::string("-") : std::to_string(slot - 1)) << std::fixed << std::setprecision(2);
+
+            if (values[PerfCounters::Cycles] > 0 && counters.isAvailable(PerfCounters::Instructions))
+                output << std::setw(8) << static_cast<double>(values[PerfCounters::Instructions]) / values[PerfCounters::Cycles];
+            else
+                output << std::setw(8) << "n/a";
+
+            for (int counter : {PerfCounters::Cycles, PerfCounters::L1DMisses, PerfCounters::LLCMisses, PerfCounters::BranchMisses})
+            {
+                if (cars > 0 && counters.isAvailable(static_cast<PerfCounters::Counter>(counter)))
+                    output << std::setw(16) << static_cast<double>(values[counter]) / cars;
+                else
+                    output << std::setw(16) << "n/a";
+            }
+            output << std::endl;
+        }
+    }
+    output << std::defaultfloat;
+}
+
+void StepProfiler::writeTrace() const
+{
+    if (tracePath.empty())
+        return;
+
+    //Chrome trace-event format: one complete ("X") event per timed phase, one thread per road
+    nlohmann::json events = nlohmann::json::array();
+    events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 0}, {"tid", 0}, {"args", {{"name", "simulation"}}}});
+
+    int maxRoadID = -1;
+    for (const auto& event : traceEvents)
+        maxRoadID = std::max(maxRoadID, event.roadID);
+    for (int roadID = 0; roadID <= maxRoadID; roadID++)
+        events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 0}, {"tid", roadID + 1}, {"args", {{"name", "road " + std::to_string(roadID)}}}});
+
+    for (const auto& event : traceEvents)
+    {
+        events.push_back({{"name", phaseName(event.phase)}, {"ph", "X"}, {"pid", 0}, {"tid", event.roadID + 1},
+                          {"ts", event.startNs / 1e3}, {"dur", event.durationNs / 1e3}, {"args", {{"episode", event.episode}}}});
+    }
+
+    std::ofstream file(tracePath);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open profiling trace file: " + tracePath);
+
+    file << nlohmann::json({{"traceEvents", events}, {"displayTimeUnit", "ns"}}).dump() << std::endl;
+    std::cout << "Profiling trace written to " << tracePath << std::endl;
+}
@@ -0,0 +1,128 @@
+#ifndef STEP_PROFILER_H
+#define STEP_PROFILER_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include "PerfCounters.h"
+
+//Per-phase timers for the simulation step, aggregated per phase and per road, with an
+//optional Chrome trace-event export (loads in chrome://tracing or Perfetto).
+//Timers are placed with PROFILE_PHASE and only exist when the build defines
+//NASCH_PROFILING (CMake option ENABLE_PROFILING); otherwise they compile to nothing.
+//Hardware counters of the simulation thread can be added to every phase, which
+//costs a read() per timer boundary, so they are off unless requested.
+//instance() is per thread: simulations run on SignalOptimizer worker threads record
+//into their own profiler and never touch the one of the main run.
+class StepProfiler
+{
+public:
+    enum class Phase
+    {
+        TrafficGeneration,
+        ControllerUpdate,
+        SimulateStep,
+        UpdateSpeeds,
+        LogTimeHeadways,
+        MoveCars,
+        GeneralDensity,
+        AverageDistanceHeadway,
+        AverageSpeed,
+        CollectMetrics,
+        SerializeResults,
+        Count
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static StepProfiler& instance();
+    static const char* phaseName(Phase phase);
+
+    void configureTrace(const std::string& path, unsigned long long firstEpisode, unsigned long long numEpisodes);
+    bool enableHardwareCounters();
+    bool hardwareCountersEnabled() const { return counters.isOpen(); }
+    PerfCounters::Values readCounters() const { return counters.read(); }
+    void beginRun();
+    void endRun(unsigned long long cellUpdates);
+    void setEpisode(unsigned long long episode);
+    void record(Phase phase, int roadID, Clock::time_point start, Clock::time_point end, const PerfCounters::Values* startCounters);
+    void addCarSteps(int roadID, unsigned long long cars);
+    void printSummary(std::ostream& output) const;
+    void writeTrace() const;
+
+private:
+    struct PhaseStats
+    {
+        unsigned long long calls = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        PerfCounters::Values counters{};
+    };
+
+    struct TraceEvent
+    {
+        Phase phase;
+        int roadID;
+        uint64_t startNs;
+        uint64_t durationNs;
+        unsigned long long episode;
+    };
+
+    //Indexed by phase, then by roadID + 1 (slot 0 holds phases that are not per road)
+    std::array<std::vector<PhaseStats>, static_cast<size_t>(Phase::Count)> stats;
+    std::vector<unsigned long long> carSteps; //Per road slot, slot 0 holds the total
+    std::vector<TraceEvent> traceEvents;
+    PerfCounters counters;
+    std::string tracePath;
+    unsigned long long traceFirstEpisode = 0;
+    unsigned long long traceEndEpisode = 0;
+    unsigned long long currentEpisode = 0;
+    bool tracing = false;
+    Clock::time_point runStart;
+    Clock::time_point runEnd;
+    unsigned long long runCellUpdates = 0;
+
+    StepProfiler() = default;
+    void printCounterSummary(std::ostream& output) const;
+};
+
+class ScopedPhaseTimer
+{
+public:
+    ScopedPhaseTimer(StepProfiler::Phase phase, int roadID) : phase(phase), roadID(roadID), withCounters(StepProfiler::instance().hardwareCountersEnabled())
+    {
+        if (withCounters)
+            startCounters = StepProfiler::instance().readCounters();
+        start = StepProfiler::Clock::now();
+    }
+
+    ~ScopedPhaseTimer()
+    {
+        auto end = StepProfiler::Clock::now();
+        StepProfiler::instance().record(phase, roadID, start, end, withCounters ? &startCounters : nullptr);
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+    StepProfiler::Phase phase;
+    int roadID;
+    bool withCounters;
+    PerfCounters::Values startCounters;
+    StepProfiler::Clock::time_point start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef NASCH_PROFILING
+#define PROFILE_PHASE(phase, roadID) ScopedPhaseTimer PROFILE_CONCAT(phaseTimer, __LINE__)(StepProfiler::Phase::phase, roadID)
+#else
+#define PROFILE_PHASE(phase, roadID) ((void)0)
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include "SyncController.h"
+#include <algorithm>
 
 SyncController::SyncController()
     : TrafficLightController(60) {}
@@ -7,33 +8,10 @@ void SyncController::initialize()
 {
     calculateCycleTime();
 
+    schedule.clear();
     for (auto& group : trafficLightGroups)
-    {
-        group->initialize();
-        for (size_t j = 0; j < group->trafficLights.size(); ++j)
-        {
-            if (j % 2 == 0)
-                group->trafficLights[j]->state = true; //North-bound starts green
-            else
-                group->trafficLights[j]->state = false; //East-bound starts red
-        }
-    }
-}
-
-void SyncController::update(unsigned long long currentTime)
-{
-    bool isNorthBoundGreen = (currentTime / phaseTime) % 2 == 0;
-
-    for (auto& group : trafficLightGroups)
-    {
-        for (size_t j = 0; j < group->trafficLights.size(); ++j)
-        {
-            if (j % 2 == 0) //North-bound (even index)
-                group->trafficLights[j]->state = isNorthBoundGreen;
-            else //East-bound (odd index)
-                group->trafficLights[j]->state = !isNorthBoundGreen;
-        }
-    }
+        addTwoPhasePlans(*group, 2 * phaseTime, 0, phaseTime);
+    schedule.applyAll(0);
 }
 
 void SyncController::calculateCycleTime()
@@ -42,7 +20,7 @@ void SyncController::calculateCycleTime()
         throw std::runtime_error("No traffic lights to calculate cycle time.");
 
     double TFree = calculateFreeFlowTime(trafficLightGroups[0]->trafficLights[0]);
-    cycleTime = static_cast<unsigned int>(std::round(TFree * 2));
+    cycleTime = std::max(2u, static_cast<unsigned int>(std::round(TFree * 2))); //Lights closer than one step would otherwise stall the cycle
     phaseTime = cycleTime / 2;
 }
 
@@ -11,7 +11,6 @@ public:
     ~SyncController() override;
 
     void initialize() override;
-    void update(unsigned long long currentTime) override;
 
 private:
     unsigned int phaseTime;
@@ -0,0 +1,240 @@
+#include "TimeSeriesCodec.h"
+#include <algorithm>
+
+namespace
+{
+    int countLeadingZeros(uint64_t value)
+    {
+        int count = 0;
+        for (uint64_t mask = 1ULL << 63; mask && !(value & mask); mask >>= 1)
+            count++;
+        return count;
+    }
+
+    int countTrailingZeros(uint64_t value)
+    {
+        if (value == 0)
+            return 64;
+        int count = 0;
+        while (!(value & 1))
+        {
+            value >>= 1;
+            count++;
+        }
+        return count;
+    }
+}
+
+ColumnEncoder::ColumnEncoder(const std::string& name, Type type) : name(name), type(type), count(0)
+{
+}
+
+IntColumnEncoder::IntColumnEncoder(const std::string& name) : ColumnEncoder(name, Type::Integer), previous(0)
+{
+}
+
+void IntColumnEncoder::push(long long value)
+{
+    //Deltas wrap around like two's complement, so extreme values do not overflow
+    encoded.writeSignedVarint(static_cast<long long>(static_cast<unsigned long long>(value) - static_cast<unsigned long long>(previous)));
+    previous = value;
+    count++;
+}
+
+void IntColumnEncoder::finish(ByteWriter& output) const
+{
+    output.writeBytes(encoded.bytes.data(), encoded.size());
+}
+
+void IntColumnEncoder::saveState(ByteWriter& output) const
+{
+    output.writeVarint(count);
+    output.writeSignedVarint(previous);
+    output.writeVarint(encoded.size());
+    output.writeBytes(encoded.bytes.data(), encoded.size());
+}
+
+void IntColumnEncoder::loadState(ByteReader& input)
+{
+    count = input.readVarint();
+    previous = input.readSignedVarint();
+    encoded.bytes.resize(input.readVarint());
+    input.readBytes(encoded.bytes.data(), encoded.size());
+}
+
+BoolColumnEncoder::BoolColumnEncoder(const std::string& name) : ColumnEncoder(name, Type::Boolean), currentValue(false), runLength(0)
+{
+}
+
+void BoolColumnEncoder::push(bool value)
+{
+    if (count == 0)
+    {
+        encoded.writeByte(value ? 1 : 0);
+        currentValue = value;
+    }
+    else if (value != currentValue)
+    {
+        encoded.writeVarint(runLength);
+        currentValue = value;
+        runLength = 0;
+    }
+    runLength++;
+    count++;
+}
+
+void BoolColumnEncoder::finish(ByteWriter& output) const
+{
+    output.writeBytes(encoded.bytes.data(), encoded.size());
+    if (runLength > 0)
+        output.writeVarint(runLength); //Last run is still open
+}
+
+void BoolColumnEncoder::saveState(ByteWriter& output) const
+{
+    output.writeVarint(count);
+    output.writeByte(currentValue ? 1 : 0);
+    output.writeVarint(runLength);
+    output.writeVarint(encoded.size());
+    output.writeBytes(encoded.bytes.data(), encoded.size());
+}
+
+void BoolColumnEncoder::loadState(ByteReader& input)
+{
+    count = input.readVarint();
+    currentValue = input.readByte() != 0;
+    runLength = input.readVarint();
+    encoded.bytes.resize(input.readVarint());
+    input.readBytes(encoded.bytes.data(), encoded.size());
+}
+
+FloatColumnEncoder::FloatColumnEncoder(const std::string& name) : ColumnEncoder(name, Type::Float), previousBits(0), previousLeading(-1), previousTrailing(0)
+{
+}
+
+void FloatColumnEncoder::push(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    if (count == 0)
+    {
+        encoded.writeBits(bits, 64);
+    }
+    else
+    {
+        uint64_t xorValue = bits ^ previousBits;
+        if (xorValue == 0)
+        {
+            encoded.writeBit(false);
+        }
+        else
+        {
+            encoded.writeBit(true);
+            int leading = std::min(countLeadingZeros(xorValue), 31);
+            int trailing = countTrailingZeros(xorValue);
+
+            if (previousLeading != -1 && leading >= previousLeading && trailing >= previousTrailing)
+            {
+                //Meaningful bits fit in the previous window
+                encoded.writeBit(false);
+                encoded.writeBits(xorValue >> previousTrailing, 64 - previousLeading - previousTrailing);
+            }
+            else
+            {
+                int meaningfulBits = 64 - leading - trailing;
+                encoded.writeBit(true);
+                encoded.writeBits(leading, 5);
+                encoded.writeBits(meaningfulBits - 1, 6);
+                encoded.writeBits(xorValue >> trailing, meaningfulBits);
+                previousLeading = leading;
+                previousTrailing = trailing;
+            }
+        }
+    }
+
+    previousBits = bits;
+    count++;
+}
+
+void FloatColumnEncoder::finish(ByteWriter& output) const
+{
+    encoded.flush(output);
+}
+
+void FloatColumnEncoder::saveState(ByteWriter& output) const
+{
+    output.writeVarint(count);
+    output.writeFixed64(previousBits);
+    output.writeSignedVarint(previousLeading);
+    output.writeSignedVarint(previousTrailing);
+    encoded.saveState(output);
+}
+
+void FloatColumnEncoder::loadState(ByteReader& input)
+{
+    count = input.readVarint();
+    previousBits = input.readFixed64();
+    previousLeading = static_cast<int>(input.readSignedVarint());
+    previousTrailing = static_cast<int>(input.readSignedVarint());
+    encoded.loadState(input);
+}
+
+IntColumnDecoder::IntColumnDecoder(const uint8_t* data, size_t size) : reader(data, size), previous(0)
+{
+}
+
+long long IntColumnDecoder::next()
+{
+    previous = static_cast<long long>(static_cast<unsigned long long>(previous) + static_cast<unsigned long long>(reader.readSignedVarint()));
+    return previous;
+}
+
+BoolColumnDecoder::BoolColumnDecoder(const uint8_t* data, size_t size) : reader(data, size), currentValue(false), remaining(0), started(false)
+{
+}
+
+bool BoolColumnDecoder::next()
+{
+    if (!started)
+    {
+        currentValue = reader.readByte() != 0;
+        remaining = reader.readVarint();
+        started = true;
+    }
+    else if (remaining == 0)
+    {
+        currentValue = !currentValue;
+        remaining = reader.readVarint();
+    }
+    remaining--;
+    return currentValue;
+}
+
+FloatColumnDecoder::FloatColumnDecoder(const uint8_t* data, size_t size) : reader(data, size), started(false), previousBits(0), previousLeading(0), previousTrailing(0)
+{
+}
+
+double FloatColumnDecoder::next()
+{
+    if (!started)
+    {
+        previousBits = reader.readBits(64);
+        started = true;
+    }
+    else if (reader.readBit())
+    {
+        if (reader.readBit())
+        {
+            previousLeading = static_cast<int>(reader.readBits(5));
+            int meaningfulBits = static_cast<int>(reader.readBits(6)) + 1;
+            previousTrailing = 64 - previousLeading - meaningfulBits;
+        }
+        int meaningfulBits = 64 - previousLeading - previousTrailing;
+        previousBits ^= reader.readBits(meaningfulBits) << previousTrailing;
+    }
+
+    double value;
+    std::memcpy(&value, &previousBits, sizeof(value));
+    return value;
+}
@@ -0,0 +1,114 @@
+#ifndef TIME_SERIES_CODEC_H
+#define TIME_SERIES_CODEC_H
+
+#include <string>
+#include <cstdint>
+#include "ByteStream.h"
+
+//Column codecs for per-episode output. Values of a column are pushed once per
+//episode (or once per logged sample) and finish() emits the encoded stream.
+class ColumnEncoder
+{
+public:
+    enum class Type : uint8_t
+    {
+        Integer = 0, //Delta + zig-zag + varint
+        Boolean = 1, //Run-length encoded
+        Float = 2    //XOR with previous value (Gorilla-style)
+    };
+
+    std::string name;
+    Type type;
+    unsigned long long count;
+
+    ColumnEncoder(const std::string& name, Type type);
+    virtual ~ColumnEncoder() = default;
+    virtual void finish(ByteWriter& output) const = 0;
+    virtual void saveState(ByteWriter& output) const = 0;
+    virtual void loadState(ByteReader& input) = 0;
+};
+
+class IntColumnEncoder : public ColumnEncoder
+{
+public:
+    explicit IntColumnEncoder(const std::string& name);
+    void push(long long value);
+    void finish(ByteWriter& output) const override;
+    void saveState(ByteWriter& output) const override;
+    void loadState(ByteReader& input) override;
+
+private:
+    ByteWriter encoded;
+    long long previous;
+};
+
+class BoolColumnEncoder : public ColumnEncoder
+{
+public:
+    explicit BoolColumnEncoder(const std::string& name);
+    void push(bool value);
+    void finish(ByteWriter& output) const override;
+    void saveState(ByteWriter& output) const override;
+    void loadState(ByteReader& input) override;
+
+private:
+    ByteWriter encoded; //First value, then the length of every run
+    bool currentValue;
+    unsigned long long runLength;
+};
+
+class FloatColumnEncoder : public ColumnEncoder
+{
+public:
+    explicit FloatColumnEncoder(const std::string& name);
+    void push(double value);
+    void finish(ByteWriter& output) const override;
+    void saveState(ByteWriter& output) const override;
+    void loadState(ByteReader& input) override;
+
+private:
+    BitWriter encoded;
+    uint64_t previousBits;
+    int previousLeading;
+    int previousTrailing;
+};
+
+class IntColumnDecoder
+{
+public:
+    IntColumnDecoder(const uint8_t* data, size_t size);
+    long long next();
+
+private:
+    ByteReader reader;
+    long long previous;
+};
+
+class BoolColumnDecoder
+{
+public:
+    BoolColumnDecoder(const uint8_t* data, size_t size);
+    bool next();
+
+private:
+    ByteReader reader;
+    bool currentValue;
+    unsigned long long remaining;
+    bool started;
+};
+
+class FloatColumnDecoder
+{
+public:
+    FloatColumnDecoder(const uint8_t* data, size_t size);
+    double next();
+
+private:
+    BitReader reader;
+    bool started;
+    uint64_t previousBits;
+    int previousLeading;
+    int previousTrailing;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "TimingWheel.h"
+#include <stdexcept>
+#include <utility>
+
+TimingWheel::TimingWheel(unsigned long long startTick) : nextTick(startTick), numPending(0)
+{
+    for (auto& level : wheel)
+        level.resize(slotsPerLevel);
+}
+
+void TimingWheel::schedule(unsigned long long tick, Callback callback)
+{
+    if (tick < nextTick)
+        throw std::invalid_argument("Cannot schedule an event before the current tick of the timing wheel.");
+
+    insert({tick, 0, std::move(callback)});
+}
+
+void TimingWheel::schedulePeriodic(unsigned long long firstTick, unsigned long long period, Callback callback)
+{
+    if (firstTick < nextTick || period == 0)
+        throw std::invalid_argument("Periodic events need a positive period and a first tick that is not in the past.");
+
+    insert({firstTick, period, std::move(callback)});
+}
+
+void TimingWheel::insert(Event event)
+{
+    numPending++;
+
+    //The lowest level whose slots span both the event and the next tick holds the event
+    for (int level = 0; level < levels; level++)
+    {
+        int shift = slotBits * (level + 1);
+        if ((event.tick >> shift) == (nextTick >> shift))
+        {
+            size_t slot = (event.tick >> (slotBits * level)) & (slotsPerLevel - 1);
+            wheel[level][slot].push_back(std::move(event));
+            return;
+        }
+    }
+    overflow.push_back(std::move(event));
+}
+
+void TimingWheel::advance(unsigned long long tick)
+{
+    while (nextTick <= tick)
+    {
+        if (numPending == 0)
+        {
+            //Nothing can fire: skip the remaining ticks
+            nextTick = tick + 1;
+            continue;
+        }
+
+        if ((nextTick & (slotsPerLevel - 1)) == 0)
+            cascade(nextTick);
+        dispatch(nextTick);
+        nextTick++;
+    }
+}
+
+void TimingWheel::cascade(unsigned long long tick)
+{
+    //Entering a new block of a level: move that block's events one level down, highest level first
+    int top = 1;
+    while (top < levels && ((tick >> (slotBits * top)) & (slotsPerLevel - 1)) == 0)
+        top++;
+
+    if (top == levels)
+    {
+        std::vector<Event> events;
+        events.swap(overflow);
+        numPending -= events.size();
+        for (auto& event : events)
+            insert(std::move(event));
+        top = levels - 1;
+    }
+
+    for (int level = top; level >= 1; level--)
+    {
+        size_t slot = (tick >> (slotBits * level)) & (slotsPerLevel - 1);
+        std::vector<Event> events;
+        events.swap(wheel[level][slot]);
+        numPending -= events.size();
+        for (auto& event : events)
+            insert(std::move(event));
+    }
+}
+
+void TimingWheel::dispatch(unsigned long long tick)
+{
+    auto& slot = wheel[0][tick & (slotsPerLevel - 1)];
+
+    //Callbacks may add events to this slot, so it is walked by index
+    for (size_t i = 0; i < slot.size(); i++)
+    {
+        Event event = std::move(slot[i]);
+        numPending--;
+        event.callback(tick);
+
+        if (event.period > 0)
+        {
+            event.tick += event.period;
+            insert(std::move(event));
+        }
+    }
+    slot.clear();
+}
+
+unsigned long long TimingWheel::currentTick() const
+{
+    return nextTick;
+}
+
+size_t TimingWheel::pending() const
+{
+    return numPending;
+}
@@ -0,0 +1,47 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <vector>
+#include <array>
+#include <functional>
+
+//Hierarchical timing wheel for events that fire at integer times. Four levels of 256 slots
+//cover 2^32 ticks ahead; later events wait in an overflow list. Events due at the same tick
+//run in the order they were scheduled, and an event may schedule further events for the
+//tick being dispatched. Advancing one tick costs O(1) amortised plus the events that fire.
+class TimingWheel
+{
+public:
+    using Callback = std::function<void(unsigned long long tick)>;
+
+    explicit TimingWheel(unsigned long long startTick = 0);
+
+    void schedule(unsigned long long tick, Callback callback);
+    void schedulePeriodic(unsigned long long firstTick, unsigned long long period, Callback callback);
+    void advance(unsigned long long tick); //Fires every event due at or before tick
+    unsigned long long currentTick() const;
+    size_t pending() const;
+
+private:
+    static constexpr int levels = 4;
+    static constexpr int slotBits = 8;
+    static constexpr unsigned long long slotsPerLevel = 1ULL << slotBits;
+
+    struct Event
+    {
+        unsigned long long tick;
+        unsigned long long period; //0 for one-shot events
+        Callback callback;
+    };
+
+    std::array<std::vector<std::vector<Event>>, levels> wheel;
+    std::vector<Event> overflow;
+    unsigned long long nextTick; //First tick that has not been dispatched
+    size_t numPending;
+
+    void insert(Event event);
+    void cascade(unsigned long long tick);
+    void dispatch(unsigned long long tick);
+};
+
+#endif
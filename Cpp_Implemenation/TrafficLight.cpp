@@ -1,9 +1,11 @@
 #include "TrafficLight.h"
+#include "Checkpoint.h"
 #include <iostream>
 #include <algorithm>
 
-TrafficLight::TrafficLight(bool externalControl, std::shared_ptr<Road> ownerRoad, int roadPosition)
-    : externalControl(externalControl), ownerRoad(ownerRoad), roadPosition(roadPosition), state(false), elapsedTime(0)
+TrafficLight::TrafficLight(bool externalControl, short timeOpen, short timeClosed, std::shared_ptr<Road> ownerRoad, int roadPosition)
+    : timeOpen(timeOpen), timeClosed(timeClosed), state(false), lastSwitchTime(0), distanceToPreviousTrafficLight(0), ownerRoad(ownerRoad), roadPosition(roadPosition), externalControl(externalControl),
+      queueLength(0), approachVehicles(0), arrivals(0), departures(0), downstreamLight(nullptr)
 {
 }
 
@@ -16,11 +18,12 @@ void TrafficLight::calculateDistanceToPreviousTrafficLight()
 {
     if (auto roadPtr = ownerRoad.lock())
     {
-        std::vector<int> otherTrafficLightsSameRoad = roadPtr->trafficLightPositions;
+        //Positions are sorted by Simulation::setup, so a binary search finds this light
+        const std::vector<int>& otherTrafficLightsSameRoad = roadPtr->trafficLightPositions;
 
-        auto positionIterator = std::find(otherTrafficLightsSameRoad.begin(), otherTrafficLightsSameRoad.end(), roadPosition);
+        auto positionIterator = std::lower_bound(otherTrafficLightsSameRoad.begin(), otherTrafficLightsSameRoad.end(), roadPosition);
 
-        if (positionIterator == otherTrafficLightsSameRoad.end())
+        if (positionIterator == otherTrafficLightsSameRoad.end() || *positionIterator != roadPosition)
             std::cerr << "No traffic light in the position " << roadPosition << " of the road " << roadPtr->roadID << "." << std::endl;
         else if (otherTrafficLightsSameRoad.size() != 1)
         {
@@ -59,10 +62,23 @@ double TrafficLight::getBrakeProb() const
         throw std::runtime_error("Road is no longer accessible.");
 }
 
-void TrafficLight::toggle()
+void TrafficLight::setState(bool green, unsigned long long time)
 {
-    state = !state;
-    elapsedTime = 0;
+    if (green != state)
+    {
+        state = green;
+        lastSwitchTime = time;
+    }
+}
+
+unsigned long long TrafficLight::timeInState(unsigned long long time) const
+{
+    return time - lastSwitchTime;
+}
+
+bool TrafficLight::isGreen() const
+{
+    return state;
 }
 
 void TrafficLight::setTimeOpen(short time)
@@ -70,3 +86,21 @@ void TrafficLight::setTimeOpen(short time)
     if (!state)
         timeOpen = time;
 }
+
+void TrafficLight::saveState(ByteWriter& output) const
+{
+    Checkpoint::writeValue(output, state);
+    Checkpoint::writeValue(output, lastSwitchTime);
+    Checkpoint::writeValue(output, timeOpen);
+    Checkpoint::writeValue(output, arrivals);
+    Checkpoint::writeValue(output, departures);
+}
+
+void TrafficLight::loadState(ByteReader& input)
+{
+    state = Checkpoint::readValue<bool>(input);
+    lastSwitchTime = Checkpoint::readValue<unsigned long long>(input);
+    timeOpen = Checkpoint::readValue<short>(input);
+    arrivals = Checkpoint::readValue<unsigned long long>(input);
+    departures = Checkpoint::readValue<unsigned long long>(input);
+}
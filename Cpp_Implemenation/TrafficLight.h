@@ -4,6 +4,7 @@
 #include <memory>
 #include "TrafficLightGroup.h"
 #include "Road.h"
+#include "ByteStream.h"
 
 class TrafficLightGroup;
 class Road;
@@ -13,22 +14,31 @@ class TrafficLight : public std::enable_shared_from_this<TrafficLight>
 public:
     short timeOpen;
     short timeClosed;
-    short elapsedTime;
     bool state; //true = green/open, false = red/closed
+    unsigned long long lastSwitchTime; //Time step at which state last changed
     int distanceToPreviousTrafficLight;
     std::weak_ptr<Road> ownerRoad;
     int roadPosition;
     bool externalControl;
+    int queueLength; //Queued cars in the approach, kept up to date by Road::moveCars
+    int approachVehicles; //All cars in the approach
+    unsigned long long arrivals; //Cars that entered the approach
+    unsigned long long departures; //Cars that left the approach
+    TrafficLight* downstreamLight; //Next light on the same road, nullptr if none
 
     std::weak_ptr<TrafficLightGroup> group;
 
-    TrafficLight(bool externalControl, std::shared_ptr<Road> ownerRoad, int roadPosition);
+    TrafficLight(bool externalControl, short timeOpen, short timeClosed, std::shared_ptr<Road> ownerRoad, int roadPosition);
     void setGroup(std::shared_ptr<TrafficLightGroup> groupPtr);
     void calculateDistanceToPreviousTrafficLight();
     void setTimeOpen(short time);
     int getRoadSpeed() const;
     double getBrakeProb() const;
-    void toggle();
+    void setState(bool green, unsigned long long time);
+    unsigned long long timeInState(unsigned long long time) const; //Steps since the last switch
+    bool isGreen() const;
+    void saveState(ByteWriter& output) const;
+    void loadState(ByteReader& input);
 };
 
 #endif
@@ -1,12 +1,50 @@
 #include "TrafficLightController.h"
+#include <algorithm>
 
-void TrafficLightController::addIntersection(const std::shared_ptr<TrafficLightGroup>& group)
+TrafficLightController::TrafficLightController(unsigned int cycleTime) : cycleTime(cycleTime) {}
+
+void TrafficLightController::addTrafficLightGroup(const std::shared_ptr<TrafficLightGroup>& group)
 {
-    intersections.push_back(group);
+    trafficLightGroups.push_back(group);
 }
 
 void TrafficLightController::initialize()
 {
-    for (auto& intersection : intersections)
-        intersection->initialize();
-}
\ No newline at end of file
+    //The lights keep their state until the first update
+}
+
+void TrafficLightController::update(unsigned long long currentTime)
+{
+    schedule.apply(currentTime);
+}
+
+unsigned long long TrafficLightController::nextUpdateTime(unsigned long long currentTime) const
+{
+    return schedule.nextSwitchTime(currentTime);
+}
+
+void TrafficLightController::saveState(ByteWriter&) const
+{
+    //Fixed-time controllers are a function of the time alone
+}
+
+void TrafficLightController::loadState(ByteReader&)
+{
+}
+
+void TrafficLightController::addTwoPhasePlans(const TrafficLightGroup& group, unsigned int cycle, unsigned int offset, unsigned int phaseTime)
+{
+    //North-bound (even approach) lights are green for the first phaseTime steps of the cycle, east-bound for the rest
+    for (size_t j = 0; j < group.trafficLights.size(); ++j)
+    {
+        if (group.approachOfLight[j] % 2 == 0)
+            schedule.add(*group.trafficLights[j], {cycle, offset, 0, phaseTime});
+        else
+            schedule.add(*group.trafficLights[j], {cycle, offset, phaseTime, cycle});
+    }
+}
+
+double TrafficLightController::calculateFreeFlowTime(const std::shared_ptr<TrafficLight>& light) const
+{
+    return light->distanceToPreviousTrafficLight / std::max(0.01, (light->getRoadSpeed() - light->getBrakeProb()));
+}
@@ -3,22 +3,35 @@
 
 #include <vector>
 #include <memory>
+#include <cmath>
+#include <stdexcept>
 #include "TrafficLightGroup.h"
 #include "RandomNumberGenerator.h"
+#include "SignalSchedule.h"
+#include "ByteStream.h"
 
 class TrafficLightController
 {
 public:
-    virtual void updateTrafficLights(unsigned long long timeStep) = 0;
     virtual ~TrafficLightController() = default;
 
-    void addIntersection(const std::shared_ptr<TrafficLightGroup>& group);
-    void initialize();
+    virtual void initialize();
+    virtual void update(unsigned long long currentTime);
+    virtual unsigned long long nextUpdateTime(unsigned long long currentTime) const; //When update must run next
+    virtual void saveState(ByteWriter& output) const;
+    virtual void loadState(ByteReader& input);
+
+    void addTrafficLightGroup(const std::shared_ptr<TrafficLightGroup>& group);
+    double calculateFreeFlowTime(const std::shared_ptr<TrafficLight>& light) const;
 
 protected:
-    std::vector<std::shared_ptr<TrafficLightGroup>> intersections;
+    std::vector<std::shared_ptr<TrafficLightGroup>> trafficLightGroups;
+    unsigned int cycleTime;
+    SignalSchedule schedule; //Fixed-time controllers compile their plans here in initialize()
+
+    void addTwoPhasePlans(const TrafficLightGroup& group, unsigned int cycle, unsigned int offset, unsigned int phaseTime);
 
-    TrafficLightController() = default;
+    explicit TrafficLightController(unsigned int cycleTime);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -7,16 +7,15 @@
 #include "TrafficLight.h"
 
 class TrafficLight;
+struct SignalPlan;
 
 class TrafficLightGroup : public std::enable_shared_from_this<TrafficLightGroup>
 {
 public:
     std::vector<std::shared_ptr<TrafficLight>> trafficLights;
-    int column;
-    int row;
-    int gridHeight;
-    int gridWidth;
-    int degreeCentrality;
+    std::vector<int> approachOfLight; //Lights on the lanes of one road at one cell share an approach and switch together
+    int numApproaches;
+    int degreeCentrality; //Set by NetworkCentrality
     double betweennessCentrality;
     double closenessCentrality;
     std::vector<short> cyclesDuration;
@@ -24,24 +23,13 @@ public:
     TrafficLightGroup();
 
     void addTrafficLight(std::shared_ptr<TrafficLight> trafficLight);
-    void initialize();
-    void update();
     void setTransitionTime(int time);
-    void setCoords(int column, int row);
-    void setGridShape(int h, int w);
-    void calculateCentralities();
-    void calculateDegreeCentrality();
-    void calculateClosenessCentrality();
-    void calculateBetweennessCentrality();
+    int getTransitionTime() const;
+    std::vector<SignalPlan> signalPlans() const;
 
 private:
-    int currentIndex;
-    bool inGreenPhase;
-    bool inTransitionPhase; 
-    int groupTimer;
     int transitionTime;
-    int totalCycleTime;
-    void calculateTotalCycleTime();
+    const TrafficLight& firstLightOf(int approach) const;
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "TrafficVolumeGenerator.h"
+#include "StepProfiler.h"
 
 TrafficVolumeGenerator::TrafficVolumeGenerator(const std::vector<std::shared_ptr<Road>>& roads, const std::vector<int>& roadsWithAlpha, Dictionary<int, double>& alphaWeights, RandomNumberGenerator& rng, double stdDev = 0.025, int updateIntervalSeconds = 300)
         : roads(roads),
@@ -10,10 +11,9 @@ TrafficVolumeGenerator::TrafficVolumeGenerator(const std::vector<std::shared_ptr
 {
 }
 
-void TrafficVolumeGenerator::update(unsigned long long timeStep, int currentDay)
+int TrafficVolumeGenerator::getUpdateInterval() const
 {
-    if (timeStep % updateInterval == 0)
-        rebalanceAlpha(timeStep, currentDay);
+    return updateInterval;
 }
 
 double TrafficVolumeGenerator::weekdayPattern(unsigned long long timeStep, double peak1Time = 25200, double peak2Time = 54000)
@@ -42,6 +42,8 @@ double TrafficVolumeGenerator::weekendPattern(unsigned long long timeStep)
 
 void TrafficVolumeGenerator::rebalanceAlpha(unsigned long long timeStep, int currentDay)
 {
+    PROFILE_PHASE(TrafficGeneration, -1);
+
     double meanProbOnDayTime = 0.0;
     if (currentDay == 0 || currentDay == 6) //(0=Sunday, 6=Saturday)
         meanProbOnDayTime = weekendPattern(timeStep);
@@ -12,7 +12,7 @@ class TrafficVolumeGenerator
 {
 public:
     TrafficVolumeGenerator(const std::vector<std::shared_ptr<Road>>& roads, const std::vector<int>& roadsWithAlpha, Dictionary<int, double>& alphaWeights, RandomNumberGenerator& rng, double stdDev, int updateIntervalSeconds);
-    void update(unsigned long long timeStep, int currentDay);
+    int getUpdateInterval() const;
     void rebalanceAlpha(unsigned long long timeStep, int currentDay);
     double weekdayPattern(unsigned long long timeStep, double peak1Time, double peak2Time);
     double weekendPattern(unsigned long long timeStep);
@@ -0,0 +1,111 @@
+#include "TrajectoryLogger.h"
+#include <cmath>
+#include <filesystem>
+
+TrajectoryLogger::TrajectoryLogger(const std::vector<std::shared_ptr<Road>>& roads, double fraction, unsigned long long interval)
+    : roads(roads), fraction(fraction), interval(interval), bytesWritten(0)
+{
+    if (fraction < 0.0 || fraction > 1.0)
+        throw std::invalid_argument("Trajectory fraction must be between 0 and 1.");
+    if (interval == 0 || interval > UINT32_MAX)
+        throw std::invalid_argument("Trajectory sampling interval must be between 1 and 2^32 - 1.");
+
+    for (const auto& road : roads)
+    {
+        if (road->roadSize > (1 << 24) || road->maxSpeed > 255)
+            throw std::invalid_argument("Trajectory records hold positions below 2^24 and speeds up to 255, road " + std::to_string(road->roadID) + " exceeds them.");
+    }
+
+    threshold = static_cast<uint64_t>(std::ldexp(fraction, 32));
+}
+
+bool TrajectoryLogger::isSampled(uint32_t vehicleID) const
+{
+    //Fibonacci hashing spreads consecutive IDs evenly over [0, 2^32)
+    uint64_t hash = (static_cast<uint64_t>(vehicleID) * 0x9E3779B97F4A7C15ULL) >> 32;
+    return hash < threshold;
+}
+
+void TrajectoryLogger::open(const std::string& path)
+{
+    file.open(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to open trajectory file: " + path);
+
+    buffer.writeBytes(reinterpret_cast<const uint8_t*>("NSTJ"), 4);
+    buffer.writeByte(formatVersion);
+    buffer.writeByte(recordSize);
+    buffer.writeByte(0);
+    buffer.writeByte(0);
+    buffer.writeFixed32(static_cast<uint32_t>(interval));
+    buffer.writeDouble(fraction);
+    flushBuffer();
+}
+
+void TrajectoryLogger::record(unsigned long long episode)
+{
+    if (!file.is_open() || episode % interval != 0)
+        return;
+    if (episode > UINT32_MAX)
+        throw std::runtime_error("Trajectory records hold steps below 2^32.");
+
+    for (const auto& road : roads)
+    {
+        for (int position : road->carsPositions)
+        {
+            const auto& car = road->carAt(position);
+            if (!car || !isSampled(car->vehicleID))
+                continue;
+
+            buffer.writeFixed32(static_cast<uint32_t>(episode));
+            buffer.writeFixed32(car->vehicleID);
+            buffer.writeFixed32(static_cast<uint32_t>(road->roadID));
+            buffer.writeFixed32(static_cast<uint32_t>(position) << 8 | static_cast<uint32_t>(car->speed));
+        }
+    }
+
+    if (buffer.size() >= (1 << 20))
+        flushBuffer();
+}
+
+void TrajectoryLogger::flushBuffer()
+{
+    file.write(reinterpret_cast<const char*>(buffer.bytes.data()), buffer.size());
+    bytesWritten += buffer.size();
+    buffer.clear();
+}
+
+void TrajectoryLogger::flush()
+{
+    if (file.is_open())
+    {
+        flushBuffer();
+        file.flush();
+    }
+}
+
+void TrajectoryLogger::saveState(ByteWriter& output) const
+{
+    //Expects flush() beforehand, so everything up to bytesWritten is on disk
+    output.writeVarint(bytesWritten);
+}
+
+void TrajectoryLogger::resume(const std::string& path, ByteReader& input)
+{
+    bytesWritten = input.readVarint();
+
+    //Drop records written after the checkpoint was taken
+    std::filesystem::resize_file(path, bytesWritten);
+    file.open(path, std::ios::binary | std::ios::app);
+    if (!file.is_open())
+        throw std::runtime_error("Unable to reopen trajectory file: " + path);
+}
+
+void TrajectoryLogger::close()
+{
+    if (file.is_open())
+    {
+        flushBuffer();
+        file.close();
+    }
+}
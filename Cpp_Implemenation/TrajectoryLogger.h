@@ -0,0 +1,48 @@
+#ifndef TRAJECTORY_LOGGER_H
+#define TRAJECTORY_LOGGER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include "Road.h"
+#include "ByteStream.h"
+
+//Appends (step, vehicle, road, position, speed) samples of a subset of the vehicles.
+//A vehicle is sampled when a hash of its vehicleID falls below the configured fraction,
+//so the same vehicles are followed for their whole trip and across runs. Samples are
+//taken every interval steps.
+//
+//File layout: "NSTJ", format version byte, record size byte, two zero bytes, fixed32
+//sampling interval and the sampled fraction as a double. Fixed-width little-endian
+//records follow until the end of the file: fixed32 step, fixed32 vehicleID, fixed32
+//roadID and fixed32 position << 8 | speed.
+class TrajectoryLogger
+{
+public:
+    static constexpr uint8_t formatVersion = 1;
+    static constexpr uint8_t recordSize = 16;
+
+    TrajectoryLogger(const std::vector<std::shared_ptr<Road>>& roads, double fraction, unsigned long long interval);
+    bool isSampled(uint32_t vehicleID) const;
+    void open(const std::string& path);
+    void record(unsigned long long episode);
+    void flush();
+    void close();
+    void saveState(ByteWriter& output) const;
+    void resume(const std::string& path, ByteReader& input);
+
+private:
+    std::vector<std::shared_ptr<Road>> roads;
+    double fraction;
+    uint64_t threshold; //Sampled hashes are below this, out of 2^32
+    unsigned long long interval;
+    std::ofstream file;
+    ByteWriter buffer;
+    unsigned long long bytesWritten;
+
+    void flushBuffer();
+};
+
+#endif
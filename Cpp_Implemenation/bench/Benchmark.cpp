@@ -0,0 +1,57 @@
+#include "Benchmark.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+Benchmark::Benchmark(double minTime, int repetitions, const std::string& filter)
+    : minTime(minTime), repetitions(std::max(repetitions, 1)), filter(filter)
+{
+}
+
+bool Benchmark::isSelected(const std::string& name) const
+{
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+nlohmann::json Benchmark::toJson() const
+{
+    nlohmann::json output = nlohmann::json::array();
+    for (const auto& result : results)
+    {
+        nlohmann::json entry;
+        entry["name"] = result.name;
+        entry["roadSize"] = result.benchmarkCase.roadSize;
+        entry["density"] = result.benchmarkCase.density;
+        entry["vMax"] = result.benchmarkCase.vMax;
+        entry["sharedSections"] = result.benchmarkCase.sharedSections;
+        entry["passes"] = result.passes;
+        entry["nsPerPass"] = result.nsPerPass;
+        entry["callsPerPass"] = result.callsPerPass;
+        entry["carsPerPass"] = result.carsPerPass;
+        entry["cellsPerPass"] = result.cellsPerPass;
+        entry["nsPerCall"] = result.callsPerPass > 0 ? nlohmann::json(result.nsPerPass / result.callsPerPass) : nlohmann::json(nullptr);
+        entry["nsPerCarStep"] = result.carsPerPass > 0 ? nlohmann::json(result.nsPerPass / result.carsPerPass) : nlohmann::json(nullptr);
+        entry["cellsPerSecond"] = result.cellsPerPass > 0 ? nlohmann::json(result.cellsPerPass * 1e9 / result.nsPerPass) : nlohmann::json(nullptr);
+        output.push_back(entry);
+    }
+    return output;
+}
+
+void Benchmark::printResult(const BenchmarkResult& result) const
+{
+    const auto& c = result.benchmarkCase;
+    std::cout << std::left << std::setw(48) << result.name
+              << " L=" << std::setw(5) << c.roadSize
+              << " rho=" << std::setw(4) << c.density
+              << " vMax=" << std::setw(2) << c.vMax
+              << " shared=" << std::setw(3) << c.sharedSections
+              << std::right << std::fixed << std::setprecision(2);
+
+    if (result.carsPerPass > 0)
+        std::cout << std::setw(12) << result.nsPerPass / result.carsPerPass << " ns/car-step"
+                  << std::setw(16) << std::setprecision(0) << result.cellsPerPass * 1e9 / result.nsPerPass << " cells/s";
+    else
+        std::cout << std::setw(12) << result.nsPerPass / std::max<unsigned long long>(result.callsPerPass, 1) << " ns/call";
+
+    std::cout << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,67 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <nlohmann/json.hpp>
+
+struct BenchmarkCase
+{
+    int roadSize;
+    double density;
+    int vMax;
+    int sharedSections;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    BenchmarkCase benchmarkCase;
+    unsigned long long passes;      //Timed passes per repetition
+    double nsPerPass;               //Median over the repetitions
+    unsigned long long callsPerPass;
+    unsigned long long carsPerPass; //Car-steps covered by one pass
+    unsigned long long cellsPerPass;
+};
+
+//Minimal timing harness. A benchmark is a pass body that is timed and an optional
+//prepare step that runs before every pass outside the clock, so mutating hot paths
+//can be measured from the same state each time. The number of passes is calibrated
+//until one repetition takes at least minTime seconds, and the median is reported.
+class Benchmark
+{
+public:
+    std::vector<BenchmarkResult> results;
+
+    Benchmark(double minTime, int repetitions, const std::string& filter);
+
+    bool isSelected(const std::string& name) const;
+
+    template <typename Prepare, typename Body>
+    void run(const std::string& name, const BenchmarkCase& benchmarkCase, unsigned long long callsPerPass, unsigned long long carsPerPass, unsigned long long cellsPerPass, Prepare&& prepare, Body&& body);
+
+    template <typename Body>
+    void run(const std::string& name, const BenchmarkCase& benchmarkCase, unsigned long long callsPerPass, unsigned long long carsPerPass, unsigned long long cellsPerPass, Body&& body);
+
+    nlohmann::json toJson() const;
+    void printResult(const BenchmarkResult& result) const;
+
+private:
+    double minTime;
+    int repetitions;
+    std::string filter;
+
+    template <typename Prepare, typename Body>
+    double timePasses(unsigned long long passes, Prepare& prepare, Body& body) const;
+};
+
+//Keeps the optimizer from discarding results that are otherwise unused
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#include "Benchmark.tpp"
+#endif
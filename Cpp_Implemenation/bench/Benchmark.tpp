@@ -0,0 +1,54 @@
+#ifndef BENCHMARK_TPP
+#define BENCHMARK_TPP
+
+#include "Benchmark.h"
+#include <algorithm>
+
+template <typename Prepare, typename Body>
+double Benchmark::timePasses(unsigned long long passes, Prepare& prepare, Body& body) const
+{
+    std::chrono::steady_clock::duration elapsed{0};
+    for (unsigned long long pass = 0; pass < passes; pass++)
+    {
+        prepare(pass);
+        auto start = std::chrono::steady_clock::now();
+        body(pass);
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+template <typename Prepare, typename Body>
+void Benchmark::run(const std::string& name, const BenchmarkCase& benchmarkCase, unsigned long long callsPerPass, unsigned long long carsPerPass, unsigned long long cellsPerPass, Prepare&& prepare, Body&& body)
+{
+    if (!isSelected(name))
+        return;
+
+    //Calibrate: grow the pass count until a repetition is long enough to time
+    unsigned long long passes = 1;
+    double seconds = timePasses(passes, prepare, body);
+    while (seconds < minTime && passes < (1ULL << 40))
+    {
+        double scale = seconds > 0.0 ? 1.2 * minTime / seconds : 100.0;
+        passes = std::max(passes + 1, static_cast<unsigned long long>(passes * std::min(scale, 100.0)));
+        seconds = timePasses(passes, prepare, body);
+    }
+
+    std::vector<double> nsPerPass;
+    nsPerPass.push_back(seconds * 1e9 / passes);
+    for (int repetition = 1; repetition < repetitions; repetition++)
+        nsPerPass.push_back(timePasses(passes, prepare, body) * 1e9 / passes);
+
+    std::sort(nsPerPass.begin(), nsPerPass.end());
+    BenchmarkResult result{name, benchmarkCase, passes, nsPerPass[nsPerPass.size() / 2], callsPerPass, carsPerPass, cellsPerPass};
+    printResult(result);
+    results.push_back(result);
+}
+
+template <typename Body>
+void Benchmark::run(const std::string& name, const BenchmarkCase& benchmarkCase, unsigned long long callsPerPass, unsigned long long carsPerPass, unsigned long long cellsPerPass, Body&& body)
+{
+    run(name, benchmarkCase, callsPerPass, carsPerPass, cellsPerPass, [](unsigned long long) {}, std::forward<Body>(body));
+}
+
+#endif
@@ -0,0 +1,342 @@
+#include "SimulationBenchmarks.h"
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+    //Swallows the "Results serialized to" messages while serializeResults is timed
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int overflow(int c) override { return c; }
+    };
+
+    NullBuffer nullBuffer;
+
+    constexpr unsigned int benchmarkSeed = 12345;
+    constexpr unsigned long long recordedEpisodes = 200;     //Episodes held in memory for serializeResults
+    constexpr unsigned long long resultsResetInterval = 1024; //Passes after which collected metrics are dropped
+}
+
+SimulationBenchmarks::SimulationBenchmarks(Benchmark& benchmark, const std::string& scratchPath, unsigned long long warmUpSteps)
+    : benchmark(benchmark), scratchPath(scratchPath), warmUpSteps(warmUpSteps)
+{
+    std::filesystem::create_directories(scratchPath);
+}
+
+nlohmann::json SimulationBenchmarks::buildConfig(const BenchmarkCase& benchmarkCase, const std::string& outputFormat)
+{
+    nlohmann::json simulation;
+    simulation["episodes"] = 0;
+    simulation["queueSize"] = 100;
+    simulation["vMax"] = benchmarkCase.vMax;
+    simulation["brakeProbability"] = 0.2;
+    simulation["seed"] = benchmarkSeed;
+    simulation["outputFormat"] = outputFormat;
+    simulation["cycleTime"] = 30;
+    simulation["numberOfColumns"] = std::max(benchmarkCase.sharedSections, 1);
+    if (benchmarkCase.sharedSections > 0)
+        simulation["controllerType"] = "synchronized";
+
+    //Road 0 and road 1 cross at the same indices, placed like settings_generator.py does
+    nlohmann::json roads = nlohmann::json::array();
+    for (int roadID = 0; roadID < 2; roadID++)
+    {
+        nlohmann::json road;
+        road["roadID"] = roadID;
+        road["roadSize"] = benchmarkCase.roadSize;
+        road["isPeriodic"] = true;
+        road["maxSpeed"] = benchmarkCase.vMax;
+        road["density"] = benchmarkCase.density;
+        road["sharedSections"] = nlohmann::json::array();
+        roads.push_back(road);
+    }
+
+    nlohmann::json trafficLightGroups = nlohmann::json::array();
+    nlohmann::json trafficLights = nlohmann::json::array();
+    for (int intersection = 0; intersection < benchmarkCase.sharedSections; intersection++)
+    {
+        int index = static_cast<int>(std::round((intersection + 0.5) / benchmarkCase.sharedSections * (benchmarkCase.roadSize - 1)));
+        roads[0]["sharedSections"].push_back({1, index, index, 0.1, 0.1});
+        trafficLightGroups.push_back({{"groupID", intersection}, {"transitionTime", 5}});
+
+        for (int roadID = 0; roadID < 2; roadID++)
+        {
+            trafficLights.push_back({{"roadID", roadID}, {"position", index}, {"externalControl", false},
+                                     {"timeOpen", 15}, {"timeClosed", 15}, {"paired", true}, {"groupID", intersection}});
+        }
+    }
+
+    simulation["roads"] = roads;
+    simulation["trafficLightGroups"] = trafficLightGroups;
+    simulation["trafficLights"] = trafficLights;
+    return {{"simulation", simulation}};
+}
+
+std::unique_ptr<Simulation> SimulationBenchmarks::createSimulation(const BenchmarkCase& benchmarkCase, const std::string& outputFormat) const
+{
+    auto simulation = std::make_unique<Simulation>(buildConfig(benchmarkCase, outputFormat), scratchPath, 0);
+    simulation->setup();
+    simulation->currentMinute = 0;
+
+    for (unsigned long long episode = 0; episode < warmUpSteps; episode++)
+        step(*simulation, episode);
+
+    return simulation;
+}
+
+void SimulationBenchmarks::step(Simulation& simulation, unsigned long long episode)
+{
+    if (simulation.trafficLightController)
+        simulation.trafficLightController->update(episode);
+
+    for (auto& road : simulation.roads)
+        road->simulateStep(episode);
+}
+
+unsigned long long SimulationBenchmarks::countCars(const Simulation& simulation)
+{
+    unsigned long long cars = 0;
+    for (const auto& road : simulation.roads)
+        cars += road->carsPositions.size();
+    return cars;
+}
+
+unsigned long long SimulationBenchmarks::countCells(const Simulation& simulation)
+{
+    unsigned long long cells = 0;
+    for (const auto& road : simulation.roads)
+        cells += road->roadSize;
+    return cells;
+}
+
+void SimulationBenchmarks::runCase(const BenchmarkCase& benchmarkCase)
+{
+    benchSimulateStep(benchmarkCase);
+    benchMoveCars(benchmarkCase);
+    benchDistanceToNextCar(benchmarkCase);
+    benchDecideTargetRoad(benchmarkCase);
+    benchControllerUpdate(benchmarkCase, "synchronized");
+    benchControllerUpdate(benchmarkCase, "green_wave");
+    benchControllerUpdate(benchmarkCase, "random_offset");
+    benchControllerUpdate(benchmarkCase, "group_cycle");
+    benchControllerUpdate(benchmarkCase, "max_pressure");
+    benchCollectMetrics(benchmarkCase, "json");
+    benchCollectMetrics(benchmarkCase, "compressed");
+    benchSerializeResults(benchmarkCase, "json");
+    benchSerializeResults(benchmarkCase, "compressed");
+}
+
+void SimulationBenchmarks::benchSimulateStep(const BenchmarkCase& benchmarkCase)
+{
+    if (!benchmark.isSelected("Road::simulateStep"))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, "json");
+    unsigned long long episode = warmUpSteps;
+
+    //Lights switch outside the clock so only the road update is measured
+    benchmark.run("Road::simulateStep", benchmarkCase, simulation->roads.size(), countCars(*simulation), countCells(*simulation),
+        [&](unsigned long long)
+        {
+            if (simulation->trafficLightController)
+                simulation->trafficLightController->update(episode);
+        },
+        [&](unsigned long long)
+        {
+            for (auto& road : simulation->roads)
+                road->simulateStep(episode);
+            episode++;
+        });
+}
+
+void SimulationBenchmarks::benchMoveCars(const BenchmarkCase& benchmarkCase)
+{
+    if (!benchmark.isSelected("Road::moveCars"))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, "json");
+    auto& roads = simulation->roads;
+
+    //moveCars is measured from the same post-braking state every pass
+    for (auto& road : roads)
+        road->updateSpeeds();
+
+    ByteWriter snapshot;
+    for (const auto& road : roads)
+        road->saveState(snapshot);
+
+    benchmark.run("Road::moveCars", benchmarkCase, roads.size(), countCars(*simulation), countCells(*simulation),
+        [&](unsigned long long)
+        {
+            ByteReader input(snapshot.bytes.data(), snapshot.size());
+            for (auto& road : roads)
+                road->loadState(input, roads);
+        },
+        [&](unsigned long long)
+        {
+            for (auto& road : roads)
+                road->moveCars();
+        });
+}
+
+void SimulationBenchmarks::benchDistanceToNextCar(const BenchmarkCase& benchmarkCase)
+{
+    if (!benchmark.isSelected("Road::calculateDistanceToNextCarOrTrafficLight"))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, "json");
+
+    struct Probe
+    {
+        Road* road;
+        const Car* car;
+        int position;
+        int distanceSharedSection;
+    };
+
+    //Speeds are raised as in the acceleration rule, so the look-ahead matches a real step
+    std::vector<Probe> probes;
+    for (auto& road : simulation->roads)
+    {
+        for (int position : road->carsPositions)
+        {
+            const auto& car = road->carAt(position);
+            car->speed = std::min(car->speed + 1, road->maxSpeed);
+            probes.push_back({road.get(), car.get(), position, road->calculateDistanceToSharedSection(position)});
+        }
+    }
+
+    benchmark.run("Road::calculateDistanceToNextCarOrTrafficLight", benchmarkCase, probes.size(), probes.size(), countCells(*simulation),
+        [&](unsigned long long)
+        {
+            long long sum = 0;
+            for (const auto& probe : probes)
+                sum += probe.road->calculateDistanceToNextCarOrTrafficLight(*probe.car, probe.position, probe.distanceSharedSection);
+            doNotOptimize(sum);
+        });
+}
+
+void SimulationBenchmarks::benchDecideTargetRoad(const BenchmarkCase& benchmarkCase)
+{
+    if (benchmarkCase.sharedSections == 0 || !benchmark.isSelected("Road::decideTargetRoad"))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, "json");
+
+    std::vector<std::pair<Road*, int>> sharedSections;
+    for (auto& road : simulation->roads)
+        for (int position : road->sharedSectionsPositions)
+            sharedSections.emplace_back(road.get(), position);
+
+    //Decisions are taken once per car and shared section, not every step
+    benchmark.run("Road::decideTargetRoad", benchmarkCase, sharedSections.size(), 0, 0,
+        [&](unsigned long long)
+        {
+            int sum = 0;
+            for (auto& [road, position] : sharedSections)
+                sum += road->decideTargetRoad(position).first;
+            doNotOptimize(sum);
+        });
+}
+
+void SimulationBenchmarks::benchControllerUpdate(const BenchmarkCase& benchmarkCase, const std::string& controllerType)
+{
+    std::string name = "TrafficLightController::update/" + controllerType;
+    if (benchmarkCase.sharedSections == 0 || !benchmark.isSelected(name))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, "json");
+
+    std::shared_ptr<TrafficLightController> controller;
+    if (controllerType == "synchronized")
+        controller = std::make_shared<SyncController>();
+    else if (controllerType == "green_wave")
+        controller = std::make_shared<GreenWaveController>(30, benchmarkCase.vMax, 0.2, benchmarkCase.sharedSections);
+    else if (controllerType == "random_offset")
+        controller = std::make_shared<RandomOffsetController>(30, simulation->rng);
+    else if (controllerType == "max_pressure")
+        controller = std::make_shared<MaxPressureController>(5, 30);
+    else
+        controller = std::make_shared<GroupCycleController>();
+
+    for (auto& group : simulation->trafficLightGroups)
+        controller->addTrafficLightGroup(group);
+    controller->initialize();
+
+    unsigned long long episode = warmUpSteps;
+    benchmark.run(name, benchmarkCase, simulation->trafficLightGroups.size(), countCars(*simulation), countCells(*simulation),
+        [&](unsigned long long)
+        {
+            controller->update(episode++);
+        });
+}
+
+void SimulationBenchmarks::benchCollectMetrics(const BenchmarkCase& benchmarkCase, const std::string& outputFormat)
+{
+    std::string name = "Simulation::collectMetrics/" + outputFormat;
+    if (!benchmark.isSelected(name))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, outputFormat);
+    if (outputFormat == "compressed")
+        simulation->compressedResults = std::make_unique<CompressedResultsWriter>(simulation->roads);
+
+    //Every pass records a fresh step; the buffers are dropped now and then to bound memory
+    unsigned long long episode = warmUpSteps;
+    benchmark.run(name, benchmarkCase, 1, countCars(*simulation), countCells(*simulation),
+        [&](unsigned long long pass)
+        {
+            if (pass % resultsResetInterval == 0)
+            {
+                if (simulation->simulationResults.contains("episodes"))
+                    simulation->simulationResults.erase("episodes");
+                if (simulation->compressedResults)
+                    simulation->compressedResults = std::make_unique<CompressedResultsWriter>(simulation->roads);
+            }
+            step(*simulation, episode);
+        },
+        [&](unsigned long long)
+        {
+            simulation->collectMetrics(episode++);
+        });
+}
+
+void SimulationBenchmarks::benchSerializeResults(const BenchmarkCase& benchmarkCase, const std::string& outputFormat)
+{
+    std::string name = "Simulation::serializeResults/" + outputFormat;
+    if (!benchmark.isSelected(name))
+        return;
+
+    auto simulation = createSimulation(benchmarkCase, outputFormat);
+    simulation->createHeader();
+    if (outputFormat == "compressed")
+        simulation->compressedResults = std::make_unique<CompressedResultsWriter>(simulation->roads);
+
+    for (unsigned long long episode = warmUpSteps; episode < warmUpSteps + recordedEpisodes; episode++)
+    {
+        step(*simulation, episode);
+        simulation->collectMetrics(episode);
+    }
+
+    std::string filename = "bench_results." + std::string(outputFormat == "compressed" ? "nsc" : "json");
+    std::string path = scratchPath + "/" + filename;
+
+    //One pass writes all recorded episodes, so the per car-step cost covers each of them
+    unsigned long long cars = countCars(*simulation) * recordedEpisodes;
+    unsigned long long cells = countCells(*simulation) * recordedEpisodes;
+    benchmark.run(name, benchmarkCase, 1, cars, cells,
+        [&](unsigned long long)
+        {
+            std::filesystem::remove(path);
+        },
+        [&](unsigned long long)
+        {
+            auto coutBuffer = std::cout.rdbuf(&nullBuffer);
+            simulation->serializeResults(filename);
+            std::cout.rdbuf(coutBuffer);
+        });
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,41 @@
+#ifndef SIMULATION_BENCHMARKS_H
+#define SIMULATION_BENCHMARKS_H
+
+#include <memory>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "Simulation.h"
+#include "Benchmark.h"
+
+//Benchmarks of the per-step hot paths on a synthetic network of two periodic roads
+//crossing at sharedSections evenly spaced intersections, each with a pair of lights.
+//Declared a friend of Simulation to reach its roads, groups and result buffers.
+class SimulationBenchmarks
+{
+public:
+    SimulationBenchmarks(Benchmark& benchmark, const std::string& scratchPath, unsigned long long warmUpSteps);
+
+    void runCase(const BenchmarkCase& benchmarkCase);
+
+    static nlohmann::json buildConfig(const BenchmarkCase& benchmarkCase, const std::string& outputFormat);
+
+private:
+    Benchmark& benchmark;
+    std::string scratchPath;
+    unsigned long long warmUpSteps;
+
+    std::unique_ptr<Simulation> createSimulation(const BenchmarkCase& benchmarkCase, const std::string& outputFormat) const;
+    static void step(Simulation& simulation, unsigned long long episode);
+    static unsigned long long countCars(const Simulation& simulation);
+    static unsigned long long countCells(const Simulation& simulation);
+
+    void benchSimulateStep(const BenchmarkCase& benchmarkCase);
+    void benchMoveCars(const BenchmarkCase& benchmarkCase);
+    void benchDistanceToNextCar(const BenchmarkCase& benchmarkCase);
+    void benchDecideTargetRoad(const BenchmarkCase& benchmarkCase);
+    void benchControllerUpdate(const BenchmarkCase& benchmarkCase, const std::string& controllerType);
+    void benchCollectMetrics(const BenchmarkCase& benchmarkCase, const std::string& outputFormat);
+    void benchSerializeResults(const BenchmarkCase& benchmarkCase, const std::string& outputFormat);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "Benchmark.h"
+#include "SimulationBenchmarks.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <stdexcept>
+
+template <typename T>
+std::vector<T> parseList(const std::string& text)
+{
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        std::stringstream itemStream(item);
+        T value;
+        if (!(itemStream >> value))
+            throw std::invalid_argument("Invalid list value: " + item);
+        values.push_back(value);
+    }
+    return values;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<int> roadSizes = {256, 1024, 4096};
+    std::vector<double> densities = {0.1, 0.3, 0.6};
+    std::vector<int> maxSpeeds = {3, 5};
+    std::vector<int> sharedSections = {0, 4, 16};
+    std::string outputPath = "bench_results.json";
+    std::string filter;
+    double minTime = 0.02;
+    int repetitions = 3;
+    unsigned long long warmUpSteps = 200;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            auto next = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + argument);
+                return argv[++i];
+            };
+
+            if (argument == "--output")
+                outputPath = next();
+            else if (argument == "--filter")
+                filter = next();
+            else if (argument == "--min-time")
+                minTime = std::stod(next());
+            else if (argument == "--repetitions")
+                repetitions = std::stoi(next());
+            else if (argument == "--warm-up")
+                warmUpSteps = std::stoull(next());
+            else if (argument == "--road-sizes")
+                roadSizes = parseList<int>(next());
+            else if (argument == "--densities")
+                densities = parseList<double>(next());
+            else if (argument == "--vmax")
+                maxSpeeds = parseList<int>(next());
+            else if (argument == "--shared-sections")
+                sharedSections = parseList<int>(next());
+            else if (argument == "--quick")
+            {
+                roadSizes = {1024};
+                densities = {0.3};
+                maxSpeeds = {5};
+                sharedSections = {4};
+            }
+            else
+            {
+                std::cerr << "Usage: " << argv[0]
+                          << " [--output file] [--filter substring] [--min-time seconds] [--repetitions n] [--warm-up steps]"
+                          << " [--road-sizes a,b] [--densities a,b] [--vmax a,b] [--shared-sections a,b] [--quick]"
+                          << std::endl;
+                return 1;
+            }
+        }
+
+        Benchmark benchmark(minTime, repetitions, filter);
+        std::string scratchPath = (std::filesystem::temp_directory_path() / "nasch_bench").string();
+        SimulationBenchmarks simulationBenchmarks(benchmark, scratchPath, warmUpSteps);
+
+        for (int roadSize : roadSizes)
+            for (double density : densities)
+                for (int vMax : maxSpeeds)
+                    for (int shared : sharedSections)
+                        simulationBenchmarks.runCase({roadSize, density, vMax, shared});
+
+        std::filesystem::remove_all(scratchPath);
+
+        std::ofstream file(outputPath);
+        if (!file.is_open())
+            throw std::runtime_error("Unable to open benchmark output file: " + outputPath);
+
+        nlohmann::json output;
+        output["benchmarks"] = benchmark.toJson();
+        output["minTime"] = minTime;
+        output["repetitions"] = repetitions;
+        output["warmUpSteps"] = warmUpSteps;
+        file << std::setw(4) << output << std::endl;
+        std::cout << "Benchmark results written to " << outputPath << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error during benchmarks: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
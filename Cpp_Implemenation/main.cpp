@@ -8,7 +8,7 @@ int main(int argc, char* argv[])
     if (argc < 4)
     {
         std::cerr << "Usage: " << argv[0] 
-                  << " <configFilePath> <resultsPath> <executionType>"
+                  << " <configFilePath> <resultsPath> <executionType> [seed]"
                   << std::endl;
         return 1;
     }
@@ -32,6 +32,8 @@ int main(int argc, char* argv[])
     try
     {
         Simulation sim(configFilePath, resultsPath, executionType);
+        if (argc > 4)
+            sim.setSeed(static_cast<unsigned int>(std::stoul(argv[4])));
         sim.setup();
         sim.run();
     }
@@ -34,6 +34,10 @@ def generate_json_from_csv_row(row):
     prob_change        = float(row["probChange"])
     time_open          = float(row["timeOpen"])
     time_closed        = float(row["timeClosed"])
+    # Optional: "json" (default) or "compressed" (columnar .nsc output)
+    output_format      = row.get("outputFormat", "json") or "json"
+    # Optional: write only a "grid" spec and let the simulator expand it in memory
+    compact_grid       = (row.get("compactGrid", "") or "").strip().lower() in ["true", "1", "yes"]
 
     # 2) Build the top-level "simulation" dict
     simulation_data = {
@@ -43,6 +47,7 @@ def generate_json_from_csv_row(row):
         "cycleTime": cycle_time,
         "vMax": v_max,
         "brakeProbability": brake_probability,
+        "outputFormat": output_format,
         # "numberOfColumns" helps a controller interpret trafficLightGroups as a matrix
         # If N=0 (a single road), there's effectively no columns. You can choose 1 or 0:
         "numberOfColumns": (N if N > 0 else 1),
@@ -54,6 +59,24 @@ def generate_json_from_csv_row(row):
 
     # We'll fill "roads", "trafficLightGroups", and "trafficLights" depending on N
 
+    if compact_grid:
+        # Simulation::setupGrid builds the same network as the explicit lists below
+        for key in ("roads", "trafficLightGroups", "trafficLights"):
+            del simulation_data[key]
+        simulation_data["grid"] = {
+            "N": N,
+            "roadSize": road_size,
+            "isPeriodic": is_periodic,
+            "alphaWeight": alpha_weight,
+            "beta": beta,
+            "density": density,
+            "probChange": prob_change,
+            "timeOpen": time_open,
+            "timeClosed": time_closed,
+            "transitionTime": 5
+        }
+        return {"simulation": simulation_data}, output_filename
+
     # --------------------------------------------------------------------------
     # Handle the special case: N == 0 => single road, no intersections.
     # --------------------------------------------------------------------------
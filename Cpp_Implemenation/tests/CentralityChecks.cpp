@@ -0,0 +1,158 @@
+#include "NetworkCentrality.h"
+#include "RandomNumberGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Brandes' algorithm in NetworkCentrality::compute against the all-pairs definition in
+//computeAllPairs, on square grids (the layout of Simulation::setupGrid) and on random
+//networks with uneven segment lengths, where shortest paths tie and junctions join more
+//than two roads. Both the breadth-first and the bucket-queue variants run with one and
+//several threads.
+namespace
+{
+    int failures = 0;
+
+    //The generator is only handed to the roads; nothing here steps them
+    class ChecksGenerator : public RandomNumberGenerator
+    {
+    public:
+        ChecksGenerator() = default;
+    };
+
+    struct Network
+    {
+        std::string name;
+        std::vector<std::shared_ptr<Road>> roads;
+    };
+
+    std::shared_ptr<Road> makeRoad(int roadID, int roadSize, bool isPeriodic, RandomNumberGenerator& rng)
+    {
+        auto road = std::make_shared<Road>(roadID, roadSize, isPeriodic, 0.0, 3, 0.2, 0, rng, 100);
+        road->setupSections();
+        return road;
+    }
+
+    void connect(Road& road, int cell, Road& otherRoad, int otherCell)
+    {
+        auto section = road.wiredSection(cell);
+        auto otherSection = otherRoad.wiredSection(otherCell);
+        section->connect(otherSection);
+        otherSection->connect(section);
+    }
+
+    void sortPositions(Network& network)
+    {
+        for (auto& road : network.roads)
+            std::sort(road->sharedSectionsPositions.begin(), road->sharedSectionsPositions.end());
+    }
+
+    Network grid(int N, int roadSize, bool isPeriodic, RandomNumberGenerator& rng)
+    {
+        Network network{std::to_string(N) + "x" + std::to_string(N) + (isPeriodic ? " periodic grid" : " open grid"), {}};
+        for (int roadID = 0; roadID < 2 * N; roadID++)
+            network.roads.push_back(makeRoad(roadID, roadSize, isPeriodic, rng));
+
+        std::vector<int> intersectionIndices(N);
+        for (int i = 0; i < N; i++)
+            intersectionIndices[i] = static_cast<int>(std::nearbyint((i + 0.5) / N * (roadSize - 1)));
+
+        for (int column = 0; column < N; column++)
+            for (int row = 0; row < N; row++)
+                connect(*network.roads[column], intersectionIndices[row], *network.roads[N + row], intersectionIndices[column]);
+
+        sortPositions(network);
+        return network;
+    }
+
+    Network randomNetwork(int numRoads, int numCrossings, std::mt19937& generator, RandomNumberGenerator& rng)
+    {
+        Network network{"random network of " + std::to_string(numRoads) + " roads", {}};
+        std::uniform_int_distribution<int> roadSize(20, 60);
+        std::bernoulli_distribution periodic(0.7);
+        for (int roadID = 0; roadID < numRoads; roadID++)
+            network.roads.push_back(makeRoad(roadID, roadSize(generator), periodic(generator), rng));
+
+        //Segment lengths from a few values only, so that distinct routes often tie
+        std::uniform_int_distribution<int> pickRoad(0, numRoads - 1);
+        for (int crossing = 0; crossing < numCrossings; crossing++)
+        {
+            int roadID = pickRoad(generator);
+            int otherRoadID = pickRoad(generator);
+            if (roadID == otherRoadID)
+                continue;
+            Road& road = *network.roads[roadID];
+            Road& otherRoad = *network.roads[otherRoadID];
+            int cell = 5 * std::uniform_int_distribution<int>(0, road.roadSize / 5 - 1)(generator);
+            int otherCell = 5 * std::uniform_int_distribution<int>(0, otherRoad.roadSize / 5 - 1)(generator);
+            connect(road, cell, otherRoad, otherCell);
+        }
+
+        sortPositions(network);
+        return network;
+    }
+
+    bool close(double a, double b)
+    {
+        return std::abs(a - b) <= 1e-9 * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+    }
+
+    void checkNetwork(const Network& network)
+    {
+        for (bool weighted : {false, true})
+        {
+            NetworkCentrality reference(network.roads, weighted);
+            reference.computeAllPairs();
+
+            for (unsigned int numThreads : {1u, 4u})
+            {
+                NetworkCentrality brandes(network.roads, weighted);
+                brandes.compute(numThreads);
+
+                std::string label = network.name + (weighted ? ", weighted" : ", unweighted") + ", " + std::to_string(numThreads) + " thread(s)";
+                for (size_t junction = 0; junction < reference.numJunctions(); junction++)
+                {
+                    if (!close(brandes.betweennessCentrality[junction], reference.betweennessCentrality[junction]) ||
+                        !close(brandes.closenessCentrality[junction], reference.closenessCentrality[junction]))
+                    {
+                        failures++;
+                        std::cerr << "[FAIL] " << label << ": junction " << junction << " has betweenness " << brandes.betweennessCentrality[junction]
+                                  << " and closeness " << brandes.closenessCentrality[junction] << ", expected " << reference.betweennessCentrality[junction]
+                                  << " and " << reference.closenessCentrality[junction] << std::endl;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    ChecksGenerator rng;
+
+    std::vector<Network> networks;
+    for (int N = 2; N <= 5; N++)
+    {
+        networks.push_back(grid(N, 50, true, rng));
+        networks.push_back(grid(N, 50, false, rng));
+    }
+
+    std::mt19937 generator(12345);
+    for (int i = 0; i < 10; i++)
+        networks.push_back(randomNetwork(12, 40, generator, rng));
+
+    for (const auto& network : networks)
+        checkNetwork(network);
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " centrality check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "Brandes centralities match the all-pairs computation on " << networks.size() << " networks." << std::endl;
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "TimeSeriesCodec.h"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+//Round trip of the column codecs of the compressed output: every sequence is encoded,
+//decoded and compared value by value (floats bit for bit, so NaN payloads and -0.0 count).
+//Each sequence is also encoded with a checkpoint in the middle, and the restored
+//encoder has to produce the same bytes as the uninterrupted one.
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string& message)
+    {
+        if (!condition)
+        {
+            failures++;
+            std::cerr << "[FAIL] " << message << std::endl;
+        }
+    }
+
+    uint64_t bitsOf(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double fromBits(uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template <typename Encoder, typename T>
+    ByteWriter encode(const std::vector<T>& values, size_t checkpointAt)
+    {
+        Encoder encoder("column");
+        for (size_t i = 0; i < checkpointAt && i < values.size(); i++)
+            encoder.push(values[i]);
+
+        ByteWriter state;
+        encoder.saveState(state);
+        Encoder restored("column");
+        ByteReader input(state.bytes.data(), state.size());
+        restored.loadState(input);
+
+        for (size_t i = checkpointAt; i < values.size(); i++)
+            restored.push(values[i]);
+
+        ByteWriter output;
+        restored.finish(output);
+        return output;
+    }
+
+    template <typename Encoder, typename Decoder, typename T, typename Same>
+    void checkRoundTrip(const std::string& name, const std::vector<T>& values, Same same)
+    {
+        ByteWriter encoded = encode<Encoder>(values, values.size());
+        Decoder decoder(encoded.bytes.data(), encoded.size());
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (!same(decoder.next(), values[i]))
+            {
+                check(false, name + ": value " + std::to_string(i) + " of " + std::to_string(values.size()) + " decodes differently");
+                return;
+            }
+        }
+
+        for (size_t checkpointAt : {size_t(0), values.size() / 2, values.size() ? values.size() - 1 : 0})
+        {
+            ByteWriter resumed = encode<Encoder>(values, checkpointAt);
+            check(resumed.bytes == encoded.bytes, name + ": encoder restored at value " + std::to_string(checkpointAt) + " writes different bytes");
+        }
+    }
+
+    void checkIntegers(std::mt19937_64& generator)
+    {
+        auto same = [](long long a, long long b) { return a == b; };
+        const long long smallest = std::numeric_limits<long long>::min();
+        const long long largest = std::numeric_limits<long long>::max();
+
+        checkRoundTrip<IntColumnEncoder, IntColumnDecoder>("int empty", std::vector<long long>{}, same);
+        checkRoundTrip<IntColumnEncoder, IntColumnDecoder>("int constant", std::vector<long long>(1000, 42), same);
+        checkRoundTrip<IntColumnEncoder, IntColumnDecoder>("int extremes", std::vector<long long>{0, largest, smallest, largest, -1, smallest, 0, 1}, same);
+
+        std::vector<long long> walk;
+        long long value = 0;
+        std::uniform_int_distribution<long long> step(-300, 300);
+        for (int i = 0; i < 10000; i++)
+            walk.push_back(value += step(generator));
+        checkRoundTrip<IntColumnEncoder, IntColumnDecoder>("int random walk", walk, same);
+
+        std::vector<long long> noise;
+        std::uniform_int_distribution<long long> any(smallest, largest);
+        for (int i = 0; i < 10000; i++)
+            noise.push_back(any(generator));
+        checkRoundTrip<IntColumnEncoder, IntColumnDecoder>("int uniform", noise, same);
+    }
+
+    void checkBooleans(std::mt19937_64& generator)
+    {
+        auto same = [](bool a, bool b) { return a == b; };
+        checkRoundTrip<BoolColumnEncoder, BoolColumnDecoder>("bool empty", std::vector<bool>{}, same);
+        checkRoundTrip<BoolColumnEncoder, BoolColumnDecoder>("bool single", std::vector<bool>{true}, same);
+        checkRoundTrip<BoolColumnEncoder, BoolColumnDecoder>("bool constant", std::vector<bool>(5000, false), same);
+
+        std::vector<bool> alternating;
+        for (int i = 0; i < 5000; i++)
+            alternating.push_back(i % 2 == 0);
+        checkRoundTrip<BoolColumnEncoder, BoolColumnDecoder>("bool alternating", alternating, same);
+
+        //Light phases: runs of random length
+        std::vector<bool> runs;
+        std::uniform_int_distribution<int> runLength(1, 200);
+        for (bool state = true; runs.size() < 20000; state = !state)
+            runs.insert(runs.end(), runLength(generator), state);
+        checkRoundTrip<BoolColumnEncoder, BoolColumnDecoder>("bool runs", runs, same);
+    }
+
+    void checkFloats(std::mt19937_64& generator)
+    {
+        auto same = [](double a, double b) { return bitsOf(a) == bitsOf(b); };
+        checkRoundTrip<FloatColumnEncoder, FloatColumnDecoder>("float empty", std::vector<double>{}, same);
+        checkRoundTrip<FloatColumnEncoder, FloatColumnDecoder>("float constant", std::vector<double>(1000, 0.3), same);
+
+        std::vector<double> special = {0.0, -0.0, 1.0, -1.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+                                       std::numeric_limits<double>::quiet_NaN(), fromBits(0x7ff0000000000001ULL), std::numeric_limits<double>::denorm_min(),
+                                       std::numeric_limits<double>::min(), std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                                       fromBits(0x8000000000000001ULL), fromBits(0xffffffffffffffffULL), 0.0, fromBits(1)};
+        checkRoundTrip<FloatColumnEncoder, FloatColumnDecoder>("float special values", special, same);
+
+        //Densities and averages drift slowly, which exercises the reused bit window
+        std::vector<double> drift;
+        std::normal_distribution<double> change(0.0, 1e-3);
+        double density = 0.2;
+        for (int i = 0; i < 10000; i++)
+            drift.push_back(density += change(generator));
+        checkRoundTrip<FloatColumnEncoder, FloatColumnDecoder>("float drift", drift, same);
+
+        std::vector<double> noise;
+        for (int i = 0; i < 10000; i++)
+            noise.push_back(fromBits(generator()));
+        checkRoundTrip<FloatColumnEncoder, FloatColumnDecoder>("float random bits", noise, same);
+
+        //Ratios of small integers, as in averageSpeed, alternate between few distinct values
+        std::vector<double> ratios;
+        std::uniform_int_distribution<int> numerator(0, 30);
+        for (int i = 0; i < 10000; i++)
+            ratios.push_back(numerator(generator) / 7.0);
+        checkRoundTrip<FloatColumnEncoder, FloatColumnDecoder>("float ratios", ratios, same);
+    }
+}
+
+int main()
+{
+    std::mt19937_64 generator(12345);
+    checkIntegers(generator);
+    checkBooleans(generator);
+    checkFloats(generator);
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " codec check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "Codec round trip passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+Golden-trace regression harness.
+
+Runs every scenario in the scenarios directory with a fixed seed and "tracePath" set,
+then compares the per-step state hashes against the stored golden traces. The first
+step whose hash differs is reported, so an optimized engine can be checked for
+behavioural equivalence with the reference build.
+
+Golden traces are recorded with --record; a scenario without a golden trace fails. The
+committed traces were recorded with libstdc++ and are only comparable between builds
+that use the same standard library, since the std:: distributions are
+implementation-defined.
+
+Usage:
+    python3 trace_harness.py [--binary ./simulation] [--scenarios golden_traces] [--record]
+"""
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+DEFAULT_SEED = 12345
+
+def read_trace(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:4] != b'NSTR':
+        raise ValueError(f"{path} is not a trace file.")
+    first_episode = struct.unpack_from('<Q', data, 5)[0]
+    hashes = [h for (h,) in struct.iter_unpack('<Q', data[13:])]
+    return first_episode, hashes
+
+def first_difference(golden, candidate):
+    golden_first, golden_hashes = golden
+    candidate_first, candidate_hashes = candidate
+    if golden_first != candidate_first:
+        return f"traces start at different episodes ({golden_first} vs {candidate_first})"
+
+    for step, (expected, actual) in enumerate(zip(golden_hashes, candidate_hashes)):
+        if expected != actual:
+            return f"first difference at episode {golden_first + step} (expected {expected:016x}, got {actual:016x})"
+
+    if len(golden_hashes) != len(candidate_hashes):
+        return f"trace lengths differ ({len(golden_hashes)} vs {len(candidate_hashes)} steps)"
+    return None
+
+def run_scenario(binary, scenario_path, trace_path, work_dir):
+    with open(scenario_path) as f:
+        config = json.load(f)
+
+    simulation = config["simulation"]
+    simulation.setdefault("seed", DEFAULT_SEED)
+    simulation["tracePath"] = trace_path
+
+    config_path = os.path.join(work_dir, os.path.basename(scenario_path))
+    with open(config_path, 'w') as f:
+        json.dump(config, f)
+
+    result = subprocess.run([binary, config_path, work_dir, "0"], capture_output=True, text=True)
+    if result.returncode != 0:
+        raise RuntimeError(f"{scenario_path} failed:\n{result.stdout}{result.stderr}")
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare simulation state traces against golden traces.")
+    parser.add_argument('--binary', default='./simulation', help='Simulation binary to check (default: ./simulation).')
+    parser.add_argument('--scenarios', default='golden_traces', help='Directory with scenario configs and golden traces.')
+    parser.add_argument('--record', action='store_true', help='Record new golden traces instead of comparing.')
+    args = parser.parse_args()
+
+    scenarios = sorted(glob.glob(os.path.join(args.scenarios, '*.json')))
+    if not scenarios:
+        print(f"No scenarios found in {args.scenarios}")
+        return 1
+
+    failures = 0
+    work_dir = tempfile.mkdtemp(prefix='trace_harness_')
+    try:
+        for scenario in scenarios:
+            name = os.path.splitext(os.path.basename(scenario))[0]
+            golden_path = os.path.join(args.scenarios, name + '.trace')
+            trace_path = os.path.join(work_dir, name + '.trace')
+
+            run_scenario(args.binary, scenario, trace_path, work_dir)
+
+            if args.record:
+                shutil.copyfile(trace_path, golden_path)
+                print(f"[recorded] {name}: {len(read_trace(golden_path)[1])} steps")
+                continue
+
+            if not os.path.exists(golden_path):
+                failures += 1
+                print(f"[FAIL] {name}: no golden trace at {golden_path} (record one with --record)")
+                continue
+
+            difference = first_difference(read_trace(golden_path), read_trace(trace_path))
+            if difference:
+                failures += 1
+                print(f"[FAIL] {name}: {difference}")
+            else:
+                print(f"[ok] {name}")
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,9 +1,304 @@
 import json
+import math
+import struct
 import matplotlib.pyplot as plt
 import argparse
 import os
+from collections import deque
+
+def _read_varint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, offset
+        shift += 7
+
+def _zigzag_decode(value):
+    return (value >> 1) ^ -(value & 1)
+
+def decode_int_column(data, count):
+    # Delta + zig-zag + varint
+    values = []
+    offset = 0
+    previous = 0
+    for _ in range(count):
+        raw, offset = _read_varint(data, offset)
+        previous += _zigzag_decode(raw)
+        values.append(previous)
+    return values
+
+def decode_bool_column(data, count):
+    # First value, then alternating run lengths
+    values = []
+    if count == 0:
+        return values
+    current = data[0] != 0
+    offset = 1
+    while len(values) < count:
+        run, offset = _read_varint(data, offset)
+        values.extend([current] * run)
+        current = not current
+    return values
+
+class _BitReader:
+    # Big-endian bit fields from the front of a byte string, refilled one 64-bit word at a time
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+        self.buffer = 0
+        self.available = 0
+
+    def read(self, num_bits):
+        while self.available < num_bits:
+            word = self.data[self.offset:self.offset + 8].ljust(8, b'\0')
+            self.offset += 8
+            self.buffer = (self.buffer << 64) | int.from_bytes(word, 'big')
+            self.available += 64
+        self.available -= num_bits
+        value = self.buffer >> self.available
+        self.buffer &= (1 << self.available) - 1
+        return value
+
+def decode_float_column(data, count):
+    # XOR with the previous value (Gorilla-style)
+    read = _BitReader(data).read
+
+    values = []
+    previous = 0
+    leading = trailing = 0
+    for i in range(count):
+        if i == 0:
+            previous = read(64)
+        elif read(1):
+            if read(1):
+                leading = read(5)
+                trailing = 64 - leading - (read(6) + 1)
+            previous ^= read(64 - leading - trailing) << trailing
+        values.append(struct.unpack('<d', previous.to_bytes(8, 'little'))[0])
+    return values
+
+def load_compressed_results(filename, rolling_windows=False):
+    """
+    Decode a '.nsc' file written with "outputFormat": "compressed" into the same
+    structure as the JSON results ({"header": ..., "episodes": [...]}).
+    Queue metrics hold the samples logged in each episode, as with "sampleOutput": "new",
+    or the rolling window of the last queueSize samples if rolling_windows is True.
+    """
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'NSCR':
+        raise ValueError(f"{filename} is not a compressed simulation result file.")
+
+    offset = 5
+    header_length, offset = _read_varint(data, offset)
+    header = json.loads(data[offset:offset + header_length].decode('utf-8'))
+    offset += header_length
+
+    decoders = {0: decode_int_column, 1: decode_bool_column, 2: decode_float_column}
+    columns = {}
+    for column in header["columns"]:
+        length, offset = _read_varint(data, offset)
+        columns[column["name"]] = decoders[column["type"]](data[offset:offset + length], column["count"])
+        offset += length
+
+    def finite(value):
+        return value if math.isfinite(value) else None
+
+    queue_size = header["queueSize"]
+
+    def rolling_window(name):
+        # Samples logged in every episode, or the LimitedQueue contents seen then
+        counts = columns[name + ".newSamples"]
+        values = iter(columns[name])
+        window = deque(maxlen=queue_size if rolling_windows else None)
+        for new_samples in counts:
+            if not rolling_windows:
+                window.clear()
+            for _ in range(new_samples):
+                window.append(next(values))
+            yield list(window)
+
+    road_windows = []
+    for road in header["layout"]:
+        prefix = f"road{road['roadID']}."
+        road_windows.append({
+            "timeHeadways": [rolling_window(f"{prefix}timeHeadways.{p}") for p in road["points"]],
+            "residenceTimes": rolling_window(prefix + "residenceTimes"),
+            "travelTimes": rolling_window(prefix + "travelTimes"),
+            "averageTravelTimes": rolling_window(prefix + "averageTravelTimes"),
+        })
+
+    episodes = []
+    for index, episode in enumerate(columns["episode"]):
+        episode_data = {
+            "episode": episode,
+            "currentDay": (episode // 86400) % 7,
+            "currentHour": (episode // 3600) % 24,
+            "currentMinute": (episode // 60) % 60,
+            "roads": [],
+            "trafficLightGroups": [None] * len(header.get("trafficLightGroups", [])),
+        }
+        for road, windows in zip(header["layout"], road_windows):
+            prefix = f"road{road['roadID']}."
+            episode_data["roads"].append({
+                "roadID": road["roadID"],
+                "generalDensity": columns[prefix + "generalDensity"][index],
+                "averageDistanceHeadway": finite(columns[prefix + "averageDistanceHeadway"][index]),
+                "averageSpeed": finite(columns[prefix + "averageSpeed"][index]),
+                "alpha": columns[prefix + "alpha"][index],
+                "beta": columns[prefix + "beta"][index],
+                "numCars": columns[prefix + "numCars"][index],
+                "timeHeadways": [{"pointIndex": p, "timeHeadways": next(w)}
+                                 for p, w in zip(road["points"], windows["timeHeadways"])],
+                "flow": [{"pointIndex": p, "flow": columns[f"{prefix}flow.{p}"][index]} for p in road["points"]],
+                "residenceTimes": next(windows["residenceTimes"]),
+                "travelTimes": next(windows["travelTimes"]),
+                "averageTravelTimes": next(windows["averageTravelTimes"]),
+                "newCarInserted": columns[prefix + "newCarInserted"][index],
+                "trafficLights": [{"isGreen": columns[f"{prefix}trafficLights.{i}.isGreen"][index],
+                                   "timer": columns[f"{prefix}trafficLights.{i}.timer"][index]}
+                                  for i in range(road["numTrafficLights"])],
+            })
+        episodes.append(episode_data)
+
+    return {"header": header, "episodes": episodes}
+
+def load_space_time_file(filename):
+    """
+    Decode a '.nst' space-time recording into the shape used by the JSON results,
+    i.e. {"episodes": [{"episode": e, "roads": [{"roadID": id, "roadRepresentation": [...]}]}]}
+    with -1 for empty cells and the car speed otherwise.
+    """
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'NSST':
+        raise ValueError(f"{filename} is not a space-time diagram file.")
+
+    offset = 5
+    num_roads, offset = _read_varint(data, offset)
+    roads = []
+    for _ in range(num_roads):
+        road_id, offset = _read_varint(data, offset)
+        road_size, offset = _read_varint(data, offset)
+        bits_per_speed, offset = _read_varint(data, offset)
+        occupancy_words = (road_size + 63) // 64
+        speed_words = (road_size * bits_per_speed + 63) // 64
+        roads.append({"roadID": road_id, "roadSize": road_size, "bits": bits_per_speed,
+                      "occupancyWords": occupancy_words, "frame": [0] * (occupancy_words + speed_words)})
+
+    episodes = {}
+    while offset < len(data):
+        episode, offset = _read_varint(data, offset)
+        slot, offset = _read_varint(data, offset)
+        keyframe = data[offset]
+        offset += 1
+        changed_words, offset = _read_varint(data, offset)
+
+        road = roads[slot]
+        frame = road["frame"]
+        if keyframe:
+            frame[:] = [0] * len(frame)
+
+        index = 0
+        for _ in range(changed_words):
+            gap, offset = _read_varint(data, offset)
+            index += gap
+            frame[index] ^= int.from_bytes(data[offset:offset + 8], 'little')
+            offset += 8
+
+        # One pass over the cells: bit i of the occupancy plane, bits [i*bits, (i+1)*bits) of the speed plane
+        occupancy = b''.join(word.to_bytes(8, 'little') for word in frame[:road["occupancyWords"]])
+        speeds = b''.join(word.to_bytes(8, 'little') for word in frame[road["occupancyWords"]:]) + bytes(4)
+        bits = road["bits"]
+        mask = (1 << bits) - 1
+        width = (bits + 14) // 8  # Bytes spanned by a speed starting at any bit of its first byte
+        representation = []
+        bit = 0
+        for cell in range(road["roadSize"]):
+            if occupancy[cell >> 3] >> (cell & 7) & 1:
+                representation.append((int.from_bytes(speeds[bit >> 3:(bit >> 3) + width], 'little') >> (bit & 7)) & mask)
+            else:
+                representation.append(-1)
+            bit += bits
+
+        episodes.setdefault(episode, []).append({"roadID": road["roadID"], "roadRepresentation": representation})
+
+    return {"episodes": [{"episode": e, "roads": episodes[e]} for e in sorted(episodes)]}
+
+
+def load_trajectories(filename):
+    """
+    Decode a '.ntj' trajectory file into {vehicleID: [(step, roadID, position, speed), ...]},
+    each list in step order, plus the sampling interval and fraction from the header.
+    """
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'NSTJ':
+        raise ValueError(f"{filename} is not a trajectory file.")
+
+    _, record_size, interval, fraction = struct.unpack_from('<BBxxId', data, 4)
+    vehicles = {}
+    for offset in range(20, len(data) - record_size + 1, record_size):
+        step, vehicle_id, road_id, packed = struct.unpack_from('<IIII', data, offset)
+        vehicles.setdefault(vehicle_id, []).append((step, road_id, packed >> 8, packed & 0xFF))
+
+    return {"interval": interval, "fraction": fraction, "vehicles": vehicles}
+
+def merge_distributions(histograms):
+    """
+    Merge log-bucket histograms from the "distributions" output of several runs
+    or roads. Quantiles of the result are recomputed from the merged buckets.
+    """
+    counts = {}
+    merged = {"count": 0, "sum": 0.0, "min": None, "max": None}
+    for histogram in histograms:
+        if histogram["count"] == 0:
+            continue
+        for index, count in histogram["buckets"]:
+            counts[index] = counts.get(index, 0) + count
+        merged["count"] += histogram["count"]
+        merged["sum"] += histogram["sum"]
+        merged["min"] = histogram["min"] if merged["min"] is None else min(merged["min"], histogram["min"])
+        merged["max"] = histogram["max"] if merged["max"] is None else max(merged["max"], histogram["max"])
+        merged["precisionBits"] = histogram["precisionBits"]
+
+    merged["buckets"] = sorted(counts.items())
+    merged["mean"] = merged["sum"] / merged["count"] if merged["count"] else 0.0
+    for name, q in (("p50", 0.5), ("p90", 0.9), ("p95", 0.95), ("p99", 0.99)):
+        merged[name] = histogram_quantile(merged, q)
+    return merged
+
+def histogram_quantile(histogram, q):
+    # Same bucket layout and midpoint rule as LogHistogram::quantile
+    if histogram["count"] == 0:
+        return 0
+    half = 1 << (histogram["precisionBits"] - 1)
+    rank = max(1, math.ceil(q * histogram["count"]))
+    seen = 0
+    for index, count in histogram["buckets"]:
+        seen += count
+        if seen >= rank:
+            if index < 2 * half:
+                lower = upper = index
+            else:
+                shift = index // half - 1
+                lower = (index - shift * half) << shift
+                upper = lower + (1 << shift) - 1
+            return min(max(lower + (upper - lower) // 2, histogram["min"]), histogram["max"])
+    return histogram["max"]
 
 def load_simulation_results(filename):
+    if filename.endswith('.nst'):
+        return load_space_time_file(filename)
+    if filename.endswith('.nsc'):
+        return load_compressed_results(filename)
     with open(filename, 'r') as f:
         data = json.load(f)
     return data
@@ -93,8 +388,7 @@ def plot_flow_vs_density_multiple_files(json_filepaths, road_id=None):
     labels = []
 
     for filepath in json_filepaths:
-        with open(filepath, 'r') as f:
-            results = json.load(f)
+        results = load_simulation_results(filepath)
 
         episodes = results.get("episodes", [])
         if not episodes:
@@ -163,7 +457,7 @@ def main():
     parser.add_argument(
         '--json_dir',
         required=True,
-        help='Directory containing JSON result files.'
+        help='Directory containing JSON or compressed (.nsc) result files.'
     )
     parser.add_argument(
         '--plots',
@@ -190,17 +484,28 @@ def main():
     json_filepaths = [
         os.path.join(args.json_dir, f)
         for f in os.listdir(args.json_dir)
-        if f.endswith('.json')
+        if f.endswith('.json') or f.endswith('.nsc')
+    ]
+    space_time_filepaths = [
+        os.path.join(args.json_dir, f)
+        for f in os.listdir(args.json_dir)
+        if f.endswith('.nst')
     ]
 
-    if not json_filepaths:
-        print(f"No JSON files found in directory: {args.json_dir}")
+    if not json_filepaths and not space_time_filepaths:
+        print(f"No result files found in directory: {args.json_dir}")
         return
 
+    # Space-time diagrams come from the dedicated recordings when there are any
+    if 'space_time_diagram' in args.plots:
+        for filepath in space_time_filepaths:
+            results = load_space_time_file(filepath)
+            plot_space_time_diagram(results, road_id=args.road_id, max_timesteps=args.max_timesteps)
+
     for filepath in json_filepaths:
         results = load_simulation_results(filepath)
 
-        if 'space_time_diagram' in args.plots:
+        if 'space_time_diagram' in args.plots and not space_time_filepaths:
             plot_space_time_diagram(results, road_id=args.road_id, max_timesteps=args.max_timesteps)
         if 'flow_vs_density' in args.plots:
             plot_flow_vs_density(results, road_id=args.road_id)